@@ -9,6 +9,7 @@ class Ctptrader(ConanFile):
         self.requires("boost/1.75.0")
         self.requires("fmt/10.1.1")
         self.requires("gtest/1.10.0")
+        self.requires("benchmark/1.7.1")
         self.requires("libcurl/8.4.0")
         self.requires("rapidjson/1.1.0")
         self.requires("loguru/cci.20230406")
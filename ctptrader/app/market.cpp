@@ -3,6 +3,12 @@
 namespace ctptrader::app {
 
 void MdSpi::OnFrontConnected() {
+  // CTP runs every callback on a thread of its own, it is set up the first
+  // time it shows up.
+  if (const auto tid = gettid(); tid != callback_tid_) {
+    core::SetupThread(thread_options_);
+    callback_tid_ = tid;
+  }
   LOG_INFO("Connected to market server, sending login request");
   CThostFtdcReqUserLoginField req{};
   memset(&req, 0, sizeof(req));
@@ -122,40 +128,75 @@ void MdSpi::OnRspUnSubForQuoteRsp(
 
 void MdSpi::OnRtnDepthMarketData(
     CThostFtdcDepthMarketDataField *pDepthMarketData) {
-  auto id = ctx_->GetInstrumentCenter().GetID(pDepthMarketData->InstrumentID);
-  if (!received_[id] == 0) {
+  const auto id =
+      ctx_->GetInstrumentCenter().FindID(pDepthMarketData->InstrumentID);
+  if (id < 0) {
+    return;
+  }
+  if (received_[id] == 0) {
     static_.id_ = id;
-    // static_.trading_day_ =
-    // base::Date::FromString(pDepthMarketData->TradingDay);
+    static_.trading_day_ =
+        base::Date(base::Timestamp::ParseDate(pDepthMarketData->TradingDay));
     static_.prev_close_ = pDepthMarketData->PreClosePrice;
     static_.upper_limit_ = pDepthMarketData->UpperLimitPrice;
     static_.lower_limit_ = pDepthMarketData->LowerLimitPrice;
-    if (!tx_.Write(static_)) {
+    if (!tx_.Write(base::MsgType<base::Static>, static_)) {
       LOG_ERROR("Failed to write static data to tx");
     }
-    received_[id] = 1;
   }
 
+  depth_.update_time_ = clock_.Resolve(
+      exchanges_[id], pDepthMarketData->ActionDay, pDepthMarketData->UpdateTime,
+      pDepthMarketData->UpdateMillisec, time(nullptr));
   depth_.id_ = id;
-  depth_.open_ = pDepthMarketData->OpenPrice;
-  depth_.high_ = pDepthMarketData->HighestPrice;
-  depth_.low_ = pDepthMarketData->LowestPrice;
-  depth_.last_ = pDepthMarketData->ClosePrice;
-  depth_.open_interest_ = pDepthMarketData->OpenInterest;
-  depth_.volume_ = pDepthMarketData->Volume;
-  depth_.turnover_ = pDepthMarketData->Turnover;
-  depth_.ask_price_[0] = pDepthMarketData->AskPrice1;
-  depth_.bid_price_[0] = pDepthMarketData->BidPrice1;
-  depth_.ask_volume_[0] = pDepthMarketData->AskVolume1;
-  depth_.bid_volume_[0] = pDepthMarketData->BidVolume1;
-  if (!tx_.Write(depth_)) {
-    LOG_ERROR("Failed to write depth data to tx");
+  FillDepth(*pDepthMarketData, depth_);
+  PublishDepth(id);
+  received_[id] = 1;
+  if (build_bars_) {
+    bars_.OnDepth(depth_, [this](const base::Bar &bar) {
+      if (!tx_.Write(base::MsgType<base::Bar>, bar)) {
+        LOG_ERROR("Failed to write bar data to tx");
+      }
+    });
+  }
+  if (depth_tx_) {
+    depth_tx_->Write(id, depth_);
+  }
+}
+
+void MdSpi::PublishDepth(base::ID id) {
+  auto &book = books_[id];
+  if (snapshot_interval_ > 0 && received_[id] != 0 &&
+      since_snapshot_[id] < snapshot_interval_ &&
+      base::MakeDepthDelta(book, depth_, delta_)) {
+    if (!tx_.Write(base::MsgType<base::DepthDelta>, &delta_,
+                   base::DepthDeltaSize(delta_))) {
+      LOG_ERROR("Failed to write depth delta to tx");
+    }
+    ++since_snapshot_[id];
+  } else {
+    if (!tx_.Write(base::MsgType<base::Depth>, depth_)) {
+      LOG_ERROR("Failed to write depth data to tx");
+    }
+    since_snapshot_[id] = 0;
   }
+  book = depth_;
 }
 
 void MdSpi::SetInterests(std::vector<std::string> instruments) {
   interests_.assign(ctx_->GetInstrumentCenter().Count(), 0);
   received_.assign(ctx_->GetInstrumentCenter().Count(), 0);
+  books_.assign(ctx_->GetInstrumentCenter().Count(), base::Depth{});
+  exchanges_.assign(ctx_->GetInstrumentCenter().Count(),
+                    base::Exchange_Invalid);
+  for (int i = 0; i < ctx_->GetInstrumentCenter().Count(); ++i) {
+    const auto underlying = ctx_->GetUnderlyingCenter().GetID(
+        ctx_->GetInstrumentCenter().Get(i).underlying_);
+    if (underlying >= 0) {
+      exchanges_[i] = ctx_->GetUnderlyingCenter().Get(underlying).exchange_;
+    }
+  }
+  since_snapshot_.assign(ctx_->GetInstrumentCenter().Count(), 0);
   for (auto &i : instruments) {
     auto id = ctx_->GetInstrumentCenter().GetID(i);
     if (id >= 0) {
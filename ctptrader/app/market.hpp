@@ -1,6 +1,7 @@
 #pragma once
 #define FMT_HEADER_ONLY
 
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -8,27 +9,81 @@
 
 #include <ThostFtdcMdApi.h>
 
+#include <base/clock.hpp>
 #include <base/msg.hpp>
 #include <core/app.hpp>
+#include <core/bar.hpp>
 #include <core/ctx.hpp>
 #include <util/channel.hpp>
+#include <util/thread.hpp>
 
 namespace ctptrader::app {
 
+/// @brief Copies the prices and volumes of a CTP tick into depth, leaving
+/// id_ and update_time_ to the caller. CTP only fills ClosePrice after the
+/// close and sends DBL_MAX for it during the session, the traded price is
+/// LastPrice.
+inline void FillDepth(const CThostFtdcDepthMarketDataField &data,
+                      base::Depth &depth) {
+  depth.open_ = data.OpenPrice;
+  depth.high_ = data.HighestPrice;
+  depth.low_ = data.LowestPrice;
+  depth.last_ = data.LastPrice;
+  depth.open_interest_ = data.OpenInterest;
+  depth.volume_ = data.Volume;
+  depth.turnover_ = data.Turnover;
+  depth.ask_price_[0] = data.AskPrice1;
+  depth.ask_price_[1] = data.AskPrice2;
+  depth.ask_price_[2] = data.AskPrice3;
+  depth.ask_price_[3] = data.AskPrice4;
+  depth.ask_price_[4] = data.AskPrice5;
+  depth.bid_price_[0] = data.BidPrice1;
+  depth.bid_price_[1] = data.BidPrice2;
+  depth.bid_price_[2] = data.BidPrice3;
+  depth.bid_price_[3] = data.BidPrice4;
+  depth.bid_price_[4] = data.BidPrice5;
+  depth.ask_volume_[0] = data.AskVolume1;
+  depth.ask_volume_[1] = data.AskVolume2;
+  depth.ask_volume_[2] = data.AskVolume3;
+  depth.ask_volume_[3] = data.AskVolume4;
+  depth.ask_volume_[4] = data.AskVolume5;
+  depth.bid_volume_[0] = data.BidVolume1;
+  depth.bid_volume_[1] = data.BidVolume2;
+  depth.bid_volume_[2] = data.BidVolume3;
+  depth.bid_volume_[3] = data.BidVolume4;
+  depth.bid_volume_[4] = data.BidVolume5;
+}
+
 class MdSpi final : public CThostFtdcMdSpi {
 public:
   MdSpi(core::Context *ctx, CThostFtdcMdApi *api,
-        const std::string_view market_channel, const std::string_view broker_id,
-        const std::string_view user_id, const std::string_view password)
+        const std::string_view market_channel, uint64_t channel_capacity,
+        const util::ShmOptions &channel_options,
+        const std::string_view depth_cache, uint32_t snapshot_interval,
+        const std::string_view broker_id, const std::string_view user_id,
+        const std::string_view password)
       : ctx_(ctx)
       , api_(api)
-      , tx_(market_channel)
+      , tx_(market_channel, channel_capacity, channel_options)
+      , snapshot_interval_(snapshot_interval)
       , broker_id_(broker_id)
       , user_id_(user_id)
-      , password_(password) {}
+      , password_(password) {
+    if (channel_options.lock_ && !tx_.Locked()) {
+      LOG_WARNING("Failed to lock market channel pages in memory");
+    }
+    if (!depth_cache.empty()) {
+      depth_tx_.emplace(depth_cache, ctx_->GetInstrumentCenter().Count());
+    }
+  }
 
   ~MdSpi() = default;
 
+  /// @brief False if another live market process owns the channels.
+  [[nodiscard]] bool Ready() const {
+    return tx_.Ready() && (!depth_tx_ || depth_tx_->Ready());
+  }
+
   void OnFrontConnected() override;
 
   void OnFrontDisconnected(int nReason) override;
@@ -70,16 +125,46 @@ public:
 
   void SetInterests(std::vector<std::string> instruments);
 
+  /// @brief Builds and publishes bars of the given periods from the ticks.
+  ///
+  /// @return False if a period is not supported.
+  bool SetBarPeriods(const std::vector<int32_t> &periods) {
+    build_bars_ = !periods.empty();
+    return bars_.Init(*ctx_, periods);
+  }
+
+  /// @brief Placement of the CTP callback thread, which also publishes to the
+  /// channels. Applied from the first callback that runs on it.
+  void SetThreadOptions(const util::ThreadOptions &options) {
+    thread_options_ = options;
+  }
+
 private:
+  /// @brief Publishes depth_ as a DepthDelta against the last depth of the
+  /// instrument where that is smaller, as a full Depth otherwise.
+  void PublishDepth(base::ID id);
+
   core::Context *ctx_;
   CThostFtdcMdApi *api_{nullptr};
-  util::ShmSpscWriter<base::Msg, 20> tx_;
+  util::ShmBroadcastWriter tx_;
+  std::optional<util::ShmConflatedWriter<base::Depth>> depth_tx_;
+  // Deltas between full depths of an instrument, 0 sends full depths only
+  const uint32_t snapshot_interval_;
   const std::string broker_id_;
   const std::string user_id_;
   const std::string password_;
   std::vector<int> interests_;
   std::vector<int> received_;
+  std::vector<base::Depth> books_;       // last depth sent per instrument
+  std::vector<uint32_t> since_snapshot_; // deltas since the last full depth
+  std::vector<base::Exchange> exchanges_;
+  base::ExchangeClock clock_;
+  core::BarBuilder bars_;
+  bool build_bars_{false};
+  util::ThreadOptions thread_options_;
+  pid_t callback_tid_{0};
   base::Depth depth_;
+  base::DepthDelta delta_;
   base::Static static_;
   int request_id_{0};
 };
@@ -94,6 +179,29 @@ public:
     if (!ctx_.Init(data_folder)) {
       return false;
     }
+    if (!LoadChannelConfig(global_config, channel_capacity_,
+                           channel_options_)) {
+      return false;
+    }
+    if (global_config["market_depth_cache"].value_or(false)) {
+      depth_cache_ = DepthCacheName(market_channel_);
+    }
+    if (app_config["depth_delta"].value_or(false)) {
+      snapshot_interval_ =
+          app_config["snapshot_interval"].value_or(kDefaultSnapshotInterval);
+      if (snapshot_interval_ == 0) {
+        LOG_ERROR("snapshot_interval must be positive");
+        return false;
+      }
+    }
+    if (!LoadThreadConfig(app_config, "md_callback", thread_options_)) {
+      return false;
+    }
+    if (const auto *periods = app_config["bar_periods"].as_array()) {
+      for (const auto &p : *periods) {
+        bar_periods_.push_back(p.value_or(0));
+      }
+    }
     broker_id_ = global_config["broker_id"].value_or("");
     user_id_ = global_config["user_id"].value_or("");
     password_ = global_config["password"].value_or("");
@@ -117,8 +225,21 @@ public:
   void Run() override {
     const auto front_address = fmt::format("tcp://{}", market_front_);
     auto *api = CThostFtdcMdApi::CreateFtdcMdApi();
-    MdSpi spi(&ctx_, api, market_channel_, broker_id_, user_id_, password_);
+    MdSpi spi(&ctx_, api, market_channel_, channel_capacity_, channel_options_,
+              depth_cache_, snapshot_interval_, broker_id_, user_id_,
+              password_);
+    if (!spi.Ready()) {
+      LOG_ERROR("Market channel %s is owned by another live market process",
+                market_channel_.c_str());
+      api->Release();
+      return;
+    }
     spi.SetInterests(instruments_);
+    spi.SetThreadOptions(thread_options_);
+    if (!spi.SetBarPeriods(bar_periods_)) {
+      api->Release();
+      return;
+    }
     api->RegisterSpi(&spi);
     api->RegisterFront(const_cast<char *>(front_address.c_str()));
     api->Init();
@@ -127,7 +248,17 @@ public:
   }
 
 private:
+  /// @brief Deltas sent between two full depths of an instrument, so that a
+  /// reader that attaches or falls behind has a complete book again soon.
+  static constexpr uint32_t kDefaultSnapshotInterval = 100;
+
   const std::string market_channel_;
+  uint64_t channel_capacity_{0};
+  util::ShmOptions channel_options_;
+  std::string depth_cache_;
+  uint32_t snapshot_interval_{0};
+  util::ThreadOptions thread_options_;
+  std::vector<int32_t> bar_periods_;
   std::string broker_id_;
   std::string user_id_;
   std::string password_;
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <cfloat>
+#include <cstring>
+
+#include <app/market.hpp>
+
+namespace {
+
+using namespace ctptrader;
+
+TEST(FillDepthTest, BuildsBarsFromLastPrice) {
+  core::Context ctx;
+  ASSERT_TRUE(ctx.Init("./test"));
+  core::BarBuilder builder;
+  ASSERT_TRUE(builder.Init(ctx, {60}));
+  std::vector<base::Bar> bars;
+
+  // What CTP sends for cu2311 during the session
+  CThostFtdcDepthMarketDataField data;
+  std::memset(&data, 0, sizeof(data));
+  std::strcpy(data.InstrumentID, "cu2311");
+  data.ClosePrice = DBL_MAX;
+  data.SettlementPrice = DBL_MAX;
+  data.OpenPrice = 67000;
+  data.HighestPrice = 67100;
+  data.LowestPrice = 66900;
+  data.BidPrice1 = 66990;
+  data.AskPrice1 = 67010;
+  base::Depth depth{};
+  const auto midnight = base::Timestamp::CstMidnight(20231106);
+  const std::vector<std::pair<int, base::Price>> ticks = {
+      {10 * 3600, 67000}, {10 * 3600 + 30, 67050}, {10 * 3600 + 60, 66950}};
+  for (size_t i = 0; i < ticks.size(); ++i) {
+    data.LastPrice = ticks[i].second;
+    data.Volume = 1000 + 10 * static_cast<int>(i);
+    data.Turnover = data.Volume * data.LastPrice * 5;
+    app::FillDepth(data, depth);
+    depth.id_ = ctx.GetInstrumentCenter().FindID(data.InstrumentID);
+    depth.update_time_ = base::Timestamp{midnight + ticks[i].first, 0};
+    builder.OnDepth(depth,
+                    [&bars](const base::Bar &bar) { bars.push_back(bar); });
+  }
+
+  ASSERT_EQ(depth.last_, 66950);
+  ASSERT_EQ(bars.size(), 1U);
+  EXPECT_EQ(bars[0].open_, 67000);
+  EXPECT_EQ(bars[0].high_, 67050);
+  EXPECT_EQ(bars[0].close_, 67050);
+  EXPECT_EQ(bars[0].volume_, 10);
+}
+
+} // namespace
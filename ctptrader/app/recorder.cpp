@@ -0,0 +1,138 @@
+#include <app/recorder.hpp>
+
+#include <filesystem>
+
+namespace ctptrader::app {
+
+namespace {
+
+int64_t NowNs() {
+  timespec ts{};
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+} // namespace
+
+bool RecorderManager::Init(toml::table &global_config,
+                           toml::table &app_config) {
+  auto data_folder = global_config["data_folder"].value_or("");
+  if (!ctx_.Init(data_folder)) {
+    return false;
+  }
+  trading_days_.Init(ctx_.GetCalendarCenter());
+  uint64_t channel_capacity = 0;
+  util::ShmOptions channel_options;
+  if (!LoadChannelConfig(global_config, channel_capacity, channel_options)) {
+    return false;
+  }
+  md_rx_.emplace(market_channel_, channel_capacity, channel_options);
+  if (!md_rx_->Ready()) {
+    LOG_ERROR("Market channel %s has an incompatible layout",
+              market_channel_.c_str());
+    return false;
+  }
+  // Sleeping in the kernel between bursts keeps the recorder off the core
+  std::string wait_policy = app_config["wait_policy"].value_or("futex");
+  if (const auto it = util::WaitPolicyMap.find(wait_policy);
+      it != util::WaitPolicyMap.end()) {
+    md_rx_->SetWaitPolicy(it->second);
+  } else {
+    LOG_ERROR("Unknown wait policy: %s", wait_policy.c_str());
+    return false;
+  }
+  if (!LoadThreadConfig(app_config, "recorder", thread_options_)) {
+    return false;
+  }
+  batch_size_ = app_config["batch_size"].value_or(kDefaultBatchSize);
+  const int64_t flush_interval =
+      app_config["flush_interval"].value_or(kDefaultFlushInterval);
+  if (batch_size_ == 0 || flush_interval <= 0) {
+    LOG_ERROR("batch_size and flush_interval must be positive");
+    return false;
+  }
+  flush_interval_ns_ = flush_interval * 1000000;
+  folder_ = app_config["folder"].value_or("");
+  std::error_code ec;
+  if (folder_.empty() || (!std::filesystem::create_directories(folder_, ec) &&
+                           !std::filesystem::is_directory(folder_))) {
+    LOG_ERROR("Record folder %s is not a directory", folder_.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool RecorderManager::Roll(time_t now) {
+  const auto session = trading_days_.Find(now);
+  next_roll_ = (session.evening_ + 1) * base::SECONDSINDAY + 18 * 3600 -
+               base::CSTOFFSET;
+  auto trading_day = session.trading_day_;
+  if (trading_day == 0) {
+    // Outside the calendar the session belongs to the next day
+    const time_t day = (session.evening_ + 1) * base::SECONDSINDAY;
+    tm date{};
+    gmtime_r(&day, &date);
+    trading_day = (date.tm_year + 1900) * 10000 + (date.tm_mon + 1) * 100 +
+                  date.tm_mday;
+    LOG_WARNING("%ld is not in the calendar, recording to trading day %d",
+                now, trading_day);
+  }
+  if (writer_.IsOpen() && writer_.TradingDay() == trading_day) {
+    return true;
+  }
+  writer_.Close();
+  const auto path = folder_ + "/" + market_channel_ + "." +
+                    std::to_string(trading_day) + ".rec";
+  if (!writer_.Open(path, trading_day)) {
+    LOG_ERROR("Failed to open record file %s", path.c_str());
+    return false;
+  }
+  LOG_INFO("Recording to %s from record %lu%s", path.c_str(),
+           writer_.Records(), writer_.Direct() ? "" : " without O_DIRECT");
+  return true;
+}
+
+void RecorderManager::Run() {
+  core::SetupThread(thread_options_);
+  auto now_ns = NowNs();
+  if (!Roll(now_ns / 1000000000)) {
+    return;
+  }
+  uint64_t overruns = 0;
+  auto generation = md_rx_->Generation();
+  auto next_flush = now_ns + flush_interval_ns_;
+  // Frames of one batch share the time they were read
+  const auto record = [this, &now_ns](const util::FrameHeader &frame) {
+    writer_.Append(frame, now_ns);
+  };
+  while (!stop_) {
+    now_ns = NowNs();
+    const auto n = md_rx_->ReadBatch(batch_size_, record);
+    if (now_ns >= next_flush) {
+      writer_.Flush();
+      next_flush = now_ns + flush_interval_ns_;
+      if (writer_.Failed()) {
+        LOG_ERROR("Failed to write the record file, stopping");
+        break;
+      }
+      if (md_rx_->Generation() != generation) {
+        generation = md_rx_->Generation();
+        LOG_WARNING("Market process restarted, generation %u", generation);
+      }
+      if (md_rx_->Overruns() != overruns) {
+        overruns = md_rx_->Overruns();
+        LOG_WARNING("Market channel overrun, %lu messages dropped in total",
+                    md_rx_->Dropped());
+      }
+    }
+    if (now_ns / 1000000000 >= next_roll_ && !Roll(now_ns / 1000000000)) {
+      break;
+    }
+    if (n == 0) {
+      md_rx_->Wait();
+    }
+  }
+  writer_.Close();
+}
+
+} // namespace ctptrader::app
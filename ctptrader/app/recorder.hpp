@@ -0,0 +1,54 @@
+#pragma once
+
+#include <ctime>
+#include <optional>
+#include <string_view>
+
+#include <core/app.hpp>
+#include <core/ctx.hpp>
+#include <core/session.hpp>
+#include <util/channel.hpp>
+#include <util/record.hpp>
+
+namespace ctptrader::app {
+
+/// @brief Records the market channel to one file per trading day.
+///
+/// The recorder is one more reader of the broadcast ring, which never waits
+/// for its readers, so a slow disk costs the recorder frames and never the
+/// market process. Every frame is kept as it was published, with the time it
+/// was read; gaps in the sequence numbers of a file show frames lost to
+/// overruns.
+class RecorderManager final : public core::IApp {
+public:
+  explicit RecorderManager(const std::string_view market_channel)
+      : market_channel_(market_channel) {}
+
+  bool Init(toml::table &global_config, toml::table &app_config) override;
+
+  void Run() override;
+
+private:
+  /// @brief Frames copied per pass over the market channel.
+  static constexpr uint64_t kDefaultBatchSize = 256;
+  /// @brief Milliseconds between two flushes of the record file.
+  static constexpr int64_t kDefaultFlushInterval = 1000;
+
+  /// @brief Switches to the file of the trading day now falls in.
+  ///
+  /// @return False if that file cannot be opened.
+  bool Roll(time_t now);
+
+  const std::string market_channel_;
+  std::string folder_;
+  uint64_t batch_size_{kDefaultBatchSize};
+  int64_t flush_interval_ns_{kDefaultFlushInterval * 1000000};
+  util::ThreadOptions thread_options_;
+  core::TradingDays trading_days_;
+  std::optional<util::ShmBroadcastReader> md_rx_;
+  util::RecordWriter writer_;
+  time_t next_roll_{0}; // 18:00 after which the trading day may change
+  bool stop_ = false;
+};
+
+} // namespace ctptrader::app
@@ -1 +1,518 @@
-#include <app/sim.hpp>
\ No newline at end of file
+#include <app/sim.hpp>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <new>
+#include <set>
+#include <sstream>
+
+namespace ctptrader::app {
+
+namespace {
+
+base::Timestamp ToTimestamp(int64_t ns) {
+  base::Timestamp ts;
+  ts.tv_sec = ns / base::NANOSINSECOND;
+  ts.tv_nsec = ns % base::NANOSINSECOND;
+  return ts;
+}
+
+int64_t MonotonicNs() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * base::NANOSINSECOND + ts.tv_nsec;
+}
+
+/// @brief Keys of the chunks of a tick file: chunks with the same type,
+/// instrument and bar period follow each other in the index.
+bool SameRows(const util::TickChunk &a, const util::TickChunk &b) {
+  return a.type_ == b.type_ && a.id_ == b.id_ && a.period_ == b.period_;
+}
+
+/// @brief Stands for the trading day in source paths, as yyyymmdd.
+constexpr char kDatePlaceholder[] = "{date}";
+/// @brief Stands for the market channel in source paths.
+constexpr char kChannelPlaceholder[] = "{channel}";
+
+/// @brief Replaces every placeholder in a path by a value.
+void Substitute(std::string &path, std::string_view placeholder,
+                const std::string &value) {
+  for (auto at = path.find(placeholder); at != std::string::npos;
+       at = path.find(placeholder, at + value.size())) {
+    path.replace(at, placeholder.size(), value);
+  }
+}
+
+} // namespace
+
+bool Replay::Init(core::Context &ctx, toml::table &app_config,
+                  const std::string &channel, const std::string &date) {
+  ctx_ = &ctx;
+  auto *sources = app_config["source"].as_array();
+  if (sources == nullptr || sources->empty()) {
+    LOG_ERROR("No sources to replay");
+    return false;
+  }
+  for (auto &source : *sources) {
+    if (!source.is_table() ||
+        !AddSource(*source.as_table(), channel, date)) {
+      return false;
+    }
+  }
+  const int64_t latency_us = app_config["latency"].value_or(0);
+  if (latency_us < 0) {
+    LOG_ERROR("latency must not be negative");
+    return false;
+  }
+  engine_.emplace(ctx.GetInstrumentCenter().Count(), latency_us * 1000);
+  return stgs_.Load(app_config, ctx, &*engine_);
+}
+
+void Replay::Step() {
+  const auto ts = iter_.PeekTime();
+  if (messages_++ == 0) {
+    first_ns_ = ts;
+  }
+  last_ns_ = ts;
+  // Orders that reached the exchange by now meet the book they saw
+  engine_->Advance(ts);
+  Deliver(ts);
+  ctx_->SetTime(ToTimestamp(ts));
+  Dispatch(iter_.Next());
+}
+
+core::SimResult Replay::Finish() {
+  engine_->Advance(INT64_MAX);
+  Deliver(INT64_MAX);
+  core::SimResult result;
+  stgs_.OnSimEnd(result);
+  result.fills_ += engine_->Fills();
+  result.volume_ += engine_->FilledVolume();
+  return result;
+}
+
+bool Replay::AddSource(toml::table &source, const std::string &channel,
+                       const std::string &date) {
+  const std::string type = source["type"].value_or("");
+  std::string path = source["path"].value_or("");
+  Substitute(path, kChannelPlaceholder, channel);
+  Substitute(path, kDatePlaceholder, date);
+  if (type == "record") {
+    auto reader = std::make_unique<core::RecordFileReader>();
+    if (!reader->Open(path)) {
+      LOG_ERROR("Failed to open record file %s", path.c_str());
+      return false;
+    }
+    iter_.AddReader(std::move(reader));
+    LOG_INFO("Replaying record file %s", path.c_str());
+    return true;
+  }
+  if (type == "tick") {
+    return AddTickFile(path, source);
+  }
+  LOG_ERROR("Unknown source type: %s", type.c_str());
+  return false;
+}
+
+bool Replay::AddTickFile(const std::string &path, toml::table &source) {
+  auto file = std::make_shared<util::TickFileReader>();
+  if (!file->Open(path)) {
+    LOG_ERROR("Failed to open tick file %s", path.c_str());
+    return false;
+  }
+  // Every instrument of the file unless some are listed
+  std::set<base::InstrumentID> ids;
+  if (const auto *instruments = source["instruments"].as_array()) {
+    for (const auto &name : *instruments) {
+      const auto id =
+          ctx_->GetInstrumentCenter().GetID(name.value_or(std::string()));
+      if (id < 0) {
+        LOG_ERROR("Unknown instrument in %s", path.c_str());
+        return false;
+      }
+      ids.insert(id);
+    }
+  }
+  const auto chunks = file->Chunks();
+  size_t readers = 0;
+  for (size_t begin = 0, end = 0; begin < chunks.size(); begin = end) {
+    for (end = begin + 1;
+         end < chunks.size() && SameRows(chunks[begin], chunks[end]); ++end) {
+    }
+    const auto &chunk = chunks[begin];
+    if (chunk.id_ >= ctx_->GetInstrumentCenter().Count() ||
+        (!ids.empty() && !ids.contains(chunk.id_))) {
+      continue;
+    }
+    const auto rows = chunks.subspan(begin, end - begin);
+    if (chunk.type_ == base::MsgType<base::Depth>) {
+      iter_.AddReader(
+          std::make_unique<core::TickFileRowReader<base::Depth>>(file, rows));
+    } else if (chunk.type_ == base::MsgType<base::Bar>) {
+      iter_.AddReader(
+          std::make_unique<core::TickFileRowReader<base::Bar>>(file, rows));
+    } else {
+      continue;
+    }
+    ++readers;
+  }
+  LOG_INFO("Replaying %lu series from tick file %s", readers, path.c_str());
+  return true;
+}
+
+void Replay::Dispatch(const base::Msg &msg) {
+  std::visit(
+      [this](const auto &m) {
+        using T = std::decay_t<decltype(m)>;
+        if constexpr (std::is_same_v<T, base::Static>) {
+          stgs_.OnStatic(m);
+        } else if constexpr (std::is_same_v<T, base::Bar>) {
+          stgs_.OnBar(m);
+        } else if constexpr (std::is_same_v<T, base::Depth>) {
+          engine_->OnDepth(m, last_ns_);
+          stgs_.OnFullDepth(m);
+        } else if constexpr (std::is_same_v<T, base::DepthDelta>) {
+          if (const auto *depth = stgs_.Rebuild(m)) {
+            engine_->OnDepth(*depth, last_ns_);
+            stgs_.OnDepth(*depth);
+          }
+        } else if constexpr (std::is_same_v<T, base::Balance>) {
+          stgs_.OnBalance(m);
+        }
+      },
+      msg);
+}
+
+void Replay::Deliver(int64_t until_ns) {
+  engine_->Drain(until_ns, [this](const core::MatchReport &r) {
+    ctx_->SetTime(ToTimestamp(r.time_ns_));
+    if (const auto *update = std::get_if<base::OrderUpdate>(&r.msg_)) {
+      stgs_.OnOrderUpdate(r.strategy_id_, *update);
+    } else if (const auto *trade = std::get_if<base::Trade>(&r.msg_)) {
+      stgs_.OnTrade(r.strategy_id_, *trade);
+    }
+  });
+}
+
+bool SimManager::Init(toml::table &global_config, toml::table &app_config) {
+  auto data_folder = global_config["data_folder"].value_or("");
+  if (!ctx_.Init(data_folder)) {
+    return false;
+  }
+  ctx_.UseSimClock();
+  if (!LoadThreadConfig(app_config, "sim", thread_options_)) {
+    return false;
+  }
+  speed_ = app_config["speed"].value_or(0.0);
+  const int64_t max_pause =
+      app_config["max_pause"].value_or(kDefaultMaxPause);
+  if (speed_ < 0 || max_pause < 0) {
+    LOG_ERROR("speed and max_pause must not be negative");
+    return false;
+  }
+  max_pause_ns_ = max_pause * base::NANOSINSECOND;
+  return replay_.Init(ctx_, app_config, market_channel_);
+}
+
+void SimManager::Pace(int64_t ts_ns) {
+  if (speed_ <= 0) {
+    return;
+  }
+  const auto now = MonotonicNs();
+  // The first message and those after a long pause are replayed at once
+  if (wall_origin_ns_ == 0 || ts_ns - last_ns_ > max_pause_ns_) {
+    sim_origin_ns_ = ts_ns;
+    wall_origin_ns_ = now;
+  }
+  last_ns_ = ts_ns;
+  const auto due =
+      wall_origin_ns_ +
+      static_cast<int64_t>(static_cast<double>(ts_ns - sim_origin_ns_) /
+                           speed_);
+  if (due > now) {
+    const timespec until{due / base::NANOSINSECOND,
+                         due % base::NANOSINSECOND};
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr);
+  }
+}
+
+void SimManager::Run() {
+  core::SetupThread(thread_options_);
+  const auto wall_begin = MonotonicNs();
+  while (!stop_ && !replay_.Empty()) {
+    Pace(replay_.PeekTime());
+    replay_.Step();
+  }
+  const auto seconds =
+      static_cast<double>(MonotonicNs() - wall_begin) / base::NANOSINSECOND;
+  LOG_INFO("Replayed %lu messages from %s to %s in %.3f s", replay_.Messages(),
+           ToTimestamp(replay_.FirstTime()).ToCstString().c_str(),
+           ToTimestamp(replay_.LastTime()).ToCstString().c_str(), seconds);
+  const auto result = replay_.Finish();
+  LOG_INFO("PnL %.2f from %ld fills of %ld lots", result.pnl_, result.fills_,
+           result.volume_);
+}
+
+SweepManager::~SweepManager() {
+  if (map_ != nullptr) {
+    munmap(map_, map_bytes_);
+  }
+}
+
+bool SweepManager::Init(toml::table &global_config, toml::table &app_config) {
+  data_folder_ = global_config["data_folder"].value_or("");
+  if (!ctx_.Init(data_folder_)) {
+    return false;
+  }
+  config_ = app_config;
+  const int begin = app_config["begin_date"].value_or(0);
+  const int end = app_config["end_date"].value_or(begin);
+  const auto &calendar = ctx_.GetCalendarCenter();
+  for (auto i = 0; i < calendar.Count(); ++i) {
+    const auto &date = calendar.Get(i);
+    if (date.is_trading_day_ && date.date_.AsInt() >= begin &&
+        date.date_.AsInt() <= end) {
+      days_.push_back(date.date_.AsInt());
+    }
+  }
+  if (days_.empty()) {
+    LOG_ERROR("No trading days from %d to %d in the calendar", begin, end);
+    return false;
+  }
+  if (!LoadGrid(app_config["grid"].as_table())) {
+    return false;
+  }
+  const auto units = days_.size() * params_.size();
+  const auto allowed = util::AllowedCpus();
+  const int64_t workers =
+      app_config["workers"].value_or(static_cast<int64_t>(allowed.size()));
+  if (workers <= 0) {
+    LOG_ERROR("workers must be positive");
+    return false;
+  }
+  workers_ = std::min<size_t>(workers, units);
+  // One worker per core, as many as there are, runs without migrations
+  if (app_config["pin"].value_or(true) && !allowed.empty()) {
+    cpus_ = allowed;
+  }
+  priority_ = app_config["priority"].value_or(0);
+  if (priority_ < 0 || priority_ > 99) {
+    LOG_ERROR("priority must be between 0 and 99: %d", priority_);
+    return false;
+  }
+  output_ = app_config["output"].value_or("");
+  map_bytes_ = sizeof(UnitResult) * (units + 1);
+  map_ = mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (map_ == MAP_FAILED) {
+    map_ = nullptr;
+    LOG_ERROR("Failed to map the results of %lu units", units);
+    return false;
+  }
+  // The counter has the first cache line to itself, the results follow
+  next_unit_ = new (map_) std::atomic<uint64_t>(0);
+  results_ = static_cast<UnitResult *>(map_) + 1;
+  std::uninitialized_value_construct_n(results_, units);
+  LOG_INFO("Sweeping %lu parameter sets over %lu trading days from %d to %d "
+           "with %lu workers",
+           params_.size(), days_.size(), days_.front(), days_.back(),
+           workers_);
+  return true;
+}
+
+bool SweepManager::LoadGrid(toml::table *grid) {
+  params_.assign(1, toml::table());
+  labels_.assign(1, "");
+  if (grid == nullptr || grid->empty()) {
+    labels_[0] = "as configured";
+    return true;
+  }
+  for (auto &[key, values] : *grid) {
+    toml::array single;
+    auto *array = values.as_array();
+    if (array == nullptr) {
+      single.push_back(values);
+      array = &single;
+    }
+    if (array->empty()) {
+      LOG_ERROR("No values for parameter %s", key.data());
+      return false;
+    }
+    std::vector<toml::table> params;
+    std::vector<std::string> labels;
+    for (size_t i = 0; i < params_.size(); ++i) {
+      for (auto &value : *array) {
+        params.push_back(params_[i]);
+        params.back().insert_or_assign(key, value);
+        std::ostringstream label;
+        label << labels_[i] << (labels_[i].empty() ? "" : " ") << key << '=';
+        value.visit([&label](const auto &v) { label << v; });
+        labels.push_back(label.str());
+      }
+    }
+    params_ = std::move(params);
+    labels_ = std::move(labels);
+  }
+  return true;
+}
+
+void SweepManager::Run() {
+  const auto wall_begin = MonotonicNs();
+  std::vector<pid_t> pids;
+  for (size_t worker = 0; worker < workers_; ++worker) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      Work(worker);
+      // Nothing of the parent is torn down in a worker
+      std::fflush(nullptr);
+      _exit(0);
+    }
+    if (pid < 0) {
+      LOG_ERROR("Failed to fork worker %lu, going on with %lu", worker,
+                pids.size());
+      break;
+    }
+    pids.push_back(pid);
+  }
+  for (const auto pid : pids) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      LOG_ERROR("Worker %d died, its unit is lost", pid);
+    }
+  }
+  Report(MonotonicNs() - wall_begin);
+}
+
+void SweepManager::Work(size_t worker) {
+  util::ThreadOptions options;
+  options.name_ = "sweep" + std::to_string(worker);
+  options.cpu_ = cpus_.empty() ? util::ThreadOptions::kAnyCpu
+                               : cpus_[worker % cpus_.size()];
+  options.priority_ = priority_;
+  core::SetupThread(options);
+  const auto units = days_.size() * params_.size();
+  for (auto unit = next_unit_->fetch_add(1, std::memory_order_relaxed);
+       unit < units;
+       unit = next_unit_->fetch_add(1, std::memory_order_relaxed)) {
+    RunUnit(unit, results_[unit]);
+  }
+}
+
+void SweepManager::RunUnit(size_t unit, UnitResult &out) {
+  // Units of a day follow each other, so workers share its files in the page
+  // cache
+  const auto day = days_[unit / params_.size()];
+  const auto set = unit % params_.size();
+  out.status_ = kFailed;
+  core::Context ctx;
+  if (!ctx.Init(data_folder_)) {
+    return;
+  }
+  ctx.UseSimClock();
+  auto config = config_;
+  if (auto *stgs = config["stg"].as_array()) {
+    for (auto &stg : *stgs) {
+      if (auto *table = stg.as_table()) {
+        for (const auto &[key, value] : params_[set]) {
+          table->insert_or_assign(key, value);
+        }
+      }
+    }
+  }
+  Replay replay;
+  if (!replay.Init(ctx, config, market_channel_, std::to_string(day))) {
+    LOG_ERROR("Unit %lu, %d with %s, failed", unit, day, labels_[set].c_str());
+    return;
+  }
+  const auto begin = MonotonicNs();
+  while (!replay.Empty()) {
+    replay.Step();
+  }
+  out.result_ = replay.Finish();
+  out.messages_ = replay.Messages();
+  out.wall_ns_ = MonotonicNs() - begin;
+  out.status_ = kDone;
+}
+
+void SweepManager::Report(int64_t wall_ns) {
+  std::FILE *csv = nullptr;
+  if (!output_.empty()) {
+    csv = std::fopen(output_.c_str(), "w");
+    if (csv == nullptr) {
+      LOG_ERROR("Failed to write the results to %s", output_.c_str());
+    } else {
+      std::fputs("date,params,pnl,fills,volume,messages,seconds\n", csv);
+    }
+  }
+  // Per parameter set
+  struct Total {
+    core::SimResult result_;
+    double pnl_squares_{0}; // sum of daily pnl squared
+    size_t days_{0};
+    size_t failed_{0};
+  };
+  std::vector<Total> totals(params_.size());
+  uint64_t messages = 0;
+  int64_t busy_ns = 0;
+  for (size_t unit = 0; unit < days_.size() * params_.size(); ++unit) {
+    const auto &r = results_[unit];
+    const auto day = days_[unit / params_.size()];
+    const auto set = unit % params_.size();
+    auto &total = totals[set];
+    if (r.status_ != kDone) {
+      ++total.failed_;
+      continue;
+    }
+    total.result_ += r.result_;
+    total.pnl_squares_ += r.result_.pnl_ * r.result_.pnl_;
+    ++total.days_;
+    messages += r.messages_;
+    busy_ns += r.wall_ns_;
+    if (csv != nullptr) {
+      std::fprintf(csv, "%d,\"%s\",%.2f,%ld,%ld,%lu,%.3f\n", day,
+                   labels_[set].c_str(), r.result_.pnl_, r.result_.fills_,
+                   r.result_.volume_, r.messages_,
+                   static_cast<double>(r.wall_ns_) / base::NANOSINSECOND);
+    }
+  }
+  if (csv != nullptr) {
+    std::fclose(csv);
+  }
+  std::vector<size_t> order(params_.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&totals](size_t a, size_t b) {
+    return totals[a].result_.pnl_ > totals[b].result_.pnl_;
+  });
+  for (const auto set : order) {
+    const auto &t = totals[set];
+    const auto days = static_cast<double>(std::max<size_t>(t.days_, 1));
+    const auto mean = t.result_.pnl_ / days;
+    const auto sd =
+        std::sqrt(std::max(0.0, t.pnl_squares_ / days - mean * mean));
+    LOG_INFO("[%s] PnL %.2f, %.2f a day with sd %.2f, %ld fills of %ld lots "
+             "over %lu days",
+             labels_[set].c_str(), t.result_.pnl_, mean, sd, t.result_.fills_,
+             t.result_.volume_, t.days_);
+    if (t.failed_ > 0) {
+      LOG_WARNING("[%s] %lu of %lu days failed", labels_[set].c_str(),
+                  t.failed_, days_.size());
+    }
+  }
+  // Busy time over wall time is the number of workers kept busy on average
+  const auto seconds = static_cast<double>(wall_ns) / base::NANOSINSECOND;
+  LOG_INFO("Replayed %lu messages in %.3f s, %.0f messages/s, %.1f of %lu "
+           "workers busy",
+           messages, seconds, static_cast<double>(messages) / seconds,
+           static_cast<double>(busy_ns) / static_cast<double>(wall_ns),
+           workers_);
+}
+
+} // namespace ctptrader::app
\ No newline at end of file
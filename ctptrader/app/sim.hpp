@@ -1,5 +1,176 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <app/strategy.hpp>
+#include <core/app.hpp>
+#include <core/ctx.hpp>
+#include <core/match.hpp>
 #include <core/reader.hpp>
 
-namespace ctptrader::app {} // namespace ctptrader::app
\ No newline at end of file
+namespace ctptrader::app {
+
+/// @brief One backtest run: the readers of its sources merged in time order
+/// and the strategies they are dispatched to, on a context of its own. Runs
+/// share no state, so a sweep runs many of them at once.
+///
+/// The orders of the strategies go to a MatchEngine, which sees every book
+/// before the strategies do. Its updates are handed to the strategies before
+/// the first message at or after their time.
+class Replay {
+public:
+  /// @brief Opens the sources and loads the strategies of a sim
+  /// configuration.
+  ///
+  /// @param ctx The context of the run, initialized, with the sim clock.
+  /// @param app_config The source and stg arrays and the latency to the
+  /// exchange in microseconds.
+  /// @param channel Replaces {channel} in the source paths, the market
+  /// channel the recorder names its files after.
+  /// @param date Replaces {date} in the source paths, for runs of one day.
+  /// @return False if a source cannot be read or there are no strategies.
+  bool Init(core::Context &ctx, toml::table &app_config,
+            const std::string &channel, const std::string &date = "");
+
+  [[nodiscard]] bool Empty() { return iter_.Empty(); }
+
+  /// @brief Time in nanoseconds of the message Step dispatches.
+  [[nodiscard]] int64_t PeekTime() { return iter_.PeekTime(); }
+
+  /// @brief Moves the clock to the next message and dispatches it. Requires
+  /// !Empty().
+  void Step();
+
+  /// @brief Hands the strategies the updates still due and collects what
+  /// they made, once the run is over.
+  [[nodiscard]] core::SimResult Finish();
+
+  [[nodiscard]] uint64_t Messages() const { return messages_; }
+  [[nodiscard]] int64_t FirstTime() const { return first_ns_; }
+  [[nodiscard]] int64_t LastTime() const { return last_ns_; }
+
+private:
+  /// @brief Adds the readers of one source.
+  ///
+  /// @return False if the source cannot be read.
+  bool AddSource(toml::table &source, const std::string &channel,
+                 const std::string &date);
+
+  /// @brief Adds a reader per instrument and bar period of a tick file.
+  bool AddTickFile(const std::string &path, toml::table &source);
+
+  void Dispatch(const base::Msg &msg);
+
+  /// @brief Hands the strategies the updates of the engine due by a time.
+  void Deliver(int64_t until_ns);
+
+  core::Context *ctx_{nullptr};
+  core::MsgIter iter_;
+  std::optional<core::MatchEngine> engine_;
+  StrategySet stgs_;
+  uint64_t messages_{0};
+  int64_t first_ns_{0};
+  int64_t last_ns_{0};
+};
+
+/// @brief Backtests the strategies of the strategy role on recorded history.
+///
+/// Every source, a record file of the recorder or the instruments of a tick
+/// file, is a reader; the readers are merged in time order and each message
+/// is dispatched through the same StrategySet as live, after the simulated
+/// clock of the context is moved to it. Strategies see the same callbacks and
+/// context in both modes.
+class SimManager final : public core::IApp {
+public:
+  explicit SimManager(const std::string_view market_channel)
+      : market_channel_(market_channel) {}
+
+  bool Init(toml::table &global_config, toml::table &app_config) override;
+
+  void Run() override;
+
+private:
+  /// @brief Longest pause replayed at speed, in seconds. Longer ones, such as
+  /// the break between sessions, are skipped.
+  static constexpr int64_t kDefaultMaxPause = 60;
+
+  /// @brief Sleeps until the message at ts is due at the playback speed.
+  void Pace(int64_t ts_ns);
+
+  const std::string market_channel_;
+  Replay replay_;
+  util::ThreadOptions thread_options_;
+  double speed_{0}; // multiple of real time, 0 for as fast as possible
+  int64_t max_pause_ns_{kDefaultMaxPause * base::NANOSINSECOND};
+  int64_t sim_origin_ns_{0};  // message time paced from
+  int64_t wall_origin_ns_{0}; // CLOCK_MONOTONIC when it was replayed
+  int64_t last_ns_{0};        // time of the last message
+  bool stop_ = false;
+};
+
+/// @brief Backtests every parameter set of a grid on every trading day of a
+/// date range, in forked workers.
+///
+/// A unit of work is one trading day with one parameter set, replayed from
+/// the sources of the day, {date} in their paths, on a context and
+/// strategies of its own. Workers claim units in turn from a counter in
+/// shared memory, so a long day keeps one worker busy while the others go
+/// on, and write the result of each unit into its own slot there. Workers
+/// are processes rather than threads: strategy plugins may keep global
+/// state, and processes share no heap. The results are merged per parameter
+/// set once every worker has exited.
+class SweepManager final : public core::IApp {
+public:
+  explicit SweepManager(const std::string_view market_channel)
+      : market_channel_(market_channel) {}
+  ~SweepManager() override;
+
+  bool Init(toml::table &global_config, toml::table &app_config) override;
+
+  void Run() override;
+
+private:
+  enum UnitStatus : int32_t { kPending, kDone, kFailed };
+
+  /// @brief What a unit made, written by the worker that ran it.
+  struct alignas(64) UnitResult {
+    core::SimResult result_;
+    uint64_t messages_;
+    int64_t wall_ns_; // spent replaying
+    UnitStatus status_;
+  };
+
+  /// @brief Expands the grid table into the cartesian product of its
+  /// arrays, a scalar counts as an array of one.
+  bool LoadGrid(toml::table *grid);
+
+  /// @brief Claims and runs units until none are left, in a worker.
+  void Work(size_t worker);
+
+  void RunUnit(size_t unit, UnitResult &out);
+
+  /// @brief Logs the results per parameter set and writes every unit to the
+  /// output file.
+  void Report(int64_t wall_ns);
+
+  const std::string market_channel_;
+  std::string data_folder_;
+  toml::table config_;              // of the sweep, with the sources and stg
+  std::vector<int> days_;           // trading days, yyyymmdd
+  std::vector<toml::table> params_; // set into every stg table of a unit
+  std::vector<std::string> labels_; // of the parameter sets
+  size_t workers_{1};
+  std::vector<int> cpus_; // workers are pinned to, empty for no pinning
+  int priority_{0};
+  std::string output_; // CSV of every unit, empty for none
+  void *map_{nullptr}; // the counter and the results, shared with workers
+  size_t map_bytes_{0};
+  std::atomic<uint64_t> *next_unit_{nullptr};
+  UnitResult *results_{nullptr};
+};
+
+} // namespace ctptrader::app
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <app/recorder.hpp>
+#include <app/sim.hpp>
+
+namespace {
+
+using namespace ctptrader;
+
+constexpr char kChannel[] = "test_record_sim";
+constexpr int kDepths = 50;
+
+/// @brief Records read from a record file so far, 0 while there is none.
+size_t Recorded(const std::string &path) {
+  util::RecordReader reader;
+  if (!reader.Open(path)) {
+    return 0;
+  }
+  size_t n = 0;
+  reader.ForEach([&n](const util::RecordHeader &) { ++n; });
+  return n;
+}
+
+/// @brief Kills a forked process when the test ends, passed or not.
+struct ScopedChild {
+  ~ScopedChild() { Kill(); }
+
+  void Kill() {
+    if (pid_ > 0) {
+      kill(pid_, SIGKILL);
+      waitpid(pid_, nullptr, 0);
+      pid_ = 0;
+    }
+  }
+
+  pid_t pid_;
+};
+
+/// @brief Whether a process has attached a reader stats block to a channel.
+bool ReaderAttached(pid_t pid) {
+  const auto prefix =
+      util::StatsPrefix(kChannel) + "rx." + std::to_string(pid) + ".";
+  for (const auto &entry : std::filesystem::directory_iterator("/dev/shm")) {
+    if (entry.path().filename().string().rfind(prefix, 0) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// @brief Waits up to 10 seconds for a condition.
+template <typename F> bool WaitFor(F &&done) {
+  for (int i = 0; i < 1000; ++i) {
+    if (done()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+TEST(SimTest, ReplaysWhatWasRecorded) {
+  const auto folder =
+      std::filesystem::temp_directory_path() / "test_record_sim";
+  std::filesystem::remove_all(folder);
+  util::RemoveSegment(kChannel, {});
+  auto global_config = toml::parse(R"(
+    data_folder = "./test"
+    market_channel_capacity = 65536
+  )");
+  toml::table recorder_config;
+  recorder_config.insert("folder", folder.string());
+  recorder_config.insert("wait_policy", "spin");
+  recorder_config.insert("flush_interval", 1);
+
+  util::ShmBroadcastWriter md_tx(kChannel, 65536);
+  ScopedChild recorder{fork()};
+  ASSERT_GE(recorder.pid_, 0);
+  if (recorder.pid_ == 0) {
+    app::RecorderManager rm(kChannel);
+    if (rm.Init(global_config, recorder_config)) {
+      rm.Run();
+    }
+    _exit(1);
+  }
+  // The recorder joins at the live end of the ring
+  ASSERT_TRUE(WaitFor([&] { return ReaderAttached(recorder.pid_); }));
+  base::Depth depth{};
+  for (int i = 0; i < kDepths; ++i) {
+    depth.id_ = i % 3;
+    depth.last_ = 5000 + i;
+    depth.bid_price_[0] = depth.last_ - 1;
+    depth.ask_price_[0] = depth.last_ + 1;
+    ASSERT_TRUE(md_tx.Write(base::MsgType<base::Depth>, depth));
+  }
+
+  // One file, named <channel>.<yyyymmdd>.rec
+  std::string date;
+  ASSERT_TRUE(WaitFor([&] {
+    std::error_code ec;
+    for (const auto &entry :
+         std::filesystem::directory_iterator(folder, ec)) {
+      const auto name = entry.path().filename().string();
+      date = name.substr(std::size(kChannel), 8);
+      return Recorded(entry.path()) == kDepths;
+    }
+    return false;
+  }));
+  // Killed like a crashed recorder, the records flushed so far are kept
+  recorder.Kill();
+  util::RemoveDeadReaderStats(kChannel);
+
+  core::Context ctx;
+  ASSERT_TRUE(ctx.Init("./test"));
+  ctx.UseSimClock();
+  auto sim_config = toml::parse(R"(
+    stg = []
+    [[source]]
+    type = "record"
+  )");
+  sim_config["source"][0].as_table()->insert(
+      "path", (folder / "{channel}.{date}.rec").string());
+  app::Replay replay;
+  ASSERT_TRUE(replay.Init(ctx, sim_config, kChannel, date));
+  while (!replay.Empty()) {
+    replay.Step();
+  }
+  EXPECT_EQ(replay.Messages(), static_cast<uint64_t>(kDepths));
+  EXPECT_LE(replay.FirstTime(), replay.LastTime());
+  EXPECT_EQ(ctx.GetDepthCenter().Back(1).last_, 5000 + kDepths - 1);
+  // No strategies, no orders
+  EXPECT_EQ(replay.Finish().fills_, 0);
+
+  std::filesystem::remove_all(folder);
+  util::RemoveSegment(kChannel, {});
+}
+
+} // namespace
@@ -3,19 +3,25 @@
 
 namespace ctptrader::app {
 
-bool StrategyManager::Init(toml::table &global_config,
-                           toml::table &app_config) {
-  auto data_folder = global_config["data_folder"].value_or("");
-  if (!ctx_.Init(data_folder)) {
+bool StrategySet::Load(toml::table &app_config, core::Context &ctx,
+                       core::IOrderRouter *router) {
+  ctx_ = &ctx;
+  books_.assign(ctx.GetInstrumentCenter().Count(), base::Depth{});
+  has_book_.assign(ctx.GetInstrumentCenter().Count(), 0);
+  const auto *stg_configs = app_config["stg"].as_array();
+  if (stg_configs == nullptr) {
+    LOG_ERROR("No strategies configured");
     return false;
   }
-  for (auto &s : *app_config["stg"].as_array()) {
+  for (auto &s : *stg_configs) {
     auto stg_config = *s.as_table();
     auto name = stg_config["name"].value<std::string>();
     auto libpath = stg_config["libpath"].value<std::string>();
     if (name.has_value() && libpath.has_value()) {
       stgs_.emplace_back(name.value(), libpath.value());
-      stgs_.back().Instance().SetContext(&ctx_);
+      stgs_.back().Instance().SetContext(&ctx);
+      stgs_.back().Instance().SetOrderRouter(
+          router, static_cast<base::ID>(stgs_.size() - 1));
       stgs_.back().Instance().Init(stg_config);
       LOG_INFO("Loaded strategy: %s", name.value().c_str());
     }
@@ -23,25 +29,114 @@ bool StrategyManager::Init(toml::table &global_config,
   return true;
 }
 
+bool StrategyManager::Init(toml::table &global_config,
+                           toml::table &app_config) {
+  auto data_folder = global_config["data_folder"].value_or("");
+  if (!ctx_.Init(data_folder)) {
+    return false;
+  }
+  uint64_t channel_capacity = 0;
+  util::ShmOptions channel_options;
+  if (!LoadChannelConfig(global_config, channel_capacity, channel_options)) {
+    return false;
+  }
+  md_rx_.emplace(market_channel_, channel_capacity, channel_options);
+  if (!md_rx_->Ready()) {
+    LOG_ERROR("Market channel %s has an incompatible layout",
+              market_channel_.c_str());
+    return false;
+  }
+  std::string wait_policy = app_config["wait_policy"].value_or("spin");
+  if (const auto it = util::WaitPolicyMap.find(wait_policy);
+      it != util::WaitPolicyMap.end()) {
+    md_rx_->SetWaitPolicy(it->second);
+  } else {
+    LOG_ERROR("Unknown wait policy: %s", wait_policy.c_str());
+    return false;
+  }
+  if (!LoadThreadConfig(app_config, "strategy", thread_options_)) {
+    return false;
+  }
+  batch_size_ = app_config["batch_size"].value_or(kDefaultBatchSize);
+  if (batch_size_ == 0) {
+    LOG_ERROR("batch_size must be positive");
+    return false;
+  }
+  // With the depth cache only the newest depth of each instrument is seen,
+  // depth frames on the market channel are skipped.
+  std::string depth_source = app_config["depth_source"].value_or("stream");
+  if (depth_source == "cache") {
+    if (!global_config["market_depth_cache"].value_or(false)) {
+      LOG_ERROR("depth_source = \"cache\" requires market_depth_cache");
+      return false;
+    }
+    depth_rx_.emplace(DepthCacheName(market_channel_),
+                      ctx_.GetInstrumentCenter().Count());
+    if (!depth_rx_->Attached()) {
+      LOG_ERROR("Depth cache is incompatible or has too many readers");
+      return false;
+    }
+  } else if (depth_source != "stream") {
+    LOG_ERROR("Unknown depth source: %s", depth_source.c_str());
+    return false;
+  }
+  return stgs_.Load(app_config, ctx_);
+}
+
 void StrategyManager::Run() {
-  base::Msg msg;
+  core::SetupThread(thread_options_);
+  uint64_t overruns = 0;
+  auto generation = md_rx_->Generation();
+  auto dropped = md_rx_->Dropped();
+  const auto dispatch = [this, &dropped](const util::FrameHeader &frame) {
+    // Books that missed a message are stale, deltas wait for full depths
+    if (md_rx_->Dropped() != dropped) {
+      dropped = md_rx_->Dropped();
+      stgs_.ResetBooks();
+    }
+    switch (frame.type_) {
+    case base::MsgType<base::Static>:
+      stgs_.OnStatic(frame.As<base::Static>());
+      break;
+    case base::MsgType<base::Bar>:
+      stgs_.OnBar(frame.As<base::Bar>());
+      break;
+    case base::MsgType<base::Depth>:
+      if (!depth_rx_) {
+        stgs_.OnFullDepth(frame.As<base::Depth>());
+      }
+      break;
+    case base::MsgType<base::DepthDelta>:
+      if (!depth_rx_) {
+        stgs_.OnDepthDelta(frame.As<base::DepthDelta>());
+      }
+      break;
+    case base::MsgType<base::Balance>:
+      stgs_.OnBalance(frame.As<base::Balance>());
+      break;
+    default:
+      break;
+    }
+  };
+  const auto on_depth = [this](const base::Depth &depth) {
+    stgs_.OnDepth(depth);
+  };
+  auto *depth_rx = depth_rx_ ? &*depth_rx_ : nullptr;
   while (!stop_) {
-    if (md_rx_.Read(msg)) {
-      std::visit(
-          [this](auto &&arg) {
-            using T = std::decay_t<decltype(arg)>;
-            if constexpr (std::is_same_v<T, base::Static>) {
-              OnStatic(arg);
-            } else if constexpr (std::is_same_v<T, base::Bar>) {
-              OnBar(arg);
-            } else if constexpr (std::is_same_v<T, base::Depth>) {
-              OnDepth(arg);
-            } else if constexpr (std::is_same_v<T, base::Balance>) {
-              OnBalance(arg);
-            }
-          },
-          msg);
+    if (PollMarket(*md_rx_, batch_size_, dispatch, depth_rx, on_depth) > 0) {
+      continue;
+    }
+    if (md_rx_->Generation() != generation) {
+      generation = md_rx_->Generation();
+      stgs_.ResetBooks();
+      LOG_WARNING("Market process restarted, generation %u", generation);
+    }
+    if (md_rx_->Overruns() != overruns) {
+      overruns = md_rx_->Overruns();
+      LOG_WARNING("Market channel overrun, %lu messages dropped in total",
+                  md_rx_->Dropped());
     }
+    md_rx_->Wait();
   }
 }
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <optional>
+
 #include <core/app.hpp>
 #include <core/ctx.hpp>
 #include <core/stg.hpp>
@@ -8,23 +11,36 @@
 
 namespace ctptrader::app {
 
-class StrategyManager final : public core::IApp {
+/**
+ * @brief The strategies of a process and the books they see. Every message
+ * goes to the strategies watching it and then to the context, live and in
+ * backtest alike.
+ */
+class StrategySet {
 public:
-  explicit StrategyManager(const std::string_view market_channel)
-      : md_rx_(market_channel) {}
-
-  bool Init(toml::table &global_config, toml::table &app_config) override;
+  /**
+   * @brief Loads the strategies of the stg array of the application
+   * configuration and hands them the context. Strategies are numbered in
+   * the order of the array, the IDs stamped on their orders.
+   *
+   * @param app_config The application configuration.
+   * @param ctx The context, initialized.
+   * @param router Where the strategies send orders, nullptr for nowhere.
+   * @return False if there is no stg array.
+   */
+  bool Load(toml::table &app_config, core::Context &ctx,
+            core::IOrderRouter *router = nullptr);
 
-  void Run() override;
+  /** @brief Forgets every book, deltas wait for the next full depth. */
+  void ResetBooks() { std::fill(has_book_.begin(), has_book_.end(), 0); }
 
-private:
   void OnStatic(const base::Static &st) {
     for (auto &s : stgs_) {
       if (s.Instance().WatchesInstrument(st.id_)) {
         s.Instance().OnStatic(st);
       }
     }
-    ctx_.OnStatic(st);
+    ctx_->OnStatic(st);
   }
 
   void OnBar(const base::Bar &bar) {
@@ -33,7 +49,33 @@ private:
         s.Instance().OnBar(bar);
       }
     }
-    ctx_.OnBar(bar);
+    ctx_->OnBar(bar);
+  }
+
+  /// @brief Keeps the book of the instrument for DepthDelta to apply to.
+  void OnFullDepth(const base::Depth &depth) {
+    books_[depth.id_] = depth;
+    has_book_[depth.id_] = 1;
+    OnDepth(depth);
+  }
+
+  /// @brief Rebuilds the depth from the last book of the instrument. Deltas
+  /// are dropped until a full depth arrives when there is no book yet.
+  void OnDepthDelta(const base::DepthDelta &delta) {
+    if (const auto *depth = Rebuild(delta)) {
+      OnDepth(*depth);
+    }
+  }
+
+  /// @brief Applies a delta to the last book of the instrument.
+  ///
+  /// @return The book, nullptr if there is none yet.
+  [[nodiscard]] const base::Depth *Rebuild(const base::DepthDelta &delta) {
+    if (has_book_[delta.id_] == 0) {
+      return nullptr;
+    }
+    base::ApplyDepthDelta(delta, books_[delta.id_]);
+    return &books_[delta.id_];
   }
 
   void OnDepth(const base::Depth &depth) {
@@ -42,7 +84,7 @@ private:
         s.Instance().OnDepth(depth);
       }
     }
-    ctx_.OnDepth(depth);
+    ctx_->OnDepth(depth);
   }
 
   void OnBalance(const base::Balance &bal) {
@@ -51,12 +93,76 @@ private:
         s.Instance().OnBalance(bal);
       }
     }
-    ctx_.OnBalance(bal);
+    ctx_->OnBalance(bal);
+  }
+
+  /** @brief Hands an update of an order to the strategy that sent it. */
+  void OnOrderUpdate(base::ID strategy_id, const base::OrderUpdate &update) {
+    stgs_[strategy_id].Instance().OnOrderUpdate(update);
+  }
+
+  void OnTrade(base::ID strategy_id, const base::Trade &trade) {
+    stgs_[strategy_id].Instance().OnTrade(trade);
+  }
+
+  /** @brief Collects what every strategy made at the end of a backtest. */
+  void OnSimEnd(core::SimResult &result) {
+    for (auto &s : stgs_) {
+      s.Instance().OnSimEnd(result);
+    }
   }
 
 private:
-  util::ShmSpscReader<base::Msg, 20> md_rx_;
+  core::Context *ctx_{nullptr};
+  std::vector<base::Depth> books_;
+  std::vector<int> has_book_;
   std::vector<util::Proxy<core::IStrategy>> stgs_;
+};
+
+/**
+ * @brief One pass over the market channel and the depth cache: a batch of
+ * frames, then every instrument whose depth changed since the last pass. The
+ * cache is drained after every batch, so a busy channel cannot starve it.
+ *
+ * @param md_rx The market channel.
+ * @param batch_size Frames handled at most.
+ * @param on_frame Called with every frame.
+ * @param depth_rx The depth cache, nullptr without one.
+ * @param on_depth Called with the newest depth of every changed instrument.
+ * @return The number of frames and depths handled, 0 if both were empty.
+ */
+template <typename FrameFn, typename DepthFn>
+size_t PollMarket(util::ShmBroadcastReader &md_rx, uint64_t batch_size,
+                  FrameFn &&on_frame,
+                  util::ShmConflatedReader<base::Depth> *depth_rx,
+                  DepthFn &&on_depth) {
+  auto handled = md_rx.ReadBatch(batch_size, on_frame);
+  if (depth_rx != nullptr) {
+    handled += depth_rx->Drain(
+        [&on_depth](uint64_t, const base::Depth &depth) { on_depth(depth); });
+  }
+  return handled;
+}
+
+class StrategyManager final : public core::IApp {
+public:
+  explicit StrategyManager(const std::string_view market_channel)
+      : market_channel_(market_channel) {}
+
+  bool Init(toml::table &global_config, toml::table &app_config) override;
+
+  void Run() override;
+
+private:
+  /// @brief Frames handled per pass over the market channel.
+  static constexpr uint64_t kDefaultBatchSize = 64;
+
+  const std::string market_channel_;
+  uint64_t batch_size_{kDefaultBatchSize};
+  util::ThreadOptions thread_options_;
+  std::optional<util::ShmBroadcastReader> md_rx_;
+  std::optional<util::ShmConflatedReader<base::Depth>> depth_rx_;
+  StrategySet stgs_;
   bool stop_ = false;
 };
 
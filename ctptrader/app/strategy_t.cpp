@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <app/strategy.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::util;
+
+/// @brief Channel segments outlive their endpoints, so every test removes
+/// its segment before and after running.
+struct ScopedSegment {
+  explicit ScopedSegment(const std::string &name)
+      : name_(name) {
+    RemoveSegment(name_, {});
+  }
+  ~ScopedSegment() { RemoveSegment(name_, {}); }
+
+  const std::string name_;
+};
+
+TEST(PollMarketTest, BusyChannelDoesNotStarveCache) {
+  constexpr char kChannel[] = "test_poll_market";
+  constexpr uint64_t kCapacity = 1 << 20;
+  constexpr uint64_t kInstruments = 4;
+  constexpr size_t kBatch = 8;
+  constexpr int kRounds = 100;
+  const auto cache_name = std::string(kChannel) + ".depth";
+  ScopedSegment ring(kChannel);
+  ScopedSegment cache(cache_name);
+
+  ShmBroadcastWriter md_tx(kChannel, kCapacity);
+  ShmBroadcastReader md_rx(kChannel, kCapacity);
+  ShmConflatedWriter<base::Depth> depth_tx(cache_name, kInstruments);
+  ShmConflatedReader<base::Depth> depth_rx(cache_name, kInstruments);
+  ASSERT_TRUE(depth_rx.Attached());
+
+  size_t frames = 0;
+  std::vector<base::Depth> depths;
+  const auto on_frame = [&frames](const FrameHeader &) { ++frames; };
+  const auto on_depth = [&depths](const base::Depth &depth) {
+    depths.push_back(depth);
+  };
+  base::Bar bar{};
+  base::Depth depth{};
+  for (int round = 0; round < kRounds; ++round) {
+    // The ring always holds more than a batch
+    for (size_t i = 0; i < 2 * kBatch; ++i) {
+      ASSERT_TRUE(md_tx.Write(base::MsgType<base::Bar>, bar));
+    }
+    depth.id_ = round % kInstruments;
+    depth.last_ = round;
+    ASSERT_TRUE(depth_tx.Write(depth.id_, depth));
+    depths.clear();
+    EXPECT_EQ(app::PollMarket(md_rx, kBatch, on_frame, &depth_rx, on_depth),
+              kBatch + 1);
+    ASSERT_EQ(depths.size(), 1U);
+    EXPECT_EQ(depths[0].last_, round);
+  }
+  EXPECT_EQ(frames, kRounds * kBatch);
+  EXPECT_FALSE(md_rx.Empty());
+  EXPECT_EQ(md_rx.Overruns(), 0U);
+}
+
+} // namespace
@@ -1,96 +1,105 @@
-#include "trade.hpp"
 #include <app/trade.hpp>
 
 namespace ctptrader::app {
 
 void TraderSpi::OnFrontConnected() {
-  ctx_->Logger()->info("Connected to trade front. Sending login request.");
+  LOG_INFO("Connected to trade front. Sending login request.");
   CThostFtdcReqUserLoginField req;
   memset(&req, 0, sizeof(req));
   strcpy(req.BrokerID, broker_id_.c_str());
   strcpy(req.UserID, user_id_.c_str());
   strcpy(req.Password, password_.c_str());
   if (api_->ReqUserLogin(&req, 0) != 0) {
-    ctx_->Logger()->error("Sending login request failed");
+    LOG_ERROR("Sending login request failed");
   } else {
-    ctx_->Logger()->info("Sending login request succeeded");
+    LOG_INFO("Sending login request succeeded");
   }
 }
 
 void TraderSpi::OnFrontDisconnected(int nReason) {
-  ctx_->Logger()->info("Disconnected from trade front, reason: {}", nReason);
+  LOG_INFO("Disconnected from trade front, reason: %d", nReason);
 }
 
 void TraderSpi::OnHeartBeatWarning(int nTimeLapse) {
-  ctx_->Logger()->info("Heartbeat warning, time lapse: {}", nTimeLapse);
+  LOG_INFO("Heartbeat warning, time lapse: %d", nTimeLapse);
 }
 
-void TraderSpi::OnRspUserLogin(CThostFtdcRspUserLoginField *pRspUserLogin,
-                               CThostFtdcRspInfoField *pRspInfo, int nRequestID,
-                               bool bIsLast) {
+void TraderSpi::OnRspUserLogin(
+    [[maybe_unused]] CThostFtdcRspUserLoginField *pRspUserLogin,
+    CThostFtdcRspInfoField *pRspInfo, [[maybe_unused]] int nRequestID,
+    [[maybe_unused]] bool bIsLast) {
   if (pRspInfo->ErrorID == 0) {
-
-    ctx_->Logger()->info("Login succeeded. Confirming settlement info");
+    LOG_INFO("Login succeeded. Confirming settlement info");
     CThostFtdcSettlementInfoConfirmField req;
     memset(&req, 0, sizeof(req));
     strcpy(req.BrokerID, broker_id_.c_str());
     strcpy(req.InvestorID, user_id_.c_str());
     if (api_->ReqSettlementInfoConfirm(&req, 0) != 0) {
-      ctx_->Logger()->error("Sending settlement info confirm request failed");
+      LOG_ERROR("Sending settlement info confirm request failed");
     } else {
-      ctx_->Logger()->info("Sending settlement info confirm request succeeded");
+      LOG_INFO("Sending settlement info confirm request succeeded");
     }
   } else {
-    ctx_->Logger()->error("Login failed, error id: {}, error message: {}",
-                          pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+    LOG_ERROR("Login failed, error id: %d, error message: %s",
+              pRspInfo->ErrorID, pRspInfo->ErrorMsg);
   }
 }
 
-void TraderSpi::OnRspUserLogout(CThostFtdcUserLogoutField *pUserLogout,
-                                CThostFtdcRspInfoField *pRspInfo,
-                                int nRequestID, bool bIsLast) {
+void TraderSpi::OnRspUserLogout(
+    [[maybe_unused]] CThostFtdcUserLogoutField *pUserLogout,
+    CThostFtdcRspInfoField *pRspInfo, [[maybe_unused]] int nRequestID,
+    [[maybe_unused]] bool bIsLast) {
   if (pRspInfo->ErrorID == 0) {
-    ctx_->Logger()->info("Logout succeeded");
+    LOG_INFO("Logout succeeded");
   } else {
-    ctx_->Logger()->error("Logout failed, error id: {}, error message: {}",
-
-                          pRspInfo->ErrorID, pRspInfo->ErrorMsg);
+    LOG_ERROR("Logout failed, error id: %d, error message: %s",
+              pRspInfo->ErrorID, pRspInfo->ErrorMsg);
   }
 }
 
 void TraderSpi::OnRspSettlementInfoConfirm(
-    CThostFtdcSettlementInfoConfirmField *pSettlementInfoConfirm,
-    CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {}
+    [[maybe_unused]] CThostFtdcSettlementInfoConfirmField
+        *pSettlementInfoConfirm,
+    [[maybe_unused]] CThostFtdcRspInfoField *pRspInfo,
+    [[maybe_unused]] int nRequestID, [[maybe_unused]] bool bIsLast) {}
 
 void TraderSpi::OnRspQryTradingAccount(
     CThostFtdcTradingAccountField *pTradingAccount,
-    CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {
+    [[maybe_unused]] CThostFtdcRspInfoField *pRspInfo,
+    [[maybe_unused]] int nRequestID, [[maybe_unused]] bool bIsLast) {
   base::Balance balance{
-      ctx_->AccountCenter().GetID(pTradingAccount->AccountID),
-      pTradingAccount->Available,
+      ctx_->GetAccountCenter().GetID(pTradingAccount->AccountID),
       pTradingAccount->Balance,
+      pTradingAccount->Available,
       pTradingAccount->CurrMargin,
       pTradingAccount->FrozenMargin,
   };
   if (!tx_.Write(balance)) {
-    ctx_->Logger()->error("Write balance failed");
+    LOG_ERROR("Write balance failed");
   }
 }
 
 void TraderSpi::OnRspQryInvestorPosition(
-    CThostFtdcInvestorPositionField *pInvestorPosition,
-    CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {}
+    [[maybe_unused]] CThostFtdcInvestorPositionField *pInvestorPosition,
+    [[maybe_unused]] CThostFtdcRspInfoField *pRspInfo,
+    [[maybe_unused]] int nRequestID, [[maybe_unused]] bool bIsLast) {}
 
-void TraderSpi::OnRspOrderInsert(CThostFtdcInputOrderField *pInputOrder,
-                                 CThostFtdcRspInfoField *pRspInfo,
-                                 int nRequestID, bool bIsLast) {}
+void TraderSpi::OnRspOrderInsert(
+    [[maybe_unused]] CThostFtdcInputOrderField *pInputOrder,
+    [[maybe_unused]] CThostFtdcRspInfoField *pRspInfo,
+    [[maybe_unused]] int nRequestID, [[maybe_unused]] bool bIsLast) {}
 
 void TraderSpi::OnRspOrderAction(
-    CThostFtdcInputOrderActionField *pInputOrderAction,
-    CThostFtdcRspInfoField *pRspInfo, int nRequestID, bool bIsLast) {}
-
-void TraderSpi::OnRspError(CThostFtdcRspInfoField *pRspInfo, int nRequestID,
-                           bool bIsLast) {}
+    [[maybe_unused]] CThostFtdcInputOrderActionField *pInputOrderAction,
+    [[maybe_unused]] CThostFtdcRspInfoField *pRspInfo,
+    [[maybe_unused]] int nRequestID, [[maybe_unused]] bool bIsLast) {}
+
+void TraderSpi::OnRspError(CThostFtdcRspInfoField *pRspInfo,
+                           [[maybe_unused]] int nRequestID,
+                           [[maybe_unused]] bool bIsLast) {
+  LOG_ERROR("Error, error id: %d, error message: %s", pRspInfo->ErrorID,
+            pRspInfo->ErrorMsg);
+}
 
 void TraderSpi::OnMsg(base::Msg &msg) {
   std::visit(
@@ -105,17 +114,19 @@ void TraderSpi::OnMsg(base::Msg &msg) {
       msg);
 }
 
-void TraderSpi::OnRtnOrder(CThostFtdcOrderField *pOrder) {}
+void TraderSpi::OnRtnOrder([[maybe_unused]] CThostFtdcOrderField *pOrder) {}
 
-void TraderSpi::OnRtnTrade(CThostFtdcTradeField *pTrade) {}
+void TraderSpi::OnRtnTrade([[maybe_unused]] CThostFtdcTradeField *pTrade) {}
 
-void TraderSpi::OnNewOrder(base::NewOrder &req) {
+void TraderSpi::OnNewOrder([[maybe_unused]] base::NewOrder &req) {
   CThostFtdcInputOrderField order;
+  memset(&order, 0, sizeof(order));
   api_->ReqOrderInsert(&order, 0);
 }
 
-void TraderSpi::OnCancelOrder(base::CancelOrder &req) {
+void TraderSpi::OnCancelOrder([[maybe_unused]] base::CancelOrder &req) {
   CThostFtdcInputOrderActionField order;
+  memset(&order, 0, sizeof(order));
   api_->ReqOrderAction(&order, 0);
 }
 
@@ -128,24 +139,40 @@ bool TradeManager::Init(toml::table &global_config, toml::table &app_config) {
   user_id_ = app_config["user_id"].value_or("");
   password_ = app_config["password"].value_or("");
   trade_front_ = app_config["front"].value_or("");
+  std::string wait_policy = app_config["wait_policy"].value_or("spin");
+  if (const auto it = util::WaitPolicyMap.find(wait_policy);
+      it != util::WaitPolicyMap.end()) {
+    wait_policy_ = it->second;
+  } else {
+    LOG_ERROR("Unknown wait policy: %s", wait_policy.c_str());
+    return false;
+  }
+  if (!LoadThreadConfig(app_config, "trade_reader", thread_options_)) {
+    return false;
+  }
   if (broker_id_.empty() || user_id_.empty() || password_.empty() ||
       trade_front_.empty()) {
+    LOG_ERROR("broker_id, user_id, password and front are required");
     return false;
   }
-  return false;
+  return true;
 }
 
 void TradeManager::Run() {
-  auto front_address = fmt::format("tcp://{}", trade_front_);
+  auto front_address = "tcp://" + trade_front_;
   CThostFtdcTraderApi *api = CThostFtdcTraderApi::CreateFtdcTraderApi();
   TraderSpi spi(&ctx_, api, rsp_channel_, broker_id_, user_id_, password_);
 
   std::thread t([&]() {
+    core::SetupThread(thread_options_);
     util::ShmSpscReader<base::Msg, 20> rx(rsp_channel_);
+    rx.SetWaitPolicy(wait_policy_);
     base::Msg msg;
     while (!stop_) {
       if (rx.Read(msg)) {
         spi.OnMsg(msg);
+      } else {
+        rx.Wait();
       }
     }
   });
@@ -155,6 +182,8 @@ void TradeManager::Run() {
   api->Init();
   api->Join();
   api->Release();
+  stop_ = true;
+  t.join();
 }
 
 } // namespace ctptrader::app
\ No newline at end of file
@@ -2,10 +2,13 @@
 
 #include <ThostFtdcTraderApi.h>
 
+#include <atomic>
+
 #include <base/msg.hpp>
 #include <core/app.hpp>
 #include <core/ctx.hpp>
 #include <util/channel.hpp>
+#include <util/thread.hpp>
 
 namespace ctptrader::app {
 class TraderSpi : public CThostFtdcTraderSpi {
@@ -97,7 +100,9 @@ private:
   std::string user_id_;
   std::string password_;
   std::string trade_front_;
-  bool stop_ = false;
+  util::WaitPolicy wait_policy_{util::WaitPolicy::BusySpin};
+  util::ThreadOptions thread_options_;
+  std::atomic<bool> stop_ = false;
 };
 
 } // namespace ctptrader::app
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+#include <base/def.hpp>
+#include <base/timestamp.hpp>
+
+namespace ctptrader::base {
+
+/// @brief Turns the exchange time of a CTP tick into a Timestamp without
+/// strptime or mktime.
+///
+/// The day of a tick is its ActionDay, except during the night session on DCE
+/// and CZCE: DCE sends the next trading day as the ActionDay and CZCE does not
+/// roll it at midnight. Those ticks take their day from the local clock
+/// instead, the day whose midnight is closest to the tick, which is correct
+/// across midnight and over the weekend as long as the clock is within 12
+/// hours of the exchange.
+class ExchangeClock {
+public:
+  /**
+   * @brief Resolves the time of a tick.
+   *
+   * @param exchange The exchange of the instrument.
+   * @param action_day The "YYYYMMDD" ActionDay field.
+   * @param update_time The "HH:MM:SS" UpdateTime field.
+   * @param millis The UpdateMillisec field.
+   * @param now Local time in seconds since the epoch, only used for night
+   * ticks of DCE and CZCE.
+   * @return The timestamp, or an empty one if a field is malformed.
+   */
+  Timestamp Resolve(Exchange exchange, const char *action_day,
+                    const char *update_time, int millis, time_t now) {
+    const auto seconds = Timestamp::ParseTimeOfDay(update_time);
+    if (seconds < 0) {
+      return Timestamp{0, 0};
+    }
+    time_t midnight;
+    if (IsNight(seconds) &&
+        (exchange == Exchange_DCE || exchange == Exchange_CZCE)) {
+      midnight = NearestMidnight(seconds, now);
+    } else {
+      midnight = ActionMidnight(action_day);
+      if (midnight < 0) {
+        return Timestamp{0, 0};
+      }
+    }
+    return Timestamp{midnight + seconds, millis * NANOSINMILLI};
+  }
+
+  /// @brief Night session ticks, including the auctions before it opens.
+  static bool IsNight(int seconds) {
+    return seconds >= 18 * 3600 || seconds < 6 * 3600;
+  }
+
+  /// @brief Start of the China Standard Time day that puts a tick at seconds
+  /// past midnight closest to now.
+  static time_t NearestMidnight(int seconds, time_t now) {
+    auto midnight =
+        (now + CSTOFFSET) / SECONDSINDAY * SECONDSINDAY - CSTOFFSET;
+    const auto ahead = seconds - (now - midnight);
+    if (ahead > SECONDSINDAY / 2) {
+      midnight -= SECONDSINDAY;
+    } else if (ahead < -SECONDSINDAY / 2) {
+      midnight += SECONDSINDAY;
+    }
+    return midnight;
+  }
+
+private:
+  /// @brief Midnight of the ActionDay, parsed only when the field changes.
+  time_t ActionMidnight(const char *action_day) {
+    uint64_t key;
+    memcpy(&key, action_day, sizeof(key));
+    if (key != action_day_) {
+      const auto date = Timestamp::ParseDate(action_day);
+      if (date < 0) {
+        return -1;
+      }
+      action_day_ = key;
+      action_midnight_ = Timestamp::CstMidnight(date);
+    }
+    return action_midnight_;
+  }
+
+  // An empty field maps to -1 without being parsed
+  uint64_t action_day_{0};
+  time_t action_midnight_{-1};
+};
+
+} // namespace ctptrader::base
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <base/clock.hpp>
+
+namespace {
+
+using namespace ctptrader::base;
+
+/// @brief Seconds since the epoch of a China Standard Time wall clock time.
+time_t Cst(int yyyymmdd, int h, int m, int s) {
+  return Timestamp::CstMidnight(yyyymmdd) + h * 3600 + m * 60 + s;
+}
+
+TEST(ExchangeClockTest, DaySession) {
+  ExchangeClock clock;
+  for (auto exchange : {Exchange_SHFE, Exchange_DCE, Exchange_CZCE}) {
+    const auto ts = clock.Resolve(exchange, "20231103", "10:15:30", 500,
+                                  Cst(20231103, 10, 15, 31));
+    EXPECT_EQ(ts.tv_sec, Cst(20231103, 10, 15, 30));
+    EXPECT_EQ(ts.tv_nsec, 500 * NANOSINMILLI);
+  }
+}
+
+TEST(ExchangeClockTest, ShfeNight) {
+  // Friday night, SHFE sends the calendar day as the action day
+  ExchangeClock clock;
+  auto ts = clock.Resolve(Exchange_SHFE, "20231103", "21:00:01", 0,
+                          Cst(20231103, 21, 0, 1));
+  EXPECT_EQ(ts.tv_sec, Cst(20231103, 21, 0, 1));
+  ts = clock.Resolve(Exchange_SHFE, "20231104", "00:30:00", 0,
+                     Cst(20231104, 0, 30, 0));
+  EXPECT_EQ(ts.tv_sec, Cst(20231104, 0, 30, 0));
+}
+
+TEST(ExchangeClockTest, DceNight) {
+  // Friday night, DCE sends Monday as the action day
+  ExchangeClock clock;
+  auto ts = clock.Resolve(Exchange_DCE, "20231106", "21:00:01", 0,
+                          Cst(20231103, 21, 0, 1));
+  EXPECT_EQ(ts.tv_sec, Cst(20231103, 21, 0, 1));
+  // Received just after midnight
+  ts = clock.Resolve(Exchange_DCE, "20231106", "23:59:59", 500,
+                     Cst(20231104, 0, 0, 0));
+  EXPECT_EQ(ts.tv_sec, Cst(20231103, 23, 59, 59));
+  // Local clock a little behind the exchange
+  ts = clock.Resolve(Exchange_DCE, "20231106", "00:00:01", 0,
+                     Cst(20231103, 23, 59, 58));
+  EXPECT_EQ(ts.tv_sec, Cst(20231104, 0, 0, 1));
+  ts = clock.Resolve(Exchange_DCE, "20231106", "02:29:59", 0,
+                     Cst(20231104, 2, 30, 0));
+  EXPECT_EQ(ts.tv_sec, Cst(20231104, 2, 29, 59));
+}
+
+TEST(ExchangeClockTest, CzceNight) {
+  ExchangeClock clock;
+  const auto ts = clock.Resolve(Exchange_CZCE, "20231103", "22:59:59", 0,
+                                Cst(20231103, 23, 0, 0));
+  EXPECT_EQ(ts.tv_sec, Cst(20231103, 22, 59, 59));
+}
+
+TEST(ExchangeClockTest, Malformed) {
+  ExchangeClock clock;
+  const auto now = Cst(20231103, 10, 0, 0);
+  // CTP fields are 9 bytes long
+  const char short_time[9] = "10:00";
+  const char no_day[9] = "";
+  EXPECT_TRUE(
+      clock.Resolve(Exchange_SHFE, "20231103", short_time, 0, now).IsEmpty());
+  EXPECT_TRUE(clock.Resolve(Exchange_SHFE, no_day, "10:00:00", 0, now)
+                  .IsEmpty());
+}
+
+} // namespace
@@ -1 +1,68 @@
-#include <base/msg.hpp>
\ No newline at end of file
+#include <base/msg.hpp>
+
+namespace ctptrader::base {
+
+namespace {
+
+/// @brief Appends the level if it changed, false once the delta is full.
+bool AddLevel(const Price *prev_price, const Volume *prev_volume,
+              const Price *price, const Volume *volume, BookSide side,
+              uint8_t index, DepthDelta &delta) {
+  if (prev_price[index] == price[index] &&
+      prev_volume[index] == volume[index]) {
+    return true;
+  }
+  if (delta.count_ == kMaxDeltaLevels) {
+    return false;
+  }
+  delta.levels_[delta.count_++] = {price[index], volume[index], side, index};
+  return true;
+}
+
+} // namespace
+
+bool MakeDepthDelta(const Depth &prev, const Depth &cur, DepthDelta &delta) {
+  delta.update_time_ = cur.update_time_;
+  delta.id_ = cur.id_;
+  delta.open_ = cur.open_;
+  delta.high_ = cur.high_;
+  delta.low_ = cur.low_;
+  delta.last_ = cur.last_;
+  delta.open_interest_ = cur.open_interest_;
+  delta.turnover_ = cur.turnover_;
+  delta.volume_ = cur.volume_;
+  delta.count_ = 0;
+  for (uint8_t i = 0; i < kBookLevels; ++i) {
+    if (!AddLevel(prev.ask_price_, prev.ask_volume_, cur.ask_price_,
+                  cur.ask_volume_, BookSide_Ask, i, delta) ||
+        !AddLevel(prev.bid_price_, prev.bid_volume_, cur.bid_price_,
+                  cur.bid_volume_, BookSide_Bid, i, delta)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ApplyDepthDelta(const DepthDelta &delta, Depth &depth) {
+  depth.update_time_ = delta.update_time_;
+  depth.id_ = delta.id_;
+  depth.open_ = delta.open_;
+  depth.high_ = delta.high_;
+  depth.low_ = delta.low_;
+  depth.last_ = delta.last_;
+  depth.open_interest_ = delta.open_interest_;
+  depth.turnover_ = delta.turnover_;
+  depth.volume_ = delta.volume_;
+  for (uint32_t i = 0; i < delta.count_; ++i) {
+    const auto &level = delta.levels_[i];
+    if (level.side_ == BookSide_Ask) {
+      depth.ask_price_[level.index_] = level.price_;
+      depth.ask_volume_[level.index_] = level.volume_;
+    } else {
+      depth.bid_price_[level.index_] = level.price_;
+      depth.bid_volume_[level.index_] = level.volume_;
+    }
+  }
+}
+
+} // namespace ctptrader::base
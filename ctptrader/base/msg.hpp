@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <type_traits>
 #include <variant>
 
@@ -17,17 +20,33 @@ static_assert(sizeof(Session) == 8);
 
 struct alignas(8) Bar {
   Date trading_day_;      // +4 bytes
-  Timestamp update_time_; // +16 bytes
+  Timestamp update_time_; // +16 bytes, end of the interval
   InstrumentID id_;       // +4 bytes
   Price open_;            // +8 bytes
   Price high_;            // +8 bytes
   Price low_;             // +8 bytes
   Price close_;           // +8 bytes
   Volume volume_;         // +4 bytes
+  int32_t period_;        // +4 bytes, length of the interval in seconds
   Money turnover_;        // +8 bytes
 };
 static_assert(sizeof(Bar) == 80);
 
+/// @brief Bar periods in seconds that are built and kept
+constexpr int32_t kBarPeriods[] = {1, 60, 300};
+
+constexpr int32_t kDefaultBarPeriod = 60;
+
+/// @brief Position of a period in kBarPeriods, -1 if it is not built.
+constexpr int BarPeriodIndex(int32_t period) {
+  for (int i = 0; i < static_cast<int>(std::size(kBarPeriods)); ++i) {
+    if (kBarPeriods[i] == period) {
+      return i;
+    }
+  }
+  return -1;
+}
+
 struct alignas(8) Static {
   Date trading_day_;  // +4 bytes
   InstrumentID id_;   // +4 bytes
@@ -54,6 +73,64 @@ struct alignas(8) Depth {
 };
 static_assert(sizeof(Depth) == 200);
 
+/// @brief Number of book levels in a Depth
+constexpr int kBookLevels = 5;
+
+enum BookSide : uint8_t { BookSide_Ask, BookSide_Bid };
+
+struct alignas(8) BookLevel {
+  Price price_;   // +8 bytes
+  Volume volume_; // +4 bytes
+  BookSide side_; // +1 bytes
+  uint8_t index_; // +1 bytes, 0 is the best level
+};
+static_assert(sizeof(BookLevel) == 16);
+
+/// @brief Most book levels a DepthDelta carries. With more changes a full
+/// Depth is about as small, so one is sent instead.
+constexpr uint32_t kMaxDeltaLevels = 7;
+
+/// @brief The changes of a Depth against the previous Depth of the same
+/// instrument: every scalar field and only the book levels that changed. Only
+/// the first count_ levels are sent, see DepthDeltaSize.
+struct alignas(8) DepthDelta {
+  Timestamp update_time_;             // +16 bytes
+  InstrumentID id_;                   // +8 bytes
+  Price open_;                        // +8 bytes
+  Price high_;                        // +8 bytes
+  Price low_;                         // +8 bytes
+  Price last_;                        // +8 bytes
+  LargeVolume open_interest_;         // +8 bytes
+  Money turnover_;                    // +8 bytes
+  Volume volume_;                     // +4 bytes
+  uint32_t count_;                    // +4 bytes
+  BookLevel levels_[kMaxDeltaLevels]; // +112 bytes
+};
+static_assert(sizeof(DepthDelta) <= sizeof(Depth));
+
+/// @brief Bytes of a DepthDelta up to and including its last used level.
+constexpr uint16_t DepthDeltaSize(const DepthDelta &delta) {
+  return static_cast<uint16_t>(offsetof(DepthDelta, levels_) +
+                               delta.count_ * sizeof(BookLevel));
+}
+
+/**
+ * @brief Builds the delta that turns prev into cur.
+ *
+ * @param prev The previous depth of the instrument.
+ * @param cur The current depth of the instrument.
+ * @param delta The delta to fill.
+ * @return False if more than kMaxDeltaLevels levels changed, cur should be sent
+ * in full then.
+ */
+bool MakeDepthDelta(const Depth &prev, const Depth &cur, DepthDelta &delta);
+
+/**
+ * @brief Applies a delta made by MakeDepthDelta to the depth it was made
+ * against.
+ */
+void ApplyDepthDelta(const DepthDelta &delta, Depth &depth);
+
 struct alignas(8) Balance {
   AccountID id_;        // +4 bytes
   Money balance_;       // +8 bytes
@@ -102,7 +179,20 @@ struct alignas(8) Trade {
 static_assert(sizeof(Trade) == 40);
 
 using Msg = std::variant<Bar, Static, Depth, Balance, NewOrder, CancelOrder,
-                         OrderUpdate, Trade>;
+                         OrderUpdate, Trade, DepthDelta>;
 static_assert(std::is_trivially_copyable_v<Msg>);
 
+template <typename T, typename... Ts>
+constexpr uint16_t IndexOf(const std::variant<Ts...> *) {
+  uint16_t i = 0;
+  [[maybe_unused]] const bool found =
+      ((std::is_same_v<T, Ts> || (++i, false)) || ...);
+  return i;
+}
+
+/// @brief Index of T in Msg, used as the frame type on framed channels
+template <typename T>
+constexpr uint16_t MsgType = IndexOf<T>(static_cast<const Msg *>(nullptr));
+static_assert(MsgType<Bar> == 0 && MsgType<Trade> == 7);
+
 } // namespace ctptrader::base
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include <base/msg.hpp>
+
+namespace {
+
+using namespace ctptrader::base;
+
+Depth MakeBook() {
+  Depth depth{};
+  depth.id_ = 3;
+  depth.last_ = 68000;
+  depth.volume_ = 100;
+  for (int i = 0; i < kBookLevels; ++i) {
+    depth.ask_price_[i] = 68010 + 10 * i;
+    depth.bid_price_[i] = 67990 - 10 * i;
+    depth.ask_volume_[i] = 5 + i;
+    depth.bid_volume_[i] = 7 + i;
+  }
+  return depth;
+}
+
+TEST(DepthDeltaTest, TopOfBook) {
+  const auto prev = MakeBook();
+  auto cur = prev;
+  cur.last_ = 68010;
+  cur.volume_ = 103;
+  cur.ask_volume_[0] = 2;
+  cur.bid_volume_[0] = 9;
+  DepthDelta delta;
+  ASSERT_TRUE(MakeDepthDelta(prev, cur, delta));
+  ASSERT_EQ(delta.count_, 2U);
+  EXPECT_EQ(delta.levels_[0].side_, BookSide_Ask);
+  EXPECT_EQ(delta.levels_[1].side_, BookSide_Bid);
+  EXPECT_EQ(DepthDeltaSize(delta),
+            offsetof(DepthDelta, levels_) + 2 * sizeof(BookLevel));
+  auto book = prev;
+  ApplyDepthDelta(delta, book);
+  EXPECT_EQ(std::memcmp(&book, &cur, sizeof(Depth)), 0);
+}
+
+TEST(DepthDeltaTest, Unchanged) {
+  const auto prev = MakeBook();
+  DepthDelta delta;
+  ASSERT_TRUE(MakeDepthDelta(prev, prev, delta));
+  EXPECT_EQ(delta.count_, 0U);
+}
+
+TEST(DepthDeltaTest, BookShift) {
+  const auto prev = MakeBook();
+  auto cur = prev;
+  for (int i = 0; i < kBookLevels; ++i) {
+    cur.ask_price_[i] += 10;
+    cur.bid_price_[i] += 10;
+  }
+  DepthDelta delta;
+  EXPECT_FALSE(MakeDepthDelta(prev, cur, delta));
+  // Within the limit every level round trips
+  cur = prev;
+  for (int i = 0; i < 3; ++i) {
+    cur.ask_price_[i + 2] += 10;
+    cur.bid_volume_[i + 1] += 1;
+  }
+  cur.bid_price_[4] = 0;
+  ASSERT_TRUE(MakeDepthDelta(prev, cur, delta));
+  EXPECT_EQ(delta.count_, kMaxDeltaLevels);
+  auto book = prev;
+  ApplyDepthDelta(delta, book);
+  EXPECT_EQ(std::memcmp(&book, &cur, sizeof(Depth)), 0);
+}
+
+} // namespace
@@ -12,6 +12,8 @@ struct Underlying {
   Mutiple multiple_;
   Volume lot_size_;
   Price tick_size_;
+  /// @brief HHMM the night session ends, e.g. 2300 or 230, 0 without one
+  int night_end_;
 };
 
 struct Instrument {
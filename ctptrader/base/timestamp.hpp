@@ -1,6 +1,8 @@
 #pragma once
 
+#include <bit>
 #include <compare>
+#include <cstdint>
 #include <cstring>
 #include <ctime>
 #include <string>
@@ -16,6 +18,9 @@ static constexpr long MILLISINSECOND = 1000L;
 static constexpr long NANOSINMILLI = 1000000L;
 static constexpr long MICROSINMILLI = 1000L;
 static constexpr long NANOSINMICRO = 1000L;
+static constexpr long SECONDSINDAY = 86400L;
+/// @brief Exchange times are China Standard Time, UTC+8 all year round.
+static constexpr long CSTOFFSET = 8 * 3600L;
 
 class Timestamp : public timespec {
 public:
@@ -26,30 +31,36 @@ public:
   }
 
   [[nodiscard]] std::string ToDate() const {
-    char buf[32];
+    char buf[64];
     struct tm t;
     localtime_r(&tv_sec, &t);
-    sprintf(buf, "%04d-%02d-%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d", t.tm_year + 1900,
+             t.tm_mon + 1, t.tm_mday);
     return buf;
   }
 
   [[nodiscard]] std::string ToTime() const {
-    char buf[32];
+    char buf[64];
     struct tm t;
     localtime_r(&tv_sec, &t);
-    sprintf(buf, "%02d:%02d:%02d.%03ld", t.tm_hour, t.tm_min, t.tm_sec,
-            tv_nsec / NANOSINMILLI);
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d.%03ld", t.tm_hour, t.tm_min,
+             t.tm_sec, tv_nsec / NANOSINMILLI);
     return buf;
   }
 
   [[nodiscard]] std::string ToString() const {
-    char buf[32];
     struct tm t;
     localtime_r(&tv_sec, &t);
-    sprintf(buf, "%04d-%02d-%02d %02d:%02d:%02d.%03ld", t.tm_year + 1900,
-            t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec,
-            tv_nsec / NANOSINMILLI);
-    return buf;
+    return Format(t);
+  }
+
+  /// @brief Like ToString, in China Standard Time whatever the local time
+  /// zone, as exchange times are.
+  [[nodiscard]] std::string ToCstString() const {
+    const time_t cst = tv_sec + CSTOFFSET;
+    struct tm t;
+    gmtime_r(&cst, &t);
+    return Format(t);
   }
 
   [[nodiscard]] bool IsEmpty() const { return tv_sec == 0 && tv_nsec == 0; }
@@ -157,11 +168,115 @@ public:
     return Timestamp{seconds, 0};
   }
 
+  /**
+   * @brief Parses "YYYYMMDD HH:MM:SS" in China Standard Time.
+   *
+   * @return The timestamp, or an empty one if s is malformed.
+   */
   static Timestamp FromString(std::string_view s) {
-    struct tm tm {};
-    memset(&tm, 0, sizeof(tm));
-    strptime(s.data(), "%Y%m%d %H:%M:%S", &tm);
-    return FromSeconds(mktime(&tm));
+    if (s.size() < 17 || s[8] != ' ') {
+      return Timestamp{0, 0};
+    }
+    const auto date = ParseDate(s.data());
+    const auto seconds = ParseTimeOfDay(s.data() + 9);
+    if (date < 0 || seconds < 0) {
+      return Timestamp{0, 0};
+    }
+    return FromSeconds(CstMidnight(date) + seconds);
+  }
+
+  /**
+   * @brief Parses an "HH:MM:SS" field such as CTP's UpdateTime. Exactly 8
+   * bytes are read and checked at once, there is no locale, no allocation and
+   * a single branch on malformed input.
+   *
+   * @return Seconds since midnight, or -1 if the field is malformed.
+   */
+  static int ParseTimeOfDay(const char *hhmmss) {
+    constexpr uint64_t kColonMask = 0x0000FF0000FF0000ULL;
+    constexpr uint64_t kColons = 0x00003A00003A0000ULL;
+    uint64_t v;
+    memcpy(&v, hhmmss, sizeof(v));
+    const auto digits = (v & ~kColonMask) | (kZeros & kColonMask);
+    if ((v & kColonMask) != kColons || !AllDigits(digits)) {
+      return -1;
+    }
+    // Pairs of digits to numbers: bytes 0, 3 and 6 hold hours, minutes and
+    // seconds, no byte can carry into the next.
+    auto x = digits - kZeros;
+    x = x * 10 + (x >> 8);
+    const auto h = static_cast<int>(x & 0xFF);
+    const auto m = static_cast<int>((x >> 24) & 0xFF);
+    const auto s = static_cast<int>((x >> 48) & 0xFF);
+    if (h > 23 || m > 59 || s > 59) {
+      return -1;
+    }
+    return h * 3600 + m * 60 + s;
+  }
+
+  /**
+   * @brief Parses a "YYYYMMDD" field such as CTP's TradingDay or ActionDay,
+   * 8 bytes at once.
+   *
+   * @return The date as yyyymmdd, or -1 if the field is malformed.
+   */
+  static int ParseDate(const char *yyyymmdd) {
+    uint64_t v;
+    memcpy(&v, yyyymmdd, sizeof(v));
+    if (!AllDigits(v)) {
+      return -1;
+    }
+    auto x = v - kZeros;
+    x = x * 10 + (x >> 8);
+    x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >>
+        32;
+    const auto date = static_cast<int>(x);
+    const auto m = date / 100 % 100;
+    const auto d = date % 100;
+    if (m < 1 || m > 12 || d < 1 || d > 31) {
+      return -1;
+    }
+    return date;
+  }
+
+  /// @brief Days from 1970-01-01 to a civil date, valid for any date.
+  static constexpr long DaysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    const long era = (y >= 0 ? y : y - 399) / 400;
+    const long yoe = y - era * 400;
+    const long doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+  }
+
+  /// @brief Seconds since the epoch at the start of yyyymmdd in China
+  /// Standard Time.
+  static constexpr time_t CstMidnight(int yyyymmdd) {
+    return DaysFromCivil(yyyymmdd / 10000, yyyymmdd / 100 % 100,
+                         yyyymmdd % 100) *
+               SECONDSINDAY -
+           CSTOFFSET;
+  }
+
+private:
+  /// @brief yyyy-mm-dd hh:mm:ss.mmm of a broken down time of tv_sec.
+  [[nodiscard]] std::string Format(const struct tm &t) const {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d.%03ld",
+             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min,
+             t.tm_sec, tv_nsec / NANOSINMILLI);
+    return buf;
+  }
+
+  static_assert(std::endian::native == std::endian::little);
+  static constexpr uint64_t kZeros = 0x3030303030303030ULL;
+
+  /// @brief Whether all 8 bytes are ASCII digits.
+  static bool AllDigits(uint64_t v) {
+    constexpr uint64_t kHigh = 0xF0F0F0F0F0F0F0F0ULL;
+    constexpr uint64_t kSix = 0x0606060606060606ULL;
+    return (v & kHigh) == kZeros && ((v + kSix) & kHigh) == kZeros;
   }
 } __attribute__((packed));
 
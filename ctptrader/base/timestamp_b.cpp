@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <vector>
+
+#include <base/clock.hpp>
+#include <base/timestamp.hpp>
+
+namespace {
+
+using namespace ctptrader::base;
+
+/// @brief UpdateTime fields of a trading day in random order.
+std::vector<std::array<char, 9>> Times() {
+  std::vector<std::array<char, 9>> times;
+  for (int t = 9 * 3600; t < 15 * 3600; t += 7) {
+    std::array<char, 9> field{};
+    snprintf(field.data(), field.size(), "%02d:%02d:%02d", t / 3600,
+             t / 60 % 60, t % 60);
+    times.push_back(field);
+  }
+  std::shuffle(times.begin(), times.end(), std::mt19937(42));
+  return times;
+}
+
+/// @brief What Timestamp::FromString used to do.
+Timestamp Strptime(const char *s) {
+  struct tm tm {};
+  strptime(s, "%Y%m%d %H:%M:%S", &tm);
+  return Timestamp::FromSeconds(mktime(&tm));
+}
+
+void StrptimeFromString(benchmark::State &state) {
+  const auto times = Times();
+  char buf[32] = "20231103 ";
+  size_t i = 0;
+  for (auto _ : state) {
+    memcpy(buf + 9, times[i].data(), 9);
+    benchmark::DoNotOptimize(Strptime(buf));
+    i = i + 1 == times.size() ? 0 : i + 1;
+  }
+}
+BENCHMARK(StrptimeFromString);
+
+void FromString(benchmark::State &state) {
+  const auto times = Times();
+  char buf[32] = "20231103 ";
+  size_t i = 0;
+  for (auto _ : state) {
+    memcpy(buf + 9, times[i].data(), 9);
+    benchmark::DoNotOptimize(Timestamp::FromString(buf));
+    i = i + 1 == times.size() ? 0 : i + 1;
+  }
+}
+BENCHMARK(FromString);
+
+/// @brief The per tick cost in MdSpi::OnRtnDepthMarketData.
+void ExchangeClockResolve(benchmark::State &state) {
+  const auto times = Times();
+  const auto now = time(nullptr);
+  ExchangeClock clock;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(clock.Resolve(Exchange_DCE, "20231103",
+                                           times[i].data(), 500, now));
+    i = i + 1 == times.size() ? 0 : i + 1;
+  }
+}
+BENCHMARK(ExchangeClockResolve);
+
+} // namespace
+
+BENCHMARK_MAIN();
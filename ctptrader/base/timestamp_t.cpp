@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
 #include <base/timestamp.hpp>
 
 namespace {
@@ -24,6 +28,22 @@ TEST(TimestampTest, ToString) {
   EXPECT_EQ(ts.ToString(), TimeStr);
 }
 
+TEST(TimestampTest, ToCstString) {
+  const auto saved = getenv("TZ");
+  const std::string tz = saved != nullptr ? saved : "";
+  // Whatever the local time zone
+  setenv("TZ", "America/New_York", 1);
+  tzset();
+  Timestamp ts = Timestamp::FromNanoSeconds(Ts * NANOSINSECOND + 7000000);
+  EXPECT_EQ(ts.ToCstString(), "2023-01-01 08:30:25.007");
+  if (saved != nullptr) {
+    setenv("TZ", tz.c_str(), 1);
+  } else {
+    unsetenv("TZ");
+  }
+  tzset();
+}
+
 TEST(TimestampTest, IsEmpty) {
   Timestamp ts{0, 0};
   EXPECT_TRUE(ts.IsEmpty());
@@ -74,4 +94,99 @@ TEST(TimestampTest, FromSeconds) {
   EXPECT_EQ(ts.tv_nsec, 0);
 }
 
+/// @brief Parses digit by digit, the reference for the fast parsers.
+int ParseDigits(const char *s, int n) {
+  int v = 0;
+  for (int i = 0; i < n; ++i) {
+    if (s[i] < '0' || s[i] > '9') {
+      return -1;
+    }
+    v = v * 10 + s[i] - '0';
+  }
+  return v;
+}
+
+int ReferenceTimeOfDay(const char *s) {
+  const auto h = ParseDigits(s, 2);
+  const auto m = ParseDigits(s + 3, 2);
+  const auto sec = ParseDigits(s + 6, 2);
+  if (s[2] != ':' || s[5] != ':' || h < 0 || m < 0 || sec < 0 || h > 23 ||
+      m > 59 || sec > 59) {
+    return -1;
+  }
+  return h * 3600 + m * 60 + sec;
+}
+
+int ReferenceDate(const char *s) {
+  const auto date = ParseDigits(s, 8);
+  const auto m = date / 100 % 100;
+  const auto d = date % 100;
+  return date < 0 || m < 1 || m > 12 || d < 1 || d > 31 ? -1 : date;
+}
+
+TEST(TimestampTest, ParseTimeOfDay) {
+  char buf[16];
+  for (int t = 0; t < SECONDSINDAY; ++t) {
+    snprintf(buf, sizeof(buf), "%02d:%02d:%02d", t / 3600, t / 60 % 60,
+             t % 60);
+    ASSERT_EQ(Timestamp::ParseTimeOfDay(buf), t) << buf;
+  }
+  EXPECT_EQ(Timestamp::ParseTimeOfDay("24:00:00"), -1);
+  EXPECT_EQ(Timestamp::ParseTimeOfDay("23:60:00"), -1);
+  EXPECT_EQ(Timestamp::ParseTimeOfDay("23:59:60"), -1);
+  EXPECT_EQ(Timestamp::ParseTimeOfDay("23:59;59"), -1);
+  EXPECT_EQ(Timestamp::ParseTimeOfDay("2:59:59\0"), -1);
+}
+
+TEST(TimestampTest, ParseDate) {
+  EXPECT_EQ(Timestamp::ParseDate("20231103"), 20231103);
+  EXPECT_EQ(Timestamp::ParseDate("19700101"), 19700101);
+  EXPECT_EQ(Timestamp::ParseDate("20231301"), -1);
+  EXPECT_EQ(Timestamp::ParseDate("20231100"), -1);
+  EXPECT_EQ(Timestamp::ParseDate("2023110:"), -1);
+  EXPECT_EQ(Timestamp::ParseDate("2023-11-"), -1);
+}
+
+TEST(TimestampTest, ParseFuzz) {
+  // Mostly digits and separators, so that many inputs are nearly valid
+  constexpr char kAlphabet[] = "0123456789012345:::/ ;*\x7f\xff";
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<size_t> pick(0, sizeof(kAlphabet) - 1);
+  char buf[8];
+  for (int i = 0; i < 1000000; ++i) {
+    for (auto &c : buf) {
+      c = kAlphabet[pick(rng)];
+    }
+    if (i % 2 == 0) {
+      buf[2] = buf[5] = ':';
+    }
+    ASSERT_EQ(Timestamp::ParseTimeOfDay(buf), ReferenceTimeOfDay(buf))
+        << std::string(buf, sizeof(buf));
+    ASSERT_EQ(Timestamp::ParseDate(buf), ReferenceDate(buf))
+        << std::string(buf, sizeof(buf));
+  }
+}
+
+TEST(TimestampTest, CstMidnight) {
+  EXPECT_EQ(Timestamp::CstMidnight(19700101), -CSTOFFSET);
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<time_t> pick(0, 4102444800L);
+  for (int i = 0; i < 100000; ++i) {
+    const auto t = pick(rng);
+    struct tm tm {};
+    gmtime_r(&t, &tm);
+    const auto date =
+        (tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday;
+    ASSERT_EQ(Timestamp::CstMidnight(date) + CSTOFFSET,
+              t - t % SECONDSINDAY);
+  }
+}
+
+TEST(TimestampTest, FromString) {
+  // 2023-01-01 08:30:25 China Standard Time
+  EXPECT_EQ(Timestamp::FromString("20230101 08:30:25").tv_sec, Ts);
+  EXPECT_TRUE(Timestamp::FromString("2023-01-01 08:30:25").IsEmpty());
+  EXPECT_TRUE(Timestamp::FromString("20230101").IsEmpty());
+}
+
 } // namespace
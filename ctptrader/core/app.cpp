@@ -1 +1,95 @@
-#include <core/app.hpp>
\ No newline at end of file
+#include <algorithm>
+#include <bit>
+#include <mutex>
+
+#include <core/app.hpp>
+
+namespace ctptrader::core {
+
+bool IApp::LoadChannelConfig(toml::table &global_config, uint64_t &capacity,
+                             util::ShmOptions &options) {
+  capacity = global_config["market_channel_capacity"].value_or(
+      util::ShmFrameSegment<util::ShmBroadcastRing>::kDefaultCapacity);
+  if (!std::has_single_bit(capacity)) {
+    LOG_ERROR("market_channel_capacity must be a power of two: %lu", capacity);
+    return false;
+  }
+  options.populate_ = global_config["market_channel_populate"].value_or(false);
+  options.lock_ = global_config["market_channel_lock"].value_or(false);
+  options.hugepage_dir_ =
+      global_config["market_channel_hugepage_dir"].value_or("");
+  return true;
+}
+
+bool IApp::LoadThreadConfig(toml::table &app_config, std::string_view name,
+                            util::ThreadOptions &options) {
+  options.name_ = name;
+  const auto cpu = app_config["cpu"];
+  if (const auto placement = cpu.value<std::string>(); placement) {
+    if (*placement != "isolated") {
+      LOG_ERROR("Unknown cpu placement: %s", placement->c_str());
+      return false;
+    }
+    options.cpu_ = util::ThreadOptions::kIsolatedCpu;
+  } else {
+    options.cpu_ = cpu.value_or(util::ThreadOptions::kAnyCpu);
+    if (options.cpu_ < util::ThreadOptions::kAnyCpu) {
+      LOG_ERROR("cpu must be a core, -1 or \"isolated\"");
+      return false;
+    }
+  }
+  options.priority_ = app_config["priority"].value_or(0);
+  if (options.priority_ < 0 || options.priority_ > 99) {
+    LOG_ERROR("priority must be between 0 and 99: %d", options.priority_);
+    return false;
+  }
+  return true;
+}
+
+void SetupThread(const util::ThreadOptions &options) {
+  // Cores taken by the hot threads of this process
+  static std::mutex mutex;
+  static std::vector<int> taken;
+  util::NameThread(options.name_);
+  auto cpu = options.cpu_;
+  {
+    const std::lock_guard lock(mutex);
+    const auto isolated = util::IsolatedCpus();
+    if (cpu == util::ThreadOptions::kIsolatedCpu) {
+      const auto it = std::find_if(
+          isolated.begin(), isolated.end(), [](int c) {
+            return std::find(taken.begin(), taken.end(), c) == taken.end();
+          });
+      cpu = it == isolated.end() ? util::ThreadOptions::kAnyCpu : *it;
+      if (it == isolated.end()) {
+        LOG_WARNING("No free isolated core for thread %s",
+                    options.name_.c_str());
+      }
+    } else if (cpu >= 0 && !isolated.empty() &&
+               std::find(isolated.begin(), isolated.end(), cpu) ==
+                   isolated.end()) {
+      LOG_WARNING("Thread %s is placed on core %d, which is not isolated",
+                  options.name_.c_str(), cpu);
+    }
+    if (cpu >= 0) {
+      if (std::find(taken.begin(), taken.end(), cpu) != taken.end()) {
+        LOG_WARNING("Thread %s shares core %d with another hot thread",
+                    options.name_.c_str(), cpu);
+      }
+      taken.push_back(cpu);
+    }
+  }
+  if (cpu >= 0 && !util::PinThread(cpu)) {
+    LOG_WARNING("Failed to pin thread %s to core %d", options.name_.c_str(),
+                cpu);
+  }
+  if (options.priority_ > 0 && !util::SetFifoPriority(options.priority_)) {
+    LOG_WARNING("Failed to set SCHED_FIFO priority %d for thread %s, "
+                "CAP_SYS_NICE or an rtprio limit is needed",
+                options.priority_, options.name_.c_str());
+  }
+  LOG_INFO("Thread %s: %s", options.name_.c_str(),
+           util::DescribeThread().c_str());
+}
+
+} // namespace ctptrader::core
\ No newline at end of file
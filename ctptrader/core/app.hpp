@@ -3,6 +3,8 @@
 #include <boost/noncopyable.hpp>
 
 #include <core/ctx.hpp>
+#include <util/channel.hpp>
+#include <util/thread.hpp>
 
 namespace ctptrader::core {
 
@@ -27,7 +29,50 @@ public:
   virtual void Run() = 0;
 
 protected:
+  /**
+   * @brief Reads the market channel settings from the global configuration:
+   * market_channel_capacity (bytes, a power of two), market_channel_populate,
+   * market_channel_lock and market_channel_hugepage_dir.
+   *
+   * @param global_config The global configuration.
+   * @param capacity Receives the ring size in bytes.
+   * @param options Receives how the ring pages are backed.
+   * @return False if the capacity is not a power of two.
+   */
+  static bool LoadChannelConfig(toml::table &global_config, uint64_t &capacity,
+                                util::ShmOptions &options);
+
+  /**
+   * @brief Reads the placement of a hot thread from the application
+   * configuration: cpu (a core, -1 for any or "isolated" for the next free
+   * isolated core) and priority (SCHED_FIFO priority, 0 for SCHED_OTHER).
+   *
+   * @param app_config The application configuration.
+   * @param name The name of the thread.
+   * @param options Receives the placement.
+   * @return False if a value is out of range.
+   */
+  static bool LoadThreadConfig(toml::table &app_config, std::string_view name,
+                               util::ThreadOptions &options);
+
+  /**
+   * @brief Name of the conflated depth cache that goes with a market channel.
+   * The market side publishes it when market_depth_cache is set.
+   */
+  static std::string DepthCacheName(std::string_view market_channel) {
+    return std::string(market_channel) + ".depth";
+  }
+
   Context ctx_; /**< The context of the application. */
 };
 
+/**
+ * @brief Names, pins and schedules the calling thread as configured and
+ * reports where it landed. Failures are logged as warnings, the thread keeps
+ * running where it is.
+ *
+ * @param options The placement from IApp::LoadThreadConfig.
+ */
+void SetupThread(const util::ThreadOptions &options);
+
 }; // namespace ctptrader::core
\ No newline at end of file
@@ -0,0 +1,30 @@
+#include <core/bar.hpp>
+
+namespace ctptrader::core {
+
+bool BarBuilder::Init(const Context &ctx, const std::vector<int32_t> &periods) {
+  const auto &instruments = ctx.GetInstrumentCenter();
+  const auto &underlyings = ctx.GetUnderlyingCenter();
+  hours_.clear();
+  for (auto i = 0; i < instruments.Count(); ++i) {
+    const auto underlying = instruments.Get(i).underlying_id_;
+    hours_.push_back(underlyings.HasID(underlying)
+                         ? TradingHours::For(
+                               underlyings.Get(underlying).exchange_,
+                               underlyings.Get(underlying).name_,
+                               underlyings.Get(underlying).night_end_)
+                         : TradingHours());
+  }
+  periods_.clear();
+  for (const auto seconds : periods) {
+    if (base::BarPeriodIndex(seconds) < 0) {
+      LOG_ERROR("Unsupported bar period: %d", seconds);
+      return false;
+    }
+    periods_.push_back({seconds, -1, {}, std::vector<Slot>(hours_.size())});
+  }
+  trading_days_.Init(ctx.GetCalendarCenter());
+  return true;
+}
+
+} // namespace ctptrader::core
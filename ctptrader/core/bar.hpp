@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <base/msg.hpp>
+#include <core/ctx.hpp>
+#include <core/session.hpp>
+
+namespace ctptrader::core {
+
+/**
+ * @brief Builds bars of several periods from the depth stream of every
+ * instrument, with O(1) work per tick and period.
+ *
+ * Bars follow the trading hours of the product: auction ticks join the first
+ * bar of a session, closing ticks join the last bar of a period and publish
+ * it at once, and ticks outside trading hours are ignored. The trading day of
+ * a tick comes from the calendar, so night ticks belong to the next trading
+ * day whatever the exchange puts in TradingDay. Volume and turnover are the
+ * differences of the cumulative values of the depth.
+ */
+class BarBuilder {
+public:
+  /**
+   * @brief Prepares the builder for the instruments of a context.
+   *
+   * @param ctx The context with instruments, underlyings and the calendar.
+   * @param periods Bar periods in seconds, each one of base::kBarPeriods.
+   * @return False if a period is not supported.
+   */
+  bool Init(const Context &ctx, const std::vector<int32_t> &periods);
+
+  /**
+   * @brief Adds a tick and publishes every bar it completes.
+   *
+   * @param depth The tick, with update_time_ set.
+   * @param publish Called with each completed bar.
+   */
+  template <typename F> void OnDepth(const base::Depth &depth, F &&publish) {
+    const auto id = depth.id_;
+    if (id < 0 || id >= static_cast<base::ID>(hours_.size()) ||
+        depth.update_time_.tv_sec <= 0 || std::isnan(depth.last_) ||
+        depth.last_ >= std::numeric_limits<base::Price>::max()) {
+      return;
+    }
+    const auto session = trading_days_.Find(depth.update_time_.tv_sec);
+    if (session.trading_day_ == 0) {
+      return;
+    }
+    const auto place = hours_[id].Place(session.time_);
+    if (place.time_ < 0) {
+      return;
+    }
+    const auto trading_day = session.trading_day_;
+    // Seconds on a line that runs through every trading day
+    const auto day_start = (session.evening_ + 1) * base::SECONDSINDAY;
+    const auto at = day_start + place.time_;
+    const auto now = day_start + session.time_;
+    for (auto &period : periods_) {
+      auto bucket = at / period.seconds_;
+      if (bucket > period.bucket_) {
+        Flush(period, bucket, publish);
+      }
+      // Ticks that arrive after their bucket was flushed join the current one
+      bucket = period.bucket_;
+      auto &slot = period.slots_[id];
+      if (trading_day < slot.trading_day_) {
+        continue;
+      }
+      if (slot.trading_day_ != trading_day) {
+        // A new trading day starts from zero, the first tick seen in the
+        // middle of one only sets the base.
+        const bool mid_day = slot.trading_day_ == 0 && !place.opens_day_;
+        slot.base_volume_ = mid_day ? depth.volume_ : 0;
+        slot.base_turnover_ = mid_day ? depth.turnover_ : 0;
+        slot.trading_day_ = trading_day;
+      }
+      if (!slot.open_) {
+        if (slot.bucket_ == bucket) {
+          // A second closing tick, its volume goes to the next bar
+          continue;
+        }
+        auto &bar = slot.bar_;
+        bar.trading_day_ = base::Date(trading_day);
+        bar.update_time_ = base::Timestamp{
+            depth.update_time_.tv_sec + (bucket + 1) * period.seconds_ - now,
+            0};
+        bar.id_ = id;
+        bar.open_ = bar.high_ = bar.low_ = depth.last_;
+        bar.period_ = period.seconds_;
+        slot.bucket_ = bucket;
+        slot.open_ = true;
+        period.open_.push_back(id);
+      }
+      auto &bar = slot.bar_;
+      bar.high_ = std::max(bar.high_, depth.last_);
+      bar.low_ = std::min(bar.low_, depth.last_);
+      bar.close_ = depth.last_;
+      bar.volume_ = depth.volume_ - slot.base_volume_;
+      bar.turnover_ = depth.turnover_ - slot.base_turnover_;
+      if (place.closing_) {
+        Close(slot, publish);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    base::Bar bar_{};
+    int64_t bucket_{-1};
+    bool open_{false};
+    int trading_day_{0};
+    // Cumulative volume and turnover before the bar
+    base::Volume base_volume_{0};
+    base::Money base_turnover_{0};
+  };
+
+  struct Period {
+    int32_t seconds_;
+    int64_t bucket_{-1};         // newest bucket
+    std::vector<base::ID> open_; // instruments with an open bar
+    std::vector<Slot> slots_;    // per instrument
+  };
+
+  template <typename F> static void Close(Slot &slot, F &publish) {
+    publish(static_cast<const base::Bar &>(slot.bar_));
+    slot.open_ = false;
+    slot.base_volume_ += slot.bar_.volume_;
+    slot.base_turnover_ += slot.bar_.turnover_;
+  }
+
+  /// Publishes the bars still open before the bucket starts.
+  template <typename F>
+  static void Flush(Period &period, int64_t bucket, F &publish) {
+    for (const auto id : period.open_) {
+      if (auto &slot = period.slots_[id]; slot.open_) {
+        Close(slot, publish);
+      }
+    }
+    period.open_.clear();
+    period.bucket_ = bucket;
+  }
+
+  std::vector<TradingHours> hours_;
+  std::vector<Period> periods_;
+  TradingDays trading_days_;
+};
+
+} // namespace ctptrader::core
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include <core/bar.hpp>
+
+namespace {
+
+using namespace ctptrader::base;
+using namespace ctptrader::core;
+
+constexpr int At(int h, int m, int s = 0) {
+  return TradingHours::FromTimeOfDay(h * 3600 + m * 60 + s);
+}
+
+TEST(TradingHoursTest, Place) {
+  const auto hours = TradingHours::For(Exchange_SHFE, "cu", 100);
+  EXPECT_EQ(hours.Place(At(21, 30)).time_, At(21, 30));
+  // Auction before the night session
+  const auto auction = hours.Place(At(20, 59));
+  EXPECT_EQ(auction.time_, At(21, 0));
+  EXPECT_TRUE(auction.opens_day_);
+  // Closing ticks of the night session and before the break
+  EXPECT_TRUE(hours.Place(At(1, 0)).closing_);
+  EXPECT_EQ(hours.Place(At(1, 0)).time_, At(0, 59, 59));
+  EXPECT_EQ(hours.Place(At(10, 15)).time_, At(10, 14, 59));
+  EXPECT_FALSE(hours.Place(At(8, 59)).opens_day_);
+  EXPECT_EQ(hours.Place(At(8, 59)).time_, At(9, 0));
+  // The break and after the close
+  EXPECT_EQ(hours.Place(At(10, 20)).time_, -1);
+  EXPECT_EQ(hours.Place(At(16, 0)).time_, -1);
+  EXPECT_EQ(TradingHours::For(Exchange_SHFE, "cu", 0).Place(At(21, 30)).time_,
+            -1);
+  EXPECT_EQ(TradingHours::For(Exchange_FFEX, "IF", 0).Place(At(9, 0)).time_,
+            -1);
+}
+
+TEST(TradingHoursTest, Cffex) {
+  const auto index = TradingHours::For(Exchange_FFEX, "IF", 0);
+  EXPECT_EQ(index.Place(At(9, 30)).time_, At(9, 30));
+  EXPECT_EQ(index.Place(At(15, 5)).time_, -1);
+  // Treasury futures close at 15:15
+  const auto treasury = TradingHours::For(Exchange_FFEX, "T", 0);
+  EXPECT_EQ(treasury.Place(At(15, 5)).time_, At(15, 5));
+  EXPECT_EQ(treasury.Place(At(15, 15)).time_, At(15, 14, 59));
+  EXPECT_EQ(treasury.Place(At(15, 20)).time_, -1);
+  // Unknown products get no hours rather than wrong ones
+  EXPECT_EQ(TradingHours::For(Exchange_FFEX, "XX", 0).Place(At(10, 0)).time_,
+            -1);
+}
+
+class BarBuilderTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_TRUE(ctx_.Init("./test"));
+    ASSERT_TRUE(builder_.Init(ctx_, {60, 300}));
+  }
+
+  void Tick(int date, int h, int m, int s, Price last, Volume volume) {
+    Depth depth{};
+    depth.id_ = 0;
+    depth.update_time_ = Timestamp{
+        Timestamp::CstMidnight(date) + h * 3600 + m * 60 + s, 500000000};
+    depth.last_ = last;
+    depth.volume_ = volume;
+    depth.turnover_ = volume * last;
+    builder_.OnDepth(depth, [this](const Bar &bar) { bars_.push_back(bar); });
+  }
+
+  static time_t Cst(int date, int h, int m) {
+    return Timestamp::CstMidnight(date) + h * 3600 + m * 60;
+  }
+
+  Context ctx_;
+  BarBuilder builder_;
+  std::vector<Bar> bars_;
+};
+
+TEST_F(BarBuilderTest, Periods) {
+  EXPECT_FALSE(builder_.Init(ctx_, {7}));
+}
+
+TEST_F(BarBuilderTest, NightSession) {
+  // Friday night belongs to Monday
+  Tick(20231103, 20, 59, 0, 100, 10);
+  Tick(20231103, 21, 0, 30, 102, 15);
+  EXPECT_TRUE(bars_.empty());
+  Tick(20231103, 21, 1, 0, 101, 20);
+  ASSERT_EQ(bars_.size(), 1U);
+  EXPECT_EQ(bars_[0].trading_day_, Date(20231106));
+  EXPECT_EQ(bars_[0].update_time_.tv_sec, Cst(20231103, 21, 1));
+  EXPECT_EQ(bars_[0].period_, 60);
+  EXPECT_EQ(bars_[0].open_, 100);
+  EXPECT_EQ(bars_[0].high_, 102);
+  EXPECT_EQ(bars_[0].low_, 100);
+  EXPECT_EQ(bars_[0].close_, 102);
+  // The auction volume is part of the first bar
+  EXPECT_EQ(bars_[0].volume_, 15);
+  EXPECT_EQ(bars_[0].turnover_, 15 * 102);
+
+  Tick(20231103, 21, 5, 10, 99, 30);
+  ASSERT_EQ(bars_.size(), 3U);
+  EXPECT_EQ(bars_[1].period_, 60);
+  EXPECT_EQ(bars_[1].volume_, 5);
+  EXPECT_EQ(bars_[2].period_, 300);
+  EXPECT_EQ(bars_[2].update_time_.tv_sec, Cst(20231103, 21, 5));
+  EXPECT_EQ(bars_[2].close_, 101);
+  EXPECT_EQ(bars_[2].volume_, 20);
+
+  // After midnight on Saturday, the closing tick publishes at once
+  Tick(20231104, 0, 59, 59, 98, 40);
+  bars_.clear();
+  Tick(20231104, 1, 0, 0, 97, 42);
+  ASSERT_EQ(bars_.size(), 2U);
+  EXPECT_EQ(bars_[0].update_time_.tv_sec, Cst(20231104, 1, 0));
+  EXPECT_EQ(bars_[0].close_, 97);
+  EXPECT_EQ(bars_[0].volume_, 12);
+  EXPECT_EQ(bars_[1].period_, 300);
+  // A second closing tick waits for the next bar
+  Tick(20231104, 1, 0, 1, 97, 43);
+  EXPECT_EQ(bars_.size(), 2U);
+  bars_.clear();
+
+  // Monday day session
+  Tick(20231106, 9, 0, 1, 96, 50);
+  Tick(20231106, 16, 0, 0, 96, 60);
+  EXPECT_TRUE(bars_.empty());
+  Tick(20231106, 9, 1, 0, 96, 51);
+  ASSERT_EQ(bars_.size(), 1U);
+  EXPECT_EQ(bars_[0].trading_day_, Date(20231106));
+  EXPECT_EQ(bars_[0].volume_, 8);
+  bars_.clear();
+
+  // Monday night starts Tuesday from zero
+  Tick(20231106, 21, 0, 0, 95, 3);
+  Tick(20231106, 21, 1, 0, 95, 4);
+  ASSERT_EQ(bars_.size(), 3U);
+  EXPECT_EQ(bars_[0].trading_day_, Date(20231106));
+  EXPECT_EQ(bars_[2].trading_day_, Date(20231107));
+  EXPECT_EQ(bars_[2].volume_, 3);
+}
+
+TEST_F(BarBuilderTest, MidDayStart) {
+  // The first tick seen mid session only sets the base
+  Tick(20231106, 10, 0, 0, 100, 1000);
+  Tick(20231106, 10, 0, 30, 100, 1010);
+  Tick(20231106, 10, 1, 0, 100, 1020);
+  ASSERT_EQ(bars_.size(), 1U);
+  EXPECT_EQ(bars_[0].volume_, 10);
+}
+
+} // namespace
@@ -1,5 +1,9 @@
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <new>
+
+#include <sys/mman.h>
 
 #include <base/ref.hpp>
 #include <core/ctx.hpp>
@@ -7,6 +11,52 @@
 
 namespace ctptrader::core {
 
+namespace {
+
+constexpr size_t kCacheLine = 64;
+constexpr size_t kHugePage = 2 << 20;
+
+constexpr size_t AlignUp(size_t bytes, size_t align) {
+  return (bytes + align - 1) & ~(align - 1);
+}
+
+} // namespace
+
+Arena::Arena(size_t bytes, bool huge_pages) {
+  if (bytes == 0) {
+    return;
+  }
+  if (huge_pages && bytes >= kHugePage) {
+    // One huge page more than needed, to start on a huge page boundary
+    map_bytes_ = AlignUp(bytes, kHugePage) + kHugePage;
+    map_ = mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map_ != MAP_FAILED) {
+      data_ = reinterpret_cast<void *>(
+          AlignUp(reinterpret_cast<uintptr_t>(map_), kHugePage));
+      madvise(data_, AlignUp(bytes, kHugePage), MADV_HUGEPAGE);
+      return;
+    }
+    LOG_WARNING("Failed to map %zu bytes for huge pages", bytes);
+    map_ = nullptr;
+    map_bytes_ = 0;
+  }
+  bytes = AlignUp(bytes, kCacheLine);
+  data_ = std::aligned_alloc(kCacheLine, bytes);
+  if (data_ == nullptr) {
+    throw std::bad_alloc();
+  }
+  std::memset(data_, 0, bytes);
+}
+
+Arena::~Arena() {
+  if (map_ != nullptr) {
+    munmap(map_, map_bytes_);
+  } else {
+    std::free(data_);
+  }
+}
+
 template <> bool AccountCenter::LoadFromCsv(std::string_view filename) {
   util::CsvReader<3> reader(filename);
   base::Account account;
@@ -22,10 +72,10 @@ template <> bool AccountCenter::LoadFromCsv(std::string_view filename) {
 }
 
 template <> bool UnderlyingCenter::LoadFromCsv(std::string_view filename) {
-  util::CsvReader<6> reader(filename);
+  util::CsvReader<7> reader(filename);
   base::Underlying u;
   while (reader.ReadRow(u.id_, u.name_, u.exchange_, u.multiple_, u.lot_size_,
-                        u.tick_size_)) {
+                        u.tick_size_, u.night_end_)) {
     if (u.id_ != (int)vec_.size()) {
       std::cerr << "ID is not continuous.\n";
       return false;
@@ -114,14 +164,20 @@ bool Context::Init(std::string_view data_folder) {
               << std::endl;
     return false;
   }
+  if (!ins_center_.BuildIndex()) {
+    std::cerr << "Failed to index instruments: " << folder << std::endl;
+    return false;
+  }
   for (auto i = 0; i < ins_center_.Count(); ++i) {
     auto uly_id = uly_center_.GetID(ins_center_.Get(i).underlying_);
     ins_center_.vec_[i].underlying_id_ = uly_id;
   }
 
   st_center_.Resize(ins_center_.Count());
-  bar_center_.Resize(ins_center_.Count());
-  depth_center_.Resize(ins_center_.Count());
+  for (auto &bar_center : bar_centers_) {
+    bar_center.Resize(ins_center_.Count());
+  }
+  depth_center_.Resize(ins_center_.Count(), true);
   bal_center_.Resize(acc_center_.Count());
   return true;
 }
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <concepts>
+#include <cstring>
+#include <span>
 #include <string_view>
 
-#include <boost/circular_buffer.hpp>
 #include <loguru.hpp>
 
 #include <base/msg.hpp>
 #include <base/ref.hpp>
 #include <core/toml.hpp>
+#include <util/symbol.hpp>
 
 namespace ctptrader {
 #include <loguru.hpp>
@@ -32,23 +36,95 @@ concept HasNameAndID = requires(T t) {
   { t.name_ } -> std::convertible_to<std::string_view>;
 };
 
+/**
+ * @brief A zeroed block of memory aligned to a cache line, the storage of the
+ * flat buffers below. Blocks of at least a huge page can ask for transparent
+ * huge pages instead.
+ */
+class Arena {
+public:
+  Arena() = default;
+
+  /**
+   * @param bytes The size of the block.
+   * @param huge_pages Map the block on huge page boundaries and advise the
+   * kernel to back it by huge pages, when it is large enough.
+   * @throws std::bad_alloc If the block cannot be allocated.
+   */
+  Arena(size_t bytes, bool huge_pages);
+
+  Arena(Arena &&other) noexcept { *this = std::move(other); }
+
+  Arena &operator=(Arena &&other) noexcept {
+    std::swap(map_, other.map_);
+    std::swap(map_bytes_, other.map_bytes_);
+    std::swap(data_, other.data_);
+    return *this;
+  }
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  ~Arena();
+
+  [[nodiscard]] void *Data() const { return data_; }
+
+  /** @brief Whether the block is mapped for huge pages. */
+  [[nodiscard]] bool Mapped() const { return map_ != nullptr; }
+
+private:
+  void *map_{nullptr}; // the mapping, nullptr if allocated
+  size_t map_bytes_{0};
+  void *data_{nullptr};
+};
+
 /**
  * @brief A circular buffer that stores data of type T with a fixed size N for
  * each ID.
  *
+ * The buffers of all IDs share one arena of Count() x N slots, N per ID, next
+ * to a compact array of heads and sizes, so reading the last value of an ID
+ * takes two dependent loads.
+ *
+ * Latest value stores, N of 1 or 2, have no ring and no heads: bitsets say
+ * which values are there and, for N of 2, which of the two slots of an ID is
+ * the current one, flipped by every push. HasValue, Back and Prev are an
+ * indexed load next to a bit test on a few cache lines for the whole
+ * universe.
+ *
  * @tparam T The type of data to be stored in the buffer. It must have an int
- * field id_.
+ * field id_ and be trivially copyable.
  * @tparam N The fixed size of the circular buffer for each ID.
  */
 template <HasID T, size_t N> class BufCenter {
+  static_assert(std::is_trivially_copyable_v<T>);
+  static_assert(N > 0);
+
 public:
   /**
-   * @brief Resizes the buffer to the specified size.
+   * @brief Resizes the buffer to the specified size, keeping the values of
+   * the IDs below both sizes.
    *
    * @param size The new size of the buffer.
+   * @param huge_pages Ask for huge pages for the arena, see Arena.
    */
-  void Resize(size_t size) {
-    chunks_.resize(size, boost::circular_buffer<T>(N));
+  void Resize(size_t size, bool huge_pages = false) {
+    Arena arena(size * N * sizeof(T), huge_pages);
+    auto *slots = static_cast<T *>(arena.Data());
+    const auto keep = std::min(size, count_);
+    if (keep > 0) {
+      std::memcpy(slots, slots_, keep * N * sizeof(T));
+    }
+    arena_ = std::move(arena);
+    slots_ = slots;
+    count_ = size;
+    if constexpr (kLatest) {
+      ResizeBits(has_value_, size);
+      ResizeBits(has_prev_, size);
+      ResizeBits(current_, size);
+    } else {
+      meta_.resize(size);
+    }
   }
 
   /**
@@ -59,7 +135,11 @@ public:
    * otherwise.
    */
   [[nodiscard]] bool HasValue(base::ID id) const {
-    return chunks_[id].size() > 0;
+    if constexpr (kLatest) {
+      return TestBit(has_value_, id);
+    } else {
+      return meta_[id].size_ > 0;
+    }
   }
 
   /**
@@ -70,7 +150,11 @@ public:
    * @return True if there is a previous element, false otherwise.
    */
   [[nodiscard]] bool HasPrev(base::ID id) const {
-    return chunks_[id].size() > 1;
+    if constexpr (kLatest) {
+      return N == 2 && TestBit(has_prev_, id);
+    } else {
+      return meta_[id].size_ > 1;
+    }
   }
 
   /**
@@ -78,7 +162,24 @@ public:
    *
    * @param value The value to be pushed into the buffer.
    */
-  void PushBack(const T &value) { chunks_[value.id_].push_back(value); }
+  void PushBack(const T &value) {
+    if constexpr (kLatest) {
+      const auto id = value.id_;
+      if constexpr (N == 2) {
+        if (TestBit(has_value_, id)) {
+          FlipBit(current_, id);
+          SetBit(has_prev_, id);
+        }
+      }
+      slots_[id * N + Current(id)] = value;
+      SetBit(has_value_, id);
+    } else {
+      auto &meta = meta_[value.id_];
+      meta.head_ = meta.head_ + 1 == N ? 0 : meta.head_ + 1;
+      meta.size_ += meta.size_ < N ? 1 : 0;
+      slots_[value.id_ * N + meta.head_] = value;
+    }
+  }
 
   /**
    * @brief Returns a reference to the last element in the buffer with the
@@ -87,7 +188,13 @@ public:
    * @param id The ID of the buffer to retrieve the last element from.
    * @return const T& A reference to the last element in the buffer.
    */
-  [[nodiscard]] const T &Back(base::ID id) const { return chunks_[id].back(); }
+  [[nodiscard]] const T &Back(base::ID id) const {
+    if constexpr (kLatest) {
+      return slots_[id * N + Current(id)];
+    } else {
+      return slots_[id * N + meta_[id].head_];
+    }
+  }
 
   /**
    * Returns a const reference to the previous element in the buffer for the
@@ -97,9 +204,7 @@ public:
    * @return A const reference to the previous element in the buffer for the
    * given ID.
    */
-  [[nodiscard]] const T &Prev(base::ID id) const {
-    return chunks_[id][chunks_[id].size() - 2];
-  }
+  [[nodiscard]] const T &Prev(base::ID id) const { return ReverseNth(id, 1); }
 
   /**
    * @brief Returns a const reference to the nth element in the buffer with the
@@ -111,7 +216,7 @@ public:
    * ID.
    */
   [[nodiscard]] const T &Nth(base::ID id, size_t n) const {
-    return chunks_[id][n];
+    return ReverseNth(id, Size(id) - n - 1);
   }
 
   /**
@@ -124,7 +229,12 @@ public:
    * ID, counting from the back.
    */
   [[nodiscard]] const T &ReverseNth(base::ID id, size_t n) const {
-    return chunks_[id][chunks_[id].size() - n - 1];
+    if constexpr (kLatest) {
+      return slots_[id * N + (Current(id) ^ n)];
+    } else {
+      const size_t head = meta_[id].head_;
+      return slots_[id * N + (head >= n ? head - n : head + N - n)];
+    }
   }
 
   /**
@@ -133,24 +243,291 @@ public:
    * @param id The ID of the buffer to get the size of.
    * @return The size of the buffer with the given ID.
    */
-  [[nodiscard]] size_t Size(base::ID id) const { return chunks_[id].size(); }
+  [[nodiscard]] size_t Size(base::ID id) const {
+    if constexpr (kLatest) {
+      return size_t{HasValue(id)} + size_t{HasPrev(id)};
+    } else {
+      return meta_[id].size_;
+    }
+  }
 
   /**
    * @brief Returns the maximum number of elements that the buffer can hold.
    *
    * @return The maximum number of elements that the buffer can hold.
    */
-  [[nodiscard]] static size_t Capacity() { return N; }
+  [[nodiscard]] static constexpr size_t Capacity() { return N; }
 
   /**
    * @brief Returns the number of chunks in the buffer center.
    *
    * @return The number of chunks in the buffer center.
    */
-  [[nodiscard]] size_t Count() const { return chunks_.size(); }
+  [[nodiscard]] size_t Count() const { return count_; }
+
+private:
+  /** @brief Keeps the last value, and the one before for N of 2, only. */
+  static constexpr bool kLatest = N <= 2;
+
+  struct Meta {
+    uint32_t head_{N - 1}; // slot of the newest value
+    uint32_t size_{0};
+  };
+
+  static bool TestBit(const std::vector<uint64_t> &bits, base::ID id) {
+    return (bits[id >> 6] >> (id & 63)) & 1;
+  }
+
+  static void SetBit(std::vector<uint64_t> &bits, base::ID id) {
+    bits[id >> 6] |= uint64_t{1} << (id & 63);
+  }
+
+  static void FlipBit(std::vector<uint64_t> &bits, base::ID id) {
+    bits[id >> 6] ^= uint64_t{1} << (id & 63);
+  }
+
+  /// @brief The slot of the newest value of an ID in a latest value store.
+  [[nodiscard]] size_t Current(base::ID id) const {
+    if constexpr (N == 2) {
+      return TestBit(current_, id);
+    } else {
+      return 0;
+    }
+  }
+
+  /// @brief Resizes a bitset to size IDs, clearing the bits past them.
+  static void ResizeBits(std::vector<uint64_t> &bits, size_t size) {
+    bits.resize((size + 63) / 64);
+    if (size % 64 != 0) {
+      bits.back() &= (uint64_t{1} << (size % 64)) - 1;
+    }
+  }
+
+  Arena arena_;
+  T *slots_{nullptr}; // N per ID, in the arena
+  size_t count_{0};
+  std::vector<Meta> meta_;          // ring buffers only
+  std::vector<uint64_t> has_value_; // latest value stores only
+  std::vector<uint64_t> has_prev_;
+  std::vector<uint64_t> current_; // the newest of two slots
+};
+
+/**
+ * @brief Bars kept field by field, the last N of each ID.
+ *
+ * Every numeric field of an ID lives in its own ring of 2N values, each value
+ * written twice, N apart, so the last n values of a field are always one
+ * contiguous span, oldest first. Windows over a field can be handed to
+ * vectorized code without gathering or wrapping.
+ *
+ * @tparam N The number of bars kept for each ID.
+ */
+template <size_t N> class BarSeries {
+public:
+  /**
+   * @brief Resizes the buffer to the specified number of IDs.
+   *
+   * @param size The new number of IDs.
+   */
+  void Resize(size_t size) {
+    open_.resize(size * 2 * N);
+    high_.resize(size * 2 * N);
+    low_.resize(size * 2 * N);
+    close_.resize(size * 2 * N);
+    turnover_.resize(size * 2 * N);
+    volume_.resize(size * 2 * N);
+    times_.resize(size * N);
+    meta_.resize(size);
+  }
+
+  /**
+   * @brief Checks if there is a bar of the given ID.
+   *
+   * @param id The ID to check for.
+   * @return True if there is at least one bar.
+   */
+  [[nodiscard]] bool HasValue(base::ID id) const {
+    return meta_[id].size_ > 0;
+  }
+
+  /**
+   * @brief Checks if there is a bar before the last one of the given ID.
+   *
+   * @param id The ID to check for.
+   * @return True if there are at least two bars.
+   */
+  [[nodiscard]] bool HasPrev(base::ID id) const {
+    return meta_[id].size_ > 1;
+  }
+
+  /**
+   * @brief Appends a bar to its ID, dropping the oldest one when full.
+   *
+   * @param bar The bar to append.
+   */
+  void PushBack(const base::Bar &bar) {
+    auto &meta = meta_[bar.id_];
+    meta.head_ = meta.head_ + 1 == N ? 0 : meta.head_ + 1;
+    meta.size_ = std::min(meta.size_ + 1, N);
+    meta.period_ = bar.period_;
+    const auto at = Ring(bar.id_) + meta.head_;
+    open_[at] = open_[at + N] = bar.open_;
+    high_[at] = high_[at + N] = bar.high_;
+    low_[at] = low_[at + N] = bar.low_;
+    close_[at] = close_[at + N] = bar.close_;
+    turnover_[at] = turnover_[at + N] = bar.turnover_;
+    volume_[at] = volume_[at + N] = bar.volume_;
+    times_[bar.id_ * N + meta.head_] = {bar.trading_day_, bar.update_time_};
+  }
+
+  /**
+   * @brief Returns the last bar of the given ID, put together from its
+   * fields.
+   *
+   * @param id The ID, with HasValue.
+   * @return The last bar.
+   */
+  [[nodiscard]] base::Bar Back(base::ID id) const { return ReverseNth(id, 0); }
+
+  /**
+   * @brief Returns the bar before the last one of the given ID.
+   *
+   * @param id The ID, with HasPrev.
+   * @return The bar before the last one.
+   */
+  [[nodiscard]] base::Bar Prev(base::ID id) const {
+    return ReverseNth(id, 1);
+  }
+
+  /**
+   * @brief Returns the nth bar of the given ID, counting from the oldest.
+   *
+   * @param id The ID.
+   * @param n The index of the bar, below Size(id).
+   * @return The bar.
+   */
+  [[nodiscard]] base::Bar Nth(base::ID id, size_t n) const {
+    return ReverseNth(id, meta_[id].size_ - n - 1);
+  }
+
+  /**
+   * @brief Returns the nth bar of the given ID, counting from the newest.
+   *
+   * @param id The ID.
+   * @param n The index of the bar from the back, below Size(id).
+   * @return The bar.
+   */
+  [[nodiscard]] base::Bar ReverseNth(base::ID id, size_t n) const {
+    const auto &meta = meta_[id];
+    const auto at = Ring(id) + meta.head_ + N - n;
+    const auto slot = meta.head_ >= n ? meta.head_ - n : meta.head_ + N - n;
+    const auto &time = times_[id * N + slot];
+    base::Bar bar{};
+    bar.trading_day_ = time.trading_day_;
+    bar.update_time_ = time.update_time_;
+    bar.id_ = static_cast<base::InstrumentID>(id);
+    bar.open_ = open_[at];
+    bar.high_ = high_[at];
+    bar.low_ = low_[at];
+    bar.close_ = close_[at];
+    bar.volume_ = volume_[at];
+    bar.period_ = meta.period_;
+    bar.turnover_ = turnover_[at];
+    return bar;
+  }
+
+  /**
+   * @brief Returns the last n open prices of the given ID, oldest first.
+   *
+   * @param id The ID.
+   * @param n The length of the window, at most Size(id).
+   * @return The window, contiguous.
+   */
+  [[nodiscard]] std::span<const base::Price> Open(base::ID id,
+                                                  size_t n) const {
+    return Window(open_, id, n);
+  }
+
+  /** @brief The last n high prices of the given ID, see Open. */
+  [[nodiscard]] std::span<const base::Price> High(base::ID id,
+                                                  size_t n) const {
+    return Window(high_, id, n);
+  }
+
+  /** @brief The last n low prices of the given ID, see Open. */
+  [[nodiscard]] std::span<const base::Price> Low(base::ID id, size_t n) const {
+    return Window(low_, id, n);
+  }
+
+  /** @brief The last n close prices of the given ID, see Open. */
+  [[nodiscard]] std::span<const base::Price> Close(base::ID id,
+                                                   size_t n) const {
+    return Window(close_, id, n);
+  }
+
+  /** @brief The last n volumes of the given ID, see Open. */
+  [[nodiscard]] std::span<const base::Volume> Volume(base::ID id,
+                                                     size_t n) const {
+    return Window(volume_, id, n);
+  }
+
+  /** @brief The last n turnovers of the given ID, see Open. */
+  [[nodiscard]] std::span<const base::Money> Turnover(base::ID id,
+                                                      size_t n) const {
+    return Window(turnover_, id, n);
+  }
+
+  /**
+   * @brief Returns the number of bars of the given ID.
+   *
+   * @param id The ID.
+   * @return The number of bars, at most N.
+   */
+  [[nodiscard]] size_t Size(base::ID id) const { return meta_[id].size_; }
+
+  /**
+   * @brief Returns the maximum number of bars kept for each ID.
+   *
+   * @return N.
+   */
+  [[nodiscard]] static constexpr size_t Capacity() { return N; }
+
+  /**
+   * @brief Returns the number of IDs.
+   *
+   * @return The number of IDs.
+   */
+  [[nodiscard]] size_t Count() const { return meta_.size(); }
 
 private:
-  std::vector<boost::circular_buffer<T>> chunks_;
+  struct Meta {
+    size_t head_{N - 1}; // ring index of the newest bar
+    size_t size_{0};
+    int32_t period_{0};
+  };
+
+  struct Time {
+    base::Date trading_day_;
+    base::Timestamp update_time_;
+  };
+
+  /// @brief Start of the 2N values of a field of an ID.
+  static size_t Ring(base::ID id) { return static_cast<size_t>(id) * 2 * N; }
+
+  template <typename T>
+  std::span<const T> Window(const std::vector<T> &field, base::ID id,
+                            size_t n) const {
+    return {field.data() + Ring(id) + meta_[id].head_ + N + 1 - n, n};
+  }
+
+  std::vector<base::Price> open_;
+  std::vector<base::Price> high_;
+  std::vector<base::Price> low_;
+  std::vector<base::Price> close_;
+  std::vector<base::Money> turnover_;
+  std::vector<base::Volume> volume_;
+  std::vector<Time> times_; // N per ID, not mirrored
+  std::vector<Meta> meta_;
 };
 
 /**
@@ -193,6 +570,41 @@ public:
     }
   }
 
+  /**
+   * @brief Retrieves the ID associated with the given name without
+   * allocating, for the market data path. Requires BuildIndex.
+   *
+   * @param name A fixed size, zero terminated field, e.g. a CTP instrument
+   * id.
+   * @return The ID associated with the given name, or -1 if it is unknown.
+   */
+  template <size_t N> base::ID FindID(const char (&name)[N]) const {
+    return index_.Find(name);
+  }
+
+  /**
+   * @brief Retrieves the ID associated with the given name without
+   * allocating. Requires BuildIndex.
+   *
+   * @param name The name to retrieve the ID for.
+   * @return The ID associated with the given name, or -1 if it is unknown.
+   */
+  base::ID FindID(std::string_view name) const { return index_.Find(name); }
+
+  /**
+   * @brief Builds the index used by FindID from the loaded names.
+   *
+   * @return False if a name is longer than util::SymbolIndex::kMaxLength.
+   */
+  bool BuildIndex() {
+    std::vector<std::string_view> names;
+    names.reserve(vec_.size());
+    for (const auto &v : vec_) {
+      names.emplace_back(v.name_);
+    }
+    return index_.Build(names);
+  }
+
   /**
    * @brief Returns a constant reference to the object with the specified ID.
    *
@@ -238,6 +650,7 @@ public:
 private:
   std::vector<T> vec_;
   std::unordered_map<std::string, base::ID> id_map_;
+  util::SymbolIndex index_;
 };
 
 class Clock {
@@ -245,7 +658,7 @@ public:
   Clock() { last_ts_ = base::Timestamp::Now(); }
   void Init(bool sim_test) { sim_test_ = sim_test; }
   void SetTime(const base::Timestamp &ts) { last_ts_ = ts; }
-  base::Timestamp Now() {
+  [[nodiscard]] base::Timestamp Now() const {
     return sim_test_ ? last_ts_ : base::Timestamp::Now();
   }
 
@@ -256,7 +669,7 @@ private:
 
 using StaticCenter = BufCenter<base::Static, 1>;
 
-using BarCenter = BufCenter<base::Bar, 240>;
+using BarCenter = BarSeries<240>;
 
 using DepthCenter = BufCenter<base::Depth, 2>;
 
@@ -299,11 +712,16 @@ public:
   void OnDepth(const base::Depth &depth) { depth_center_.PushBack(depth); }
 
   /**
-   * @brief Callback function for receiving bar data.
+   * @brief Callback function for receiving bar data. Bars are kept per
+   * period, bars of a period not in base::kBarPeriods are ignored.
    *
    * @param bar The bar data received.
    */
-  void OnBar(const base::Bar &bar) { bar_center_.PushBack(bar); }
+  void OnBar(const base::Bar &bar) {
+    if (const auto i = base::BarPeriodIndex(bar.period_); i >= 0) {
+      bar_centers_[i].PushBack(bar);
+    }
+  }
 
   /**
    * @brief Callback function for balance update.
@@ -320,11 +738,17 @@ public:
   const StaticCenter &GetStaticCenter() const { return st_center_; }
 
   /**
-   * @brief Returns the bar data buffer.
+   * @brief Returns the bar data buffer of a period.
    *
-   * @return The bar data buffer.
+   * @param period The bar period in seconds.
+   * @return The bar data buffer, nullptr if the period is not one of
+   * base::kBarPeriods.
    */
-  const BarCenter &GetBarCenter() const { return bar_center_; }
+  const BarCenter *
+  GetBarCenter(int32_t period = base::kDefaultBarPeriod) const {
+    const auto i = base::BarPeriodIndex(period);
+    return i >= 0 ? &bar_centers_[i] : nullptr;
+  }
 
   /**
    * @brief Returns the depth data buffer.
@@ -370,9 +794,23 @@ public:
 
   const Clock &GetClock() const { return clock_; }
 
+  /**
+   * @brief Puts the clock in simulation mode, where it only moves with
+   * SetTime.
+   */
+  void UseSimClock() { clock_.Init(true); }
+
+  /**
+   * @brief Moves the simulated clock, called by the backtest before every
+   * message it replays.
+   *
+   * @param ts The time of the message.
+   */
+  void SetTime(const base::Timestamp &ts) { clock_.SetTime(ts); }
+
 private:
   StaticCenter st_center_;
-  BarCenter bar_center_;
+  std::array<BarCenter, std::size(base::kBarPeriods)> bar_centers_;
   DepthCenter depth_center_;
   BalanceCenter bal_center_;
   InstrumentCenter ins_center_;
@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+#include <numeric>
+#include <random>
+
+#include <boost/circular_buffer.hpp>
+
+#include <core/ctx.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::core;
+
+constexpr int kInstruments = 1000;
+constexpr size_t kWindow = 60;
+
+/// @brief Fills every instrument with more bars than the center keeps, so the
+/// rings have wrapped.
+template <typename Center> void Fill(Center &center) {
+  center.Resize(kInstruments);
+  for (size_t i = 0; i < Center::Capacity() + 17; ++i) {
+    for (int id = 0; id < kInstruments; ++id) {
+      base::Bar bar{};
+      bar.id_ = id;
+      bar.close_ = 5000 + static_cast<double>((i * 7 + id) % 13);
+      center.PushBack(bar);
+    }
+  }
+}
+
+/// @brief Moving average of the close of every instrument, bar by bar.
+void MovingAverageAoS(benchmark::State &state) {
+  static BufCenter<base::Bar, BarCenter::Capacity()> bars;
+  if (bars.Count() == 0) {
+    Fill(bars);
+  }
+  for (auto _ : state) {
+    for (int id = 0; id < kInstruments; ++id) {
+      double sum = 0;
+      for (size_t n = 0; n < kWindow; ++n) {
+        sum += bars.ReverseNth(id, n).close_;
+      }
+      benchmark::DoNotOptimize(sum / kWindow);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kInstruments);
+}
+
+/// @brief Moving average of the close of every instrument over its window.
+void MovingAverageSoA(benchmark::State &state) {
+  static BarCenter bars;
+  if (bars.Count() == 0) {
+    Fill(bars);
+  }
+  for (auto _ : state) {
+    for (int id = 0; id < kInstruments; ++id) {
+      const auto close = bars.Close(id, kWindow);
+      benchmark::DoNotOptimize(
+          std::reduce(close.begin(), close.end(), 0.0) / kWindow);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kInstruments);
+}
+
+constexpr int kUniverse = 5000;
+
+/// @brief Random instruments of the whole universe, pushed to and read back.
+std::vector<base::InstrumentID> Shuffled() {
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<base::InstrumentID> id(0, kUniverse - 1);
+  std::vector<base::InstrumentID> ids(1 << 16);
+  for (auto &i : ids) {
+    i = id(rng);
+  }
+  return ids;
+}
+
+/// @brief What BufCenter used to be, a circular buffer per ID.
+struct ChunkCenter {
+  std::vector<boost::circular_buffer<base::Depth>> chunks_;
+
+  void Resize(size_t size) {
+    chunks_.resize(size, boost::circular_buffer<base::Depth>(2));
+  }
+  void PushBack(const base::Depth &depth) {
+    chunks_[depth.id_].push_back(depth);
+  }
+  [[nodiscard]] const base::Depth &Back(base::ID id) const {
+    return chunks_[id].back();
+  }
+};
+
+/// @brief A depth pushed to a random instrument, then the last depth of
+/// another read.
+template <typename Center> void PushBackAndBack(benchmark::State &state) {
+  static const auto ids = Shuffled();
+  Center center;
+  center.Resize(kUniverse);
+  base::Depth depth{};
+  for (int id = 0; id < kUniverse; ++id) {
+    depth.id_ = id;
+    center.PushBack(depth);
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    depth.id_ = ids[i++ & (ids.size() - 1)];
+    depth.last_ += 1;
+    center.PushBack(depth);
+    benchmark::DoNotOptimize(
+        center.Back(ids[(i * 7) & (ids.size() - 1)]).last_);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/// @brief The last depth of random instruments, what strategies do most.
+template <typename Center> void RandomBack(benchmark::State &state) {
+  static const auto ids = Shuffled();
+  Center center;
+  center.Resize(kUniverse);
+  base::Depth depth{};
+  for (int i = 0; i < 2 * kUniverse; ++i) {
+    depth.id_ = i % kUniverse;
+    center.PushBack(depth);
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(center.Back(ids[i++ & (ids.size() - 1)]).last_);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+BENCHMARK(MovingAverageAoS);
+BENCHMARK(MovingAverageSoA);
+BENCHMARK_TEMPLATE(PushBackAndBack, ChunkCenter);
+BENCHMARK_TEMPLATE(PushBackAndBack, DepthCenter);
+BENCHMARK_TEMPLATE(RandomBack, ChunkCenter);
+BENCHMARK_TEMPLATE(RandomBack, DepthCenter);
@@ -39,9 +39,135 @@ TEST(BufCenterTest, Init) {
   EXPECT_EQ(bc.Back(bar.id_).close_, bar.close_);
 }
 
+TEST(BufCenterTest, Wrap) {
+  BufCenter<Bar, 3> bc;
+  bc.Resize(2);
+  Bar bar{};
+  bar.id_ = 1;
+  for (int i = 0; i < 5; ++i) {
+    bar.close_ = i;
+    bc.PushBack(bar);
+  }
+  EXPECT_EQ(bc.Size(1), 3);
+  EXPECT_EQ(bc.Back(1).close_, 4);
+  EXPECT_EQ(bc.Prev(1).close_, 3);
+  EXPECT_EQ(bc.Nth(1, 0).close_, 2);
+  EXPECT_EQ(bc.ReverseNth(1, 2).close_, 2);
+  // Growing keeps what is there
+  bc.Resize(5000, true);
+  EXPECT_EQ(bc.Count(), 5000);
+  EXPECT_FALSE(bc.HasValue(0));
+  EXPECT_EQ(bc.Back(1).close_, 4);
+  EXPECT_EQ(bc.Nth(1, 0).close_, 2);
+  bar.id_ = 4999;
+  bc.PushBack(bar);
+  EXPECT_EQ(bc.Back(4999).close_, 4);
+}
+
+TEST(BufCenterTest, Latest) {
+  Depth depth{};
+  depth.id_ = 70;
+  BufCenter<Depth, 2> dc;
+  dc.Resize(100);
+  EXPECT_FALSE(dc.HasValue(70));
+  depth.last_ = 1;
+  dc.PushBack(depth);
+  EXPECT_TRUE(dc.HasValue(70));
+  EXPECT_FALSE(dc.HasPrev(70));
+  EXPECT_EQ(dc.Size(70), 1);
+  depth.last_ = 2;
+  dc.PushBack(depth);
+  depth.last_ = 3;
+  dc.PushBack(depth);
+  EXPECT_EQ(dc.Size(70), 2);
+  EXPECT_EQ(dc.Back(70).last_, 3);
+  EXPECT_EQ(dc.Prev(70).last_, 2);
+  EXPECT_EQ(dc.Nth(70, 0).last_, 2);
+  EXPECT_FALSE(dc.HasValue(69));
+  EXPECT_FALSE(dc.HasValue(71));
+  // Shrinking forgets the IDs past the new size
+  dc.Resize(65);
+  dc.Resize(100);
+  EXPECT_FALSE(dc.HasValue(70));
+
+  Static st{};
+  st.id_ = 3;
+  st.prev_close_ = 5;
+  BufCenter<Static, 1> sc;
+  sc.Resize(4);
+  sc.PushBack(st);
+  st.prev_close_ = 6;
+  sc.PushBack(st);
+  EXPECT_EQ(sc.Size(3), 1);
+  EXPECT_FALSE(sc.HasPrev(3));
+  EXPECT_EQ(sc.Back(3).prev_close_, 6);
+}
+
+TEST(BarSeriesTest, Window) {
+  BarSeries<4> bs;
+  bs.Resize(2);
+  EXPECT_EQ(bs.Count(), 2);
+  EXPECT_EQ(bs.Capacity(), 4);
+  EXPECT_FALSE(bs.HasValue(1));
+  for (int i = 0; i < 6; ++i) {
+    Bar bar{};
+    bar.trading_day_ = Date(20231106);
+    bar.update_time_ = Timestamp{1699232460L + i * 60, 0};
+    bar.id_ = 1;
+    bar.close_ = i;
+    bar.high_ = i + 0.5;
+    bar.volume_ = 10 * i;
+    bar.period_ = 60;
+    bs.PushBack(bar);
+  }
+  EXPECT_FALSE(bs.HasValue(0));
+  EXPECT_TRUE(bs.HasPrev(1));
+  EXPECT_EQ(bs.Size(1), 4);
+  // The oldest two were dropped, windows are contiguous across the wrap
+  const auto close = bs.Close(1, 4);
+  EXPECT_EQ(std::vector<Price>(close.begin(), close.end()),
+            (std::vector<Price>{2, 3, 4, 5}));
+  const auto volume = bs.Volume(1, 2);
+  EXPECT_EQ(std::vector<Volume>(volume.begin(), volume.end()),
+            (std::vector<Volume>{40, 50}));
+  EXPECT_EQ(bs.High(1, 1)[0], 5.5);
+  EXPECT_EQ(bs.Back(1).close_, 5);
+  EXPECT_EQ(bs.Back(1).update_time_.tv_sec, 1699232460L + 5 * 60);
+  EXPECT_EQ(bs.Back(1).trading_day_, Date(20231106));
+  EXPECT_EQ(bs.Back(1).period_, 60);
+  EXPECT_EQ(bs.Back(1).id_, 1);
+  EXPECT_EQ(bs.Prev(1).close_, 4);
+  EXPECT_EQ(bs.Nth(1, 0).close_, 2);
+  EXPECT_EQ(bs.Nth(1, 0).update_time_.tv_sec, 1699232460L + 2 * 60);
+  EXPECT_EQ(bs.ReverseNth(1, 3).volume_, 20);
+}
+
 TEST(ContextTest, Init) {
   Context ctx;
   EXPECT_TRUE(ctx.Init("./test"));
+  const auto &ins = ctx.GetInstrumentCenter();
+  for (auto i = 0; i < ins.Count(); ++i) {
+    EXPECT_EQ(ins.FindID(ins.Get(i).name_), i);
+  }
+  EXPECT_EQ(ins.FindID("cu9999"), -1);
+}
+
+TEST(ContextTest, GetBarCenter) {
+  Context ctx;
+  ASSERT_TRUE(ctx.Init("./test"));
+  Bar bar{};
+  bar.id_ = 1;
+  bar.period_ = 300;
+  bar.close_ = 7;
+  ctx.OnBar(bar);
+  ASSERT_NE(ctx.GetBarCenter(300), nullptr);
+  EXPECT_EQ(ctx.GetBarCenter(300)->Close(1, 1)[0], 7);
+  EXPECT_EQ(ctx.GetBarCenter()->Size(1), 0U);
+  // Not built, and not a bar of any period
+  EXPECT_EQ(ctx.GetBarCenter(7), nullptr);
+  bar.period_ = 7;
+  ctx.OnBar(bar);
+  EXPECT_EQ(ctx.GetBarCenter(0), nullptr);
 }
 
 } // namespace
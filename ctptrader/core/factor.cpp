@@ -1 +1,260 @@
-#include <core/factor.hpp>
\ No newline at end of file
+#include <core/factor.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <core/ctx.hpp>
+
+namespace ctptrader::core {
+
+namespace {
+
+/// @brief A field of a depth as a value.
+base::Value DepthValue(const base::Depth &depth, uint8_t field) {
+  switch (field) {
+  case DepthField_Last:
+    return depth.last_;
+  case DepthField_BidPrice:
+    return depth.bid_price_[0];
+  case DepthField_AskPrice:
+    return depth.ask_price_[0];
+  case DepthField_BidVolume:
+    return depth.bid_volume_[0];
+  case DepthField_AskVolume:
+    return depth.ask_volume_[0];
+  case DepthField_MidPrice:
+    return (depth.bid_price_[0] + depth.ask_price_[0]) / 2;
+  case DepthField_Volume:
+    return depth.volume_;
+  case DepthField_Turnover:
+    return depth.turnover_;
+  case DepthField_OpenInterest:
+    return depth.open_interest_;
+  default:
+    return std::numeric_limits<base::Value>::quiet_NaN();
+  }
+}
+
+/// @brief A field of a bar as a value.
+base::Value BarValue(const base::Bar &bar, uint8_t field) {
+  switch (field) {
+  case BarField_Open:
+    return bar.open_;
+  case BarField_High:
+    return bar.high_;
+  case BarField_Low:
+    return bar.low_;
+  case BarField_Close:
+    return bar.close_;
+  case BarField_Volume:
+    return bar.volume_;
+  case BarField_Turnover:
+    return bar.turnover_;
+  default:
+    return std::numeric_limits<base::Value>::quiet_NaN();
+  }
+}
+
+/// @brief Whether a factor value changed, NaN being equal to NaN.
+bool Changed(base::Value before, base::Value after) {
+  return before != after && !(std::isnan(before) && std::isnan(after));
+}
+
+} // namespace
+
+size_t FactorEngine::Add(std::unique_ptr<IFactor> factor) {
+  factors_.push_back(std::move(factor));
+  return factors_.size() - 1;
+}
+
+bool FactorEngine::Init(size_t instruments) {
+  const auto count = factors_.size();
+  nodes_.assign(count, {});
+  slot_values_.clear();
+  slot_factors_.clear();
+  depth_sources_.assign(instruments, {});
+  bar_sources_.assign(instruments * kPeriods, {});
+  // The factors reading every factor, and the roots of every source
+  std::vector<std::vector<uint32_t>> readers(count);
+  std::vector<std::vector<uint32_t>> depth_roots(instruments);
+  std::vector<std::vector<uint32_t>> bar_roots(instruments * kPeriods);
+  for (uint32_t f = 0; f < count; ++f) {
+    const auto inputs = factors_[f]->Inputs();
+    nodes_[f].first_slot_ = slot_values_.size();
+    nodes_[f].slots_ = inputs.size();
+    for (const auto &input : inputs) {
+      const auto slot = static_cast<uint32_t>(slot_values_.size());
+      slot_values_.push_back(std::numeric_limits<base::Value>::quiet_NaN());
+      slot_factors_.push_back(-1);
+      const auto source = input.source_;
+      switch (input.kind_) {
+      case FactorInput::Kind_Depth:
+        if (source < 0 || source >= static_cast<base::ID>(instruments)) {
+          LOG_ERROR("Factor %u reads the depth of unknown instrument %ld", f,
+                    source);
+          return false;
+        }
+        depth_sources_[source].feeds_.push_back({slot, f, input.field_});
+        depth_roots[source].push_back(f);
+        break;
+      case FactorInput::Kind_Bar: {
+        const auto period = base::BarPeriodIndex(input.period_);
+        if (source < 0 || source >= static_cast<base::ID>(instruments) ||
+            period < 0) {
+          LOG_ERROR("Factor %u reads %d second bars of instrument %ld", f,
+                    input.period_, source);
+          return false;
+        }
+        const auto at = source * kPeriods + period;
+        bar_sources_[at].feeds_.push_back({slot, f, input.field_});
+        bar_roots[at].push_back(f);
+        break;
+      }
+      case FactorInput::Kind_Factor:
+        if (source < 0 || source >= static_cast<base::ID>(count) ||
+            source == f) {
+          LOG_ERROR("Factor %u reads unknown factor %ld", f, source);
+          return false;
+        }
+        slot_factors_.back() = source;
+        readers[source].push_back(f);
+        break;
+      }
+    }
+  }
+
+  // Kahn's algorithm, a factor after every factor it reads
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> pending(count, 0);
+  for (const auto &r : readers) {
+    for (const auto f : r) {
+      ++pending[f];
+    }
+  }
+  for (uint32_t f = 0; f < count; ++f) {
+    if (pending[f] == 0) {
+      order.push_back(f);
+    }
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    for (const auto reader : readers[order[i]]) {
+      if (--pending[reader] == 0) {
+        order.push_back(reader);
+      }
+    }
+  }
+  if (order.size() != count) {
+    LOG_ERROR("%zu factors depend on each other in a cycle",
+              count - order.size());
+    return false;
+  }
+  std::vector<uint32_t> rank(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    rank[order[i]] = i;
+  }
+
+  dependents_.clear();
+  for (uint32_t f = 0; f < count; ++f) {
+    auto &r = readers[f];
+    std::sort(r.begin(), r.end());
+    r.erase(std::unique(r.begin(), r.end()), r.end());
+    nodes_[f].first_dependent_ = dependents_.size();
+    nodes_[f].dependents_ = r.size();
+    dependents_.insert(dependents_.end(), r.begin(), r.end());
+  }
+
+  // Everything a source reaches, in topological order
+  std::vector<uint8_t> seen(count, 0);
+  const auto reach = [&](std::vector<uint32_t> &roots, Source &source) {
+    auto &downstream = source.downstream_;
+    for (const auto f : roots) {
+      if (seen[f] == 0) {
+        seen[f] = 1;
+        downstream.push_back(f);
+      }
+    }
+    for (size_t i = 0; i < downstream.size(); ++i) {
+      for (const auto reader : readers[downstream[i]]) {
+        if (seen[reader] == 0) {
+          seen[reader] = 1;
+          downstream.push_back(reader);
+        }
+      }
+    }
+    for (const auto f : downstream) {
+      seen[f] = 0;
+    }
+    std::sort(downstream.begin(), downstream.end(),
+              [&rank](uint32_t a, uint32_t b) { return rank[a] < rank[b]; });
+  };
+  for (size_t i = 0; i < instruments; ++i) {
+    reach(depth_roots[i], depth_sources_[i]);
+  }
+  for (size_t i = 0; i < bar_sources_.size(); ++i) {
+    reach(bar_roots[i], bar_sources_[i]);
+  }
+
+  values_.assign(count, std::numeric_limits<base::Value>::quiet_NaN());
+  dirty_.assign(count, 0);
+  computations_ = 0;
+  return true;
+}
+
+void FactorEngine::OnDepth(const base::Depth &depth) {
+  if (depth.id_ < 0 ||
+      depth.id_ >= static_cast<base::ID>(depth_sources_.size())) {
+    return;
+  }
+  const auto &source = depth_sources_[depth.id_];
+  for (const auto &feed : source.feeds_) {
+    slot_values_[feed.slot_] = DepthValue(depth, feed.field_);
+    dirty_[feed.factor_] = 1;
+  }
+  Propagate(source, depth.update_time_);
+}
+
+void FactorEngine::OnBar(const base::Bar &bar) {
+  const auto period = base::BarPeriodIndex(bar.period_);
+  if (bar.id_ < 0 || period < 0 ||
+      bar.id_ >= static_cast<base::ID>(depth_sources_.size())) {
+    return;
+  }
+  const auto &source = bar_sources_[bar.id_ * kPeriods + period];
+  for (const auto &feed : source.feeds_) {
+    slot_values_[feed.slot_] = BarValue(bar, feed.field_);
+    dirty_[feed.factor_] = 1;
+  }
+  Propagate(source, bar.update_time_);
+}
+
+void FactorEngine::Propagate(const Source &source,
+                             const base::Timestamp &time) {
+  for (const auto f : source.downstream_) {
+    if (dirty_[f] == 0) {
+      continue;
+    }
+    dirty_[f] = 0;
+    const auto &node = nodes_[f];
+    const auto end = node.first_slot_ + node.slots_;
+    for (auto slot = node.first_slot_; slot < end; ++slot) {
+      if (const auto input = slot_factors_[slot]; input >= 0) {
+        slot_values_[slot] = values_[input];
+      }
+    }
+    auto &factor = *factors_[f];
+    const auto value = factor.Compute(
+        std::span(slot_values_.data() + node.first_slot_, node.slots_));
+    ++computations_;
+    factor.update_time_ = time;
+    if (!Changed(values_[f], value)) {
+      continue;
+    }
+    values_[f] = value;
+    factor.value_ = value;
+    for (uint32_t i = 0; i < node.dependents_; ++i) {
+      dirty_[dependents_[node.first_dependent_ + i]] = 1;
+    }
+  }
+}
+
+} // namespace ctptrader::core
\ No newline at end of file
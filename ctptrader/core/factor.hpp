@@ -1,5 +1,10 @@
 #pragma once
 
+#include <limits>
+#include <memory>
+#include <span>
+#include <vector>
+
 #include <base/def.hpp>
 #include <base/msg.hpp>
 #include <base/timestamp.hpp>
@@ -8,24 +13,187 @@
 
 namespace ctptrader::core {
 
+/** @brief A field of the depth of an instrument, as a factor input. */
+enum DepthField : uint8_t {
+  DepthField_Last,
+  DepthField_BidPrice,  /**< Best bid */
+  DepthField_AskPrice,  /**< Best ask */
+  DepthField_BidVolume, /**< At the best bid */
+  DepthField_AskVolume, /**< At the best ask */
+  DepthField_MidPrice,
+  DepthField_Volume, /**< Cumulative over the trading day */
+  DepthField_Turnover,
+  DepthField_OpenInterest
+};
+
+/** @brief A field of the bars of an instrument, as a factor input. */
+enum BarField : uint8_t {
+  BarField_Open,
+  BarField_High,
+  BarField_Low,
+  BarField_Close,
+  BarField_Volume,
+  BarField_Turnover
+};
+
+/**
+ * @brief An input of a factor: a field of the depth of an instrument, a field
+ * of its bars of a period, or the value of another factor.
+ */
+struct FactorInput {
+  enum Kind : uint8_t { Kind_Depth, Kind_Bar, Kind_Factor };
+
+  Kind kind_;
+  uint8_t field_;   /**< A DepthField or a BarField */
+  int32_t period_;  /**< Of the bars, in seconds */
+  base::ID source_; /**< The instrument, or the index of the factor */
+
+  static FactorInput OfDepth(base::InstrumentID id, DepthField field) {
+    return {Kind_Depth, field, 0, id};
+  }
+
+  static FactorInput OfBar(base::InstrumentID id, BarField field,
+                           int32_t period = base::kDefaultBarPeriod) {
+    return {Kind_Bar, field, period, id};
+  }
+
+  /** @param index The index FactorEngine::Add gave the factor. */
+  static FactorInput OfFactor(size_t index) {
+    return {Kind_Factor, 0, 0, static_cast<base::ID>(index)};
+  }
+};
+
+/**
+ * @brief A factor computed by a FactorEngine from the inputs it declares.
+ * Factors keep whatever state they need between computations, e.g. the
+ * average of a moving average.
+ */
 class IFactor : public boost::noncopyable {
 
 public:
   virtual ~IFactor() = default;
 
+  /** @brief Time of the tick or bar the value was last computed at. */
   [[nodiscard]] base::Timestamp UpdateTime() const { return update_time_; }
 
-  [[nodiscard]] base::Value Value() const {
-    return update_time_.tv_sec == 0 && update_time_.tv_nsec == 0;
-  }
+  /** @brief The last value, NaN until first computed. */
+  [[nodiscard]] base::Value Value() const { return value_; }
 
-  virtual void OnBar([[maybe_unused]] const base::Bar &bar) {}
+  /**
+   * @brief Declares the inputs of the factor, asked once by
+   * FactorEngine::Init.
+   *
+   * @return The inputs, in the order Compute gets their values.
+   */
+  [[nodiscard]] virtual std::vector<FactorInput> Inputs() const = 0;
 
-  virtual void OnTick([[maybe_unused]] const base::Depth &depth) {}
+  /**
+   * @brief Computes the value of the factor, called after an input changed.
+   *
+   * @param inputs The current values of the inputs, in the order of Inputs,
+   * NaN for those not seen yet.
+   * @return The new value.
+   */
+  virtual base::Value Compute(std::span<const base::Value> inputs) = 0;
+
+private:
+  friend class FactorEngine;
 
-protected:
   base::Timestamp update_time_{0, 0};
-  base::Value value_{0};
+  base::Value value_{std::numeric_limits<base::Value>::quiet_NaN()};
+};
+
+/**
+ * @brief Computes a set of factors incrementally from the ticks and bars of
+ * the instruments they read.
+ *
+ * Init builds the graph of the factors from their inputs and, for every
+ * instrument, the factors downstream of its depth and of its bars of every
+ * period, in topological order. A tick or bar only visits the factors
+ * downstream of its instrument: those whose inputs changed are computed, and
+ * a factor whose value changed marks the factors reading it, so nothing is
+ * computed twice and unchanged values stop the propagation.
+ *
+ * Values are kept in one flat array, read by the index Add returned without
+ * a virtual call.
+ */
+class FactorEngine {
+public:
+  /**
+   * @brief Adds a factor, before Init.
+   *
+   * @param factor The factor.
+   * @return The index of the factor, to read its value and to use it as the
+   * input of another factor.
+   */
+  size_t Add(std::unique_ptr<IFactor> factor);
+
+  /**
+   * @brief Builds the graph of the factors added.
+   *
+   * @param instruments The number of instruments.
+   * @return False if an input names no instrument, factor or bar period, or
+   * if factors depend on each other in a cycle.
+   */
+  bool Init(size_t instruments);
+
+  /** @brief Computes the factors downstream of the depth of an instrument. */
+  void OnDepth(const base::Depth &depth);
+
+  /** @brief Computes the factors downstream of the bars of an instrument. */
+  void OnBar(const base::Bar &bar);
+
+  /** @brief The value of a factor, NaN until first computed. */
+  [[nodiscard]] base::Value Value(size_t index) const { return values_[index]; }
+
+  /** @brief The values of all factors, by index. */
+  [[nodiscard]] std::span<const base::Value> Values() const { return values_; }
+
+  [[nodiscard]] const IFactor &Get(size_t index) const {
+    return *factors_[index];
+  }
+
+  [[nodiscard]] size_t Count() const { return factors_.size(); }
+
+  /** @brief Number of times a factor was computed since Init. */
+  [[nodiscard]] uint64_t Computations() const { return computations_; }
+
+private:
+  /** @brief A market data input of a factor, written when it arrives. */
+  struct Feed {
+    uint32_t slot_;
+    uint32_t factor_;
+    uint8_t field_;
+  };
+
+  /** @brief What a tick or a bar of an instrument reaches. */
+  struct Source {
+    std::vector<Feed> feeds_;
+    std::vector<uint32_t> downstream_; // in topological order
+  };
+
+  struct Node {
+    uint32_t first_slot_; // of its inputs
+    uint32_t slots_;
+    uint32_t first_dependent_;
+    uint32_t dependents_;
+  };
+
+  static constexpr size_t kPeriods = std::size(base::kBarPeriods);
+
+  /// @brief Computes the dirty factors of a source, in topological order.
+  void Propagate(const Source &source, const base::Timestamp &time);
+
+  std::vector<std::unique_ptr<IFactor>> factors_;
+  std::vector<base::Value> values_;
+  std::vector<Node> nodes_;
+  std::vector<base::Value> slot_values_; // the inputs of every factor
+  std::vector<int64_t> slot_factors_;    // the factor of a slot, or -1
+  std::vector<uint32_t> dependents_;     // of every factor
+  std::vector<uint8_t> dirty_;           // per factor
+  std::vector<Source> depth_sources_;    // per instrument
+  std::vector<Source> bar_sources_;      // per instrument and period
+  uint64_t computations_{0};
 };
 
 } // namespace ctptrader::core
\ No newline at end of file
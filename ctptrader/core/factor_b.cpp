@@ -0,0 +1,114 @@
+#include <benchmark/benchmark.h>
+#include <random>
+
+#include <core/factor.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::core;
+
+constexpr int kInstruments = 500;
+constexpr int kBasket = 10;
+
+/// @brief The mid price of an instrument.
+class Mid final : public IFactor {
+public:
+  explicit Mid(base::InstrumentID id)
+      : id_(id) {}
+
+  [[nodiscard]] std::vector<FactorInput> Inputs() const override {
+    return {FactorInput::OfDepth(id_, DepthField_BidPrice),
+            FactorInput::OfDepth(id_, DepthField_AskPrice)};
+  }
+
+  base::Value Compute(std::span<const base::Value> in) override {
+    return (in[0] + in[1]) / 2;
+  }
+
+private:
+  base::InstrumentID id_;
+};
+
+/// @brief An exponential moving average of another factor.
+class Ema final : public IFactor {
+public:
+  explicit Ema(size_t input)
+      : input_(input) {}
+
+  [[nodiscard]] std::vector<FactorInput> Inputs() const override {
+    return {FactorInput::OfFactor(input_)};
+  }
+
+  base::Value Compute(std::span<const base::Value> in) override {
+    ema_ = ema_ == 0 ? in[0] : ema_ + 0.1 * (in[0] - ema_);
+    return ema_;
+  }
+
+private:
+  size_t input_;
+  base::Value ema_{0};
+};
+
+/// @brief The mean of a basket of factors.
+class Mean final : public IFactor {
+public:
+  explicit Mean(std::vector<FactorInput> inputs)
+      : inputs_(std::move(inputs)) {}
+
+  [[nodiscard]] std::vector<FactorInput> Inputs() const override {
+    return inputs_;
+  }
+
+  base::Value Compute(std::span<const base::Value> in) override {
+    base::Value sum = 0;
+    for (const auto v : in) {
+      sum += v;
+    }
+    return sum / static_cast<base::Value>(in.size());
+  }
+
+private:
+  std::vector<FactorInput> inputs_;
+};
+
+/// @brief A mid and its average per instrument and the mean of the averages
+/// of every basket of instruments, fed ticks of random instruments.
+void Ticks(benchmark::State &state) {
+  FactorEngine engine;
+  std::vector<FactorInput> basket;
+  for (int id = 0; id < kInstruments; ++id) {
+    const auto mid = engine.Add(std::make_unique<Mid>(id));
+    basket.push_back(FactorInput::OfFactor(engine.Add(
+        std::make_unique<Ema>(mid))));
+    if (basket.size() == kBasket) {
+      engine.Add(std::make_unique<Mean>(std::move(basket)));
+      basket.clear();
+    }
+  }
+  if (!engine.Init(kInstruments)) {
+    state.SkipWithError("init failed");
+    return;
+  }
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> id(0, kInstruments - 1);
+  std::uniform_int_distribution<int> move(-2, 2);
+  std::vector<base::Depth> ticks(1 << 14);
+  for (auto &t : ticks) {
+    t.id_ = id(rng);
+    t.bid_price_[0] = 5000 + move(rng);
+    t.ask_price_[0] = t.bid_price_[0] + 1;
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    engine.OnDepth(ticks[i++ & (ticks.size() - 1)]);
+  }
+  benchmark::DoNotOptimize(engine.Values()[0]);
+  state.SetItemsProcessed(state.iterations());
+  state.counters["computed"] = benchmark::Counter(
+      static_cast<double>(engine.Computations()), benchmark::Counter::kIsRate);
+}
+
+} // namespace
+
+BENCHMARK(Ticks);
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <functional>
+
+#include <core/factor.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::base;
+using namespace ctptrader::core;
+
+/// @brief A factor of a function of its inputs that counts its computations.
+class Fn final : public IFactor {
+public:
+  using F = std::function<base::Value(std::span<const base::Value>)>;
+
+  Fn(std::vector<FactorInput> inputs, F f, int *computations = nullptr)
+      : inputs_(std::move(inputs))
+      , f_(std::move(f))
+      , computations_(computations) {}
+
+  [[nodiscard]] std::vector<FactorInput> Inputs() const override {
+    return inputs_;
+  }
+
+  base::Value Compute(std::span<const base::Value> inputs) override {
+    if (computations_ != nullptr) {
+      ++*computations_;
+    }
+    return f_(inputs);
+  }
+
+private:
+  std::vector<FactorInput> inputs_;
+  F f_;
+  int *computations_;
+};
+
+Value Sum(std::span<const Value> inputs) {
+  Value sum = 0;
+  for (const auto v : inputs) {
+    sum += v;
+  }
+  return sum;
+}
+
+Depth Tick(InstrumentID id, Price bid, Price ask, Price last = 0) {
+  Depth depth{};
+  depth.id_ = id;
+  depth.update_time_ = Timestamp{1699232460, 0};
+  depth.bid_price_[0] = bid;
+  depth.ask_price_[0] = ask;
+  depth.last_ = last;
+  return depth;
+}
+
+TEST(FactorEngineTest, Downstream) {
+  FactorEngine engine;
+  int sum_computed = 0;
+  int mid0_computed = 0;
+  int mid1_computed = 0;
+  // Added before the two factors it reads
+  const auto sum = engine.Add(std::make_unique<Fn>(
+      std::vector{FactorInput::OfFactor(1), FactorInput::OfFactor(2)}, Sum,
+      &sum_computed));
+  const auto mid0 = engine.Add(std::make_unique<Fn>(
+      std::vector{FactorInput::OfDepth(0, DepthField_MidPrice)},
+      [](auto in) { return in[0]; }, &mid0_computed));
+  const auto mid1 = engine.Add(std::make_unique<Fn>(
+      std::vector{FactorInput::OfDepth(1, DepthField_MidPrice)},
+      [](auto in) { return in[0]; }, &mid1_computed));
+  const auto spread0 = engine.Add(std::make_unique<Fn>(
+      std::vector{FactorInput::OfDepth(0, DepthField_AskPrice),
+                  FactorInput::OfDepth(0, DepthField_BidPrice)},
+      [](auto in) { return in[0] - in[1]; }));
+  ASSERT_TRUE(engine.Init(3));
+  EXPECT_EQ(engine.Count(), 4U);
+  EXPECT_TRUE(std::isnan(engine.Value(sum)));
+
+  engine.OnDepth(Tick(0, 100, 102));
+  EXPECT_EQ(engine.Value(mid0), 101);
+  EXPECT_EQ(engine.Value(spread0), 2);
+  EXPECT_EQ(engine.Get(mid0).Value(), 101);
+  EXPECT_EQ(engine.Get(mid0).UpdateTime().tv_sec, 1699232460);
+  // The other mid is not there yet
+  EXPECT_TRUE(std::isnan(engine.Value(sum)));
+  EXPECT_EQ(sum_computed, 1);
+  EXPECT_EQ(mid1_computed, 0);
+
+  engine.OnDepth(Tick(1, 50, 51));
+  EXPECT_EQ(engine.Value(mid1), 50.5);
+  EXPECT_EQ(engine.Values()[sum], 101 + 50.5);
+  EXPECT_EQ(mid0_computed, 1);
+  EXPECT_EQ(mid1_computed, 1);
+  EXPECT_EQ(sum_computed, 2);
+
+  // The mid did not move, nothing past it is computed
+  engine.OnDepth(Tick(0, 100, 102, 101));
+  EXPECT_EQ(mid0_computed, 2);
+  EXPECT_EQ(sum_computed, 2);
+  // Nobody reads instrument 2
+  engine.OnDepth(Tick(2, 1, 2));
+  EXPECT_EQ(engine.Computations(), 7U);
+}
+
+TEST(FactorEngineTest, Bars) {
+  FactorEngine engine;
+  const auto close = engine.Add(std::make_unique<Fn>(
+      std::vector{FactorInput::OfBar(1, BarField_Close, 300)},
+      [](auto in) { return in[0]; }));
+  ASSERT_TRUE(engine.Init(2));
+  Bar bar{};
+  bar.id_ = 1;
+  bar.period_ = 60;
+  bar.close_ = 7;
+  engine.OnBar(bar);
+  EXPECT_TRUE(std::isnan(engine.Value(close)));
+  bar.period_ = 300;
+  engine.OnBar(bar);
+  EXPECT_EQ(engine.Value(close), 7);
+}
+
+TEST(FactorEngineTest, Init) {
+  const auto echo = [](auto in) { return in[0]; };
+  FactorEngine cycle;
+  cycle.Add(std::make_unique<Fn>(std::vector{FactorInput::OfFactor(1)}, echo));
+  cycle.Add(std::make_unique<Fn>(
+      std::vector{FactorInput::OfFactor(0),
+                  FactorInput::OfDepth(0, DepthField_Last)},
+      Sum));
+  EXPECT_FALSE(cycle.Init(1));
+
+  FactorEngine unknown;
+  unknown.Add(std::make_unique<Fn>(
+      std::vector{FactorInput::OfDepth(1, DepthField_Last)}, echo));
+  EXPECT_FALSE(unknown.Init(1));
+
+  FactorEngine period;
+  period.Add(std::make_unique<Fn>(
+      std::vector{FactorInput::OfBar(0, BarField_Close, 7)}, echo));
+  EXPECT_FALSE(period.Init(1));
+}
+
+} // namespace
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+
+#include <core/match.hpp>
+
+namespace ctptrader::core {
+
+namespace {
+
+/// @brief Prices closer than this are the same level.
+constexpr base::Price kPriceEpsilon = 1e-6;
+
+base::Timestamp ToTimestamp(int64_t ns) {
+  base::Timestamp ts;
+  ts.tv_sec = ns / base::NANOSINSECOND;
+  ts.tv_nsec = ns % base::NANOSINSECOND;
+  return ts;
+}
+
+bool SamePrice(base::Price a, base::Price b) {
+  return std::abs(a - b) < kPriceEpsilon;
+}
+
+/// @brief Whether an order at price trades with the opposite side at level.
+bool Crosses(bool buy, base::Price price, base::Price level) {
+  return buy ? level <= price + kPriceEpsilon : level >= price - kPriceEpsilon;
+}
+
+/// @brief Whether price is ahead of level on the side of the order.
+bool Better(bool buy, base::Price price, base::Price level) {
+  return buy ? price > level + kPriceEpsilon : price < level - kPriceEpsilon;
+}
+
+/// @brief Volume shown at a price on one side of a book, -1 if the price is
+/// not in the book.
+base::Volume LevelVolume(const base::Price *prices,
+                         const base::Volume *volumes, base::Price price) {
+  // Every level is looked at, where the price is found varies from book to
+  // book and an early exit would be mispredicted
+  base::Volume volume = -1;
+  for (int l = 0; l < base::kBookLevels; ++l) {
+    const bool found = (volumes[l] > 0) & SamePrice(prices[l], price);
+    volume = found ? volumes[l] : volume;
+  }
+  return volume;
+}
+
+} // namespace
+
+void MatchEngine::OnArrival(const base::NewOrder &order, int64_t now_ns) {
+  const auto id = order.instrument_id_;
+  const bool buy = order.direction_ == base::Direction_Buy;
+  const bool market = order.price_type_ == base::PriceType_Market;
+  Order o{next_order_id_++, order.client_id_, order.strategy_id_,
+          order.direction_,  order.price_,     order.volume_,
+          0,                 kUnknownQueue,    -1};
+  // Rejected: pulled at once
+  if (id < 0 || id >= static_cast<base::ID>(books_.size()) ||
+      order.volume_ <= 0 ||
+      (!buy && order.direction_ != base::Direction_Sell) ||
+      (!market && order.price_type_ != base::PriceType_Limit)) {
+    Update(id, o, std::max(order.volume_, 0), now_ns);
+    return;
+  }
+  if (has_book_[id] != 0) {
+    auto &book = books_[id];
+    auto *prices = buy ? book.ask_price_ : book.bid_price_;
+    auto *volumes = buy ? book.ask_volume_ : book.bid_volume_;
+    for (int l = 0; l < base::kBookLevels && o.filled_ < o.volume_; ++l) {
+      if (volumes[l] <= 0) {
+        continue;
+      }
+      if (!market && !Crosses(buy, o.price_, prices[l])) {
+        break;
+      }
+      // What is taken stays taken until the next book
+      const auto take = std::min(volumes[l], o.volume_ - o.filled_);
+      volumes[l] -= take;
+      Fill(id, o, take, prices[l], now_ns);
+    }
+    o.shown_ = LevelVolume(buy ? book.bid_price_ : book.ask_price_,
+                           buy ? book.bid_volume_ : book.ask_volume_,
+                           o.price_);
+    o.ahead_ = std::max(o.shown_, 0);
+  }
+  if (market || o.filled_ == o.volume_) {
+    Update(id, o, o.volume_ - o.filled_, now_ns);
+    return;
+  }
+  Update(id, o, 0, now_ns);
+  resting_[id].push_back(o);
+}
+
+void MatchEngine::OnCancel(const base::CancelOrder &cancel, int64_t now_ns) {
+  const auto id = cancel.instrument_id_;
+  if (id < 0 || id >= static_cast<base::ID>(resting_.size())) {
+    return;
+  }
+  // An order filled or pulled by now is left alone
+  auto &orders = resting_[id];
+  const auto it =
+      std::find_if(orders.begin(), orders.end(), [&cancel](const Order &o) {
+        return o.strategy_id_ == cancel.strategy_id_ &&
+               o.client_id_ == cancel.client_id_;
+      });
+  if (it != orders.end()) {
+    Update(id, *it, it->volume_ - it->filled_, now_ns);
+    orders.erase(it);
+  }
+}
+
+void MatchEngine::Match(const base::Depth &depth, int64_t now_ns) {
+  const auto id = depth.id_;
+  const auto traded = has_book_[id] != 0
+                          ? std::max(depth.volume_ - books_[id].volume_, 0)
+                          : 0;
+  auto &orders = resting_[id];
+  for (auto &o : orders) {
+    const bool buy = o.direction_ == base::Direction_Buy;
+    const auto remaining = o.volume_ - o.filled_;
+    const auto best = buy ? depth.ask_price_[0] : depth.bid_price_[0];
+    const auto best_volume = buy ? depth.ask_volume_[0] : depth.bid_volume_[0];
+    // The other side reached the price or the market traded through it
+    if ((best_volume > 0 && Crosses(buy, o.price_, best)) ||
+        (traded > 0 && Better(buy, o.price_, depth.last_))) {
+      Fill(id, o, remaining, o.price_, now_ns);
+      Update(id, o, 0, now_ns);
+      continue;
+    }
+    const auto *prices = buy ? depth.bid_price_ : depth.ask_price_;
+    const auto *volumes = buy ? depth.bid_volume_ : depth.ask_volume_;
+    const auto level = LevelVolume(prices, volumes, o.price_);
+    const auto before = o.shown_;
+    o.shown_ = level;
+    if (o.ahead_ == kUnknownQueue) {
+      o.ahead_ = std::max(level, 0);
+      continue;
+    }
+    // Trades at the price take the front of the queue
+    const auto at_price =
+        traded > 0 && SamePrice(depth.last_, o.price_) ? traded : 0;
+    auto ahead = o.ahead_ - at_price;
+    if (ahead < 0) {
+      Fill(id, o, std::min(remaining, -ahead), o.price_, now_ns);
+      Update(id, o, 0, now_ns);
+      ahead = 0;
+    }
+    if (level < 0) {
+      // Alone at a price better than the book, or out of sight below it
+      if (volumes[0] <= 0 || Better(buy, o.price_, prices[0])) {
+        ahead = 0;
+      }
+    } else {
+      // Cancels are spread evenly over the queue
+      if (const auto cancelled = before - level - at_price;
+          before > 0 && cancelled > 0) {
+        // In doubles, an integer division takes several times longer
+        ahead -= static_cast<base::Volume>(static_cast<double>(cancelled) *
+                                           o.ahead_ / before);
+      }
+      ahead = std::clamp(ahead, 0, level);
+    }
+    o.ahead_ = ahead;
+  }
+  std::erase_if(orders, [](const Order &o) { return o.filled_ == o.volume_; });
+}
+
+void MatchEngine::Fill(base::InstrumentID id, Order &order,
+                       base::Volume volume, base::Price price,
+                       int64_t now_ns) {
+  order.filled_ += volume;
+  ++fills_;
+  filled_volume_ += volume;
+  base::Trade trade{};
+  trade.id_ = id;
+  trade.update_time_ = ToTimestamp(now_ns);
+  trade.price_ = price;
+  trade.volume_ = volume;
+  trade.direction_ = order.direction_;
+  reports_.push_back({now_ns + latency_ns_, order.strategy_id_, trade});
+}
+
+void MatchEngine::Update(base::InstrumentID id, const Order &order,
+                         base::Volume pulled, int64_t now_ns) {
+  base::OrderUpdate update{};
+  update.update_time_ = ToTimestamp(now_ns);
+  update.instrument_id_ = id;
+  update.order_id_ = order.order_id_;
+  update.client_id_ = order.client_id_;
+  update.price_ = order.price_;
+  update.volume_ = order.volume_;
+  update.filled_volume_ = order.filled_;
+  update.pulled_volume_ = pulled;
+  reports_.push_back({now_ns + latency_ns_, order.strategy_id_, update});
+}
+
+} // namespace ctptrader::core
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <base/msg.hpp>
+#include <core/stg.hpp>
+
+namespace ctptrader::core {
+
+/**
+ * @brief An update for a strategy from the matching simulator, due at a time.
+ */
+struct MatchReport {
+  int64_t time_ns_;      /**< When the strategy learns of it */
+  base::ID strategy_id_; /**< Of the order */
+  base::Msg msg_;        /**< An OrderUpdate or a Trade */
+};
+
+/**
+ * @brief Simulates the exchange for the orders of backtested strategies
+ * against the recorded books.
+ *
+ * Orders and cancels reach the exchange a latency after they are sent and
+ * updates reach the strategy a latency after they happen. On arrival an
+ * order takes what it crosses of the last book of its instrument, limit
+ * orders only up to their price; what is left of a limit order rests and
+ * what is left of a market order is pulled.
+ *
+ * A resting order keeps the volume queued ahead of it at its price, taken
+ * from the book when it arrives. Every book of the instrument then moves it
+ * up: trades at its price, estimated from the traded volume and the last
+ * price, take from the front of the queue first, and the rest of the volume
+ * the level lost counts as cancels spread evenly over the queue. An order
+ * fills at its price as far as the trades reach past the queue, and in full
+ * once the market trades through or crosses its price.
+ *
+ * Resting orders are kept in a flat array per instrument, a book without
+ * orders costs one copy.
+ */
+class MatchEngine final : public IOrderRouter {
+public:
+  /**
+   * @param instruments The number of instruments.
+   * @param latency_ns One-way latency between strategy and exchange.
+   */
+  explicit MatchEngine(size_t instruments = 0, int64_t latency_ns = 0)
+      : latency_ns_(latency_ns)
+      , books_(instruments)
+      , has_book_(instruments, 0)
+      , resting_(instruments) {}
+
+  void Send(const base::NewOrder &order) override {
+    pending_.push_back({ToNanos(order.create_time_) + latency_ns_, true,
+                        order, {}});
+  }
+
+  void Cancel(const base::CancelOrder &cancel) override {
+    pending_.push_back({ToNanos(cancel.create_time_) + latency_ns_, false,
+                        {}, cancel});
+  }
+
+  /**
+   * @brief Handles the orders and cancels that reached the exchange by now,
+   * against the last books.
+   */
+  void Advance(int64_t now_ns) {
+    while (next_pending_ < pending_.size() &&
+           pending_[next_pending_].arrival_ns_ <= now_ns) {
+      const auto &p = pending_[next_pending_++];
+      if (p.is_order_) {
+        OnArrival(p.order_, p.arrival_ns_);
+      } else {
+        OnCancel(p.cancel_, p.arrival_ns_);
+      }
+    }
+    if (next_pending_ == pending_.size()) {
+      pending_.clear();
+      next_pending_ = 0;
+    }
+  }
+
+  /**
+   * @brief Matches the resting orders of an instrument against its new book.
+   * Call Advance to the time of the book first.
+   *
+   * @param depth The book, of an instrument below the count given.
+   * @param now_ns The time of the book.
+   */
+  void OnDepth(const base::Depth &depth, int64_t now_ns) {
+    if (!resting_[depth.id_].empty()) {
+      Match(depth, now_ns);
+    }
+    books_[depth.id_] = depth;
+    has_book_[depth.id_] = 1;
+  }
+
+  /**
+   * @brief Hands the updates due by a time to f, in time order.
+   *
+   * @param until_ns The time.
+   * @param f Called with every MatchReport, may send orders.
+   */
+  template <typename F> void Drain(int64_t until_ns, F &&f) {
+    while (next_report_ < reports_.size() &&
+           reports_[next_report_].time_ns_ <= until_ns) {
+      f(reports_[next_report_++]);
+    }
+    if (next_report_ == reports_.size()) {
+      reports_.clear();
+      next_report_ = 0;
+    }
+  }
+
+  /** @brief Resting orders of an instrument. */
+  [[nodiscard]] size_t Resting(base::InstrumentID id) const {
+    return resting_[id].size();
+  }
+
+  [[nodiscard]] int64_t Fills() const { return fills_; }
+  [[nodiscard]] int64_t FilledVolume() const { return filled_volume_; }
+
+private:
+  /** @brief Volume ahead of an order that arrived before the first book. */
+  static constexpr base::Volume kUnknownQueue = -1;
+
+  struct Pending {
+    int64_t arrival_ns_;
+    bool is_order_;
+    base::NewOrder order_;
+    base::CancelOrder cancel_;
+  };
+
+  struct Order {
+    base::ID order_id_;
+    base::ID client_id_;
+    base::ID strategy_id_;
+    base::Direction direction_;
+    base::Price price_;
+    base::Volume volume_;
+    base::Volume filled_;
+    base::Volume ahead_; // queued before the order at its price
+    base::Volume shown_; // at its price in the last book, -1 if not in it
+  };
+
+  static int64_t ToNanos(const base::Timestamp &ts) {
+    return ts.tv_sec * base::NANOSINSECOND + ts.tv_nsec;
+  }
+
+  void OnArrival(const base::NewOrder &order, int64_t now_ns);
+
+  void OnCancel(const base::CancelOrder &cancel, int64_t now_ns);
+
+  void Match(const base::Depth &depth, int64_t now_ns);
+
+  /** @brief Reports a fill of an order as a Trade. */
+  void Fill(base::InstrumentID id, Order &order, base::Volume volume,
+            base::Price price, int64_t now_ns);
+
+  /** @brief Reports the state of an order as an OrderUpdate. */
+  void Update(base::InstrumentID id, const Order &order, base::Volume pulled,
+              int64_t now_ns);
+
+  const int64_t latency_ns_;
+  std::vector<base::Depth> books_; // the last of every instrument
+  std::vector<int> has_book_;
+  std::vector<std::vector<Order>> resting_; // per instrument
+  std::vector<Pending> pending_;            // in arrival order
+  size_t next_pending_{0};
+  std::vector<MatchReport> reports_; // in time order
+  size_t next_report_{0};
+  base::ID next_order_id_{1};
+  int64_t fills_{0};
+  int64_t filled_volume_{0};
+};
+
+} // namespace ctptrader::core
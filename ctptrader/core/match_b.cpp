@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+#include <core/match.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::core;
+
+constexpr int kInstruments = 100;
+constexpr int kEvents = 200000;
+constexpr base::Price kCenter = 5000;
+
+/// @brief Books of all instruments, interleaved. The touch wanders a tick
+/// around kCenter and a level or two change size every book, so orders three
+/// ticks away stay queued in sight and are never filled.
+std::vector<base::Depth> Books() {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> move(-1, 1);
+  std::uniform_int_distribution<int> size(1, 200);
+  std::uniform_int_distribution<int> level(0, 2 * base::kBookLevels - 1);
+  std::vector<base::Depth> books(kInstruments);
+  for (int id = 0; id < kInstruments; ++id) {
+    books[id].id_ = id;
+    for (int l = 0; l < base::kBookLevels; ++l) {
+      books[id].ask_volume_[l] = size(rng);
+      books[id].bid_volume_[l] = size(rng);
+    }
+  }
+  std::vector<base::Depth> events;
+  for (int i = 0; i < kEvents; ++i) {
+    auto &d = books[i % kInstruments];
+    const auto bid = kCenter + move(rng);
+    d.last_ = bid + move(rng) * 0.5 + 0.5;
+    d.volume_ += size(rng) / 20;
+    for (int l = 0; l < base::kBookLevels; ++l) {
+      d.ask_price_[l] = bid + 1 + l;
+      d.bid_price_[l] = bid - l;
+    }
+    for (int n = size(rng) % 2; n < 2; ++n) {
+      const auto l = level(rng);
+      auto &volume = l < base::kBookLevels
+                         ? d.ask_volume_[l]
+                         : d.bid_volume_[l - base::kBookLevels];
+      volume = size(rng);
+    }
+    events.push_back(d);
+  }
+  return events;
+}
+
+void BookEvents(benchmark::State &state) {
+  static const auto events = Books();
+  const auto orders = static_cast<int>(state.range(0));
+  MatchEngine engine(kInstruments);
+  for (const auto &d : events) {
+    engine.OnDepth(d, 0);
+  }
+  for (int id = 0; id < kInstruments; ++id) {
+    for (int i = 0; i < orders; ++i) {
+      base::NewOrder order{};
+      order.instrument_id_ = id;
+      order.client_id_ = i;
+      order.price_type_ = base::PriceType_Limit;
+      const auto buy = i % 2 == 0;
+      order.direction_ = buy ? base::Direction_Buy : base::Direction_Sell;
+      order.price_ = buy ? kCenter - 3 : kCenter + 4;
+      order.volume_ = 1;
+      engine.Send(order);
+    }
+  }
+  engine.Advance(0);
+  int64_t ns = 0;
+  for (auto _ : state) {
+    for (const auto &d : events) {
+      engine.OnDepth(d, ++ns);
+    }
+    engine.Drain(ns, [](const MatchReport &) {});
+  }
+  if (engine.Fills() != 0) {
+    state.SkipWithError("orders filled");
+  }
+  state.SetItemsProcessed(state.iterations() * kEvents);
+}
+
+} // namespace
+
+BENCHMARK(BookEvents)->Arg(0)->Arg(4);
@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <core/match.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::core;
+
+constexpr int64_t kStart = 1699016400L * base::NANOSINSECOND;
+constexpr int64_t kMs = 1000000;
+
+base::Timestamp At(int64_t ns) {
+  base::Timestamp ts;
+  ts.tv_sec = ns / base::NANOSINSECOND;
+  ts.tv_nsec = ns % base::NANOSINSECOND;
+  return ts;
+}
+
+/// @brief A book of instrument 0 with a tick of 1: bids from bid down, asks
+/// from ask up.
+base::Depth Book(int64_t ns, base::Price bid, base::Price ask,
+                 std::initializer_list<base::Volume> bid_volumes,
+                 std::initializer_list<base::Volume> ask_volumes,
+                 base::Volume volume = 0, base::Price last = 0) {
+  base::Depth d{};
+  d.update_time_ = At(ns);
+  d.id_ = 0;
+  d.volume_ = volume;
+  d.last_ = last;
+  int l = 0;
+  for (const auto v : bid_volumes) {
+    d.bid_price_[l] = bid - l;
+    d.bid_volume_[l++] = v;
+  }
+  l = 0;
+  for (const auto v : ask_volumes) {
+    d.ask_price_[l] = ask + l;
+    d.ask_volume_[l++] = v;
+  }
+  return d;
+}
+
+base::NewOrder Order(int64_t ns, base::ID client_id, base::Direction direction,
+                     base::Price price, base::Volume volume,
+                     base::PriceType type = base::PriceType_Limit) {
+  base::NewOrder order{};
+  order.create_time_ = At(ns);
+  order.instrument_id_ = 0;
+  order.client_id_ = client_id;
+  order.strategy_id_ = 1;
+  order.price_type_ = type;
+  order.direction_ = direction;
+  order.price_ = price;
+  order.volume_ = volume;
+  return order;
+}
+
+/// @brief What the strategies learn, the OrderUpdates and Trades apart.
+struct Reports {
+  std::vector<int64_t> times_;
+  std::vector<base::OrderUpdate> updates_;
+  std::vector<base::Trade> trades_;
+
+  void Drain(MatchEngine &engine, int64_t until_ns = INT64_MAX) {
+    engine.Drain(until_ns, [this](const MatchReport &r) {
+      EXPECT_EQ(r.strategy_id_, 1);
+      times_.push_back(r.time_ns_);
+      if (const auto *u = std::get_if<base::OrderUpdate>(&r.msg_)) {
+        updates_.push_back(*u);
+      } else {
+        trades_.push_back(std::get<base::Trade>(r.msg_));
+      }
+    });
+  }
+};
+
+TEST(MatchTest, QueuePosition) {
+  MatchEngine engine(1);
+  Reports reports;
+  engine.OnDepth(Book(kStart, 100, 101, {10, 5}, {8}), kStart);
+  engine.Send(Order(kStart, 7, base::Direction_Buy, 100, 4));
+  engine.Advance(kStart);
+  reports.Drain(engine);
+  // Resting behind the 10 lots shown at 100
+  ASSERT_EQ(reports.updates_.size(), 1U);
+  EXPECT_EQ(reports.updates_[0].client_id_, 7);
+  EXPECT_EQ(reports.updates_[0].filled_volume_, 0);
+  EXPECT_EQ(reports.updates_[0].pulled_volume_, 0);
+  EXPECT_EQ(engine.Resting(0), 1U);
+
+  const auto book = [&engine](int ms, base::Volume level,
+                              base::Volume volume) {
+    engine.OnDepth(Book(kStart + ms * kMs, 100, 101, {level, 5}, {8}, volume,
+                        100),
+                   kStart + ms * kMs);
+  };
+  // 6 lots trade at 100: 4 left ahead
+  book(1, 4, 6);
+  // 4 lots join behind, then 4 of the 8 are cancelled: 2 left ahead
+  book(2, 8, 6);
+  book(3, 4, 6);
+  reports.Drain(engine);
+  EXPECT_TRUE(reports.trades_.empty());
+  // 5 lots trade at 100: the 2 ahead, then 3 of ours
+  book(4, 1, 11);
+  reports.Drain(engine);
+  ASSERT_EQ(reports.trades_.size(), 1U);
+  EXPECT_EQ(reports.trades_[0].volume_, 3);
+  EXPECT_EQ(reports.trades_[0].price_, 100);
+  EXPECT_EQ(reports.trades_[0].direction_, base::Direction_Buy);
+  EXPECT_EQ(reports.updates_.back().filled_volume_, 3);
+  // The asks come down to 100: the last lot fills
+  engine.OnDepth(Book(kStart + 5 * kMs, 99, 100, {5}, {2}, 11, 100),
+                 kStart + 5 * kMs);
+  reports.Drain(engine);
+  ASSERT_EQ(reports.trades_.size(), 2U);
+  EXPECT_EQ(reports.trades_[1].volume_, 1);
+  EXPECT_EQ(reports.updates_.back().filled_volume_, 4);
+  EXPECT_EQ(engine.Resting(0), 0U);
+  EXPECT_EQ(engine.Fills(), 2);
+  EXPECT_EQ(engine.FilledVolume(), 4);
+}
+
+TEST(MatchTest, TakesTheBook) {
+  MatchEngine engine(1);
+  Reports reports;
+  engine.OnDepth(Book(kStart, 100, 101, {10}, {3, 4, 5}), kStart);
+  // Takes 101 and 102, rests the rest at 102 alone
+  engine.Send(Order(kStart, 1, base::Direction_Buy, 102, 10));
+  // A market order takes what the first took from the book no more
+  engine.Send(
+      Order(kStart, 2, base::Direction_Buy, 0, 8, base::PriceType_Market));
+  engine.Advance(kStart);
+  reports.Drain(engine);
+  ASSERT_EQ(reports.trades_.size(), 3U);
+  EXPECT_EQ(reports.trades_[0].price_, 101);
+  EXPECT_EQ(reports.trades_[0].volume_, 3);
+  EXPECT_EQ(reports.trades_[1].price_, 102);
+  EXPECT_EQ(reports.trades_[1].volume_, 4);
+  EXPECT_EQ(reports.trades_[2].price_, 103);
+  EXPECT_EQ(reports.trades_[2].volume_, 5);
+  ASSERT_EQ(reports.updates_.size(), 2U);
+  EXPECT_EQ(reports.updates_[0].filled_volume_, 7);
+  EXPECT_EQ(reports.updates_[0].pulled_volume_, 0);
+  // What the market order could not take is pulled
+  EXPECT_EQ(reports.updates_[1].filled_volume_, 5);
+  EXPECT_EQ(reports.updates_[1].pulled_volume_, 3);
+  EXPECT_EQ(engine.Resting(0), 1U);
+
+  // Nothing queued ahead at 102: the first trade at 102 fills it
+  engine.OnDepth(Book(kStart + kMs, 100, 103, {10}, {5}, 2, 102),
+                 kStart + kMs);
+  reports.Drain(engine);
+  ASSERT_EQ(reports.trades_.size(), 4U);
+  EXPECT_EQ(reports.trades_[3].volume_, 2);
+  EXPECT_EQ(reports.updates_.back().filled_volume_, 9);
+}
+
+TEST(MatchTest, TradeThrough) {
+  MatchEngine engine(1);
+  Reports reports;
+  engine.OnDepth(Book(kStart, 100, 101, {10}, {10}), kStart);
+  engine.Send(Order(kStart, 1, base::Direction_Sell, 101, 3));
+  engine.Advance(kStart);
+  // Traded at 102, past the 10 lots ahead at 101
+  engine.OnDepth(Book(kStart + kMs, 100, 102, {10}, {10}, 12, 102),
+                 kStart + kMs);
+  reports.Drain(engine);
+  ASSERT_EQ(reports.trades_.size(), 1U);
+  EXPECT_EQ(reports.trades_[0].volume_, 3);
+  EXPECT_EQ(reports.trades_[0].price_, 101);
+  EXPECT_EQ(reports.trades_[0].direction_, base::Direction_Sell);
+}
+
+TEST(MatchTest, CancelAndReject) {
+  MatchEngine engine(1);
+  Reports reports;
+  // No book yet: a market order is pulled, a limit order waits for one
+  engine.Send(
+      Order(kStart, 1, base::Direction_Sell, 0, 2, base::PriceType_Market));
+  engine.Send(Order(kStart, 2, base::Direction_Sell, 105, 2));
+  engine.Send(Order(kStart, 3, base::Direction_Invalid, 105, 2));
+  engine.Advance(kStart);
+  reports.Drain(engine);
+  ASSERT_EQ(reports.updates_.size(), 3U);
+  EXPECT_EQ(reports.updates_[0].pulled_volume_, 2);
+  EXPECT_EQ(reports.updates_[1].pulled_volume_, 0);
+  EXPECT_EQ(reports.updates_[2].pulled_volume_, 2);
+  EXPECT_EQ(engine.Resting(0), 1U);
+
+  base::CancelOrder cancel{};
+  cancel.create_time_ = At(kStart);
+  cancel.instrument_id_ = 0;
+  cancel.client_id_ = 2;
+  cancel.strategy_id_ = 1;
+  engine.Cancel(cancel);
+  // The order is gone by the second cancel
+  engine.Cancel(cancel);
+  engine.Advance(kStart);
+  reports.Drain(engine);
+  ASSERT_EQ(reports.updates_.size(), 4U);
+  EXPECT_EQ(reports.updates_[3].client_id_, 2);
+  EXPECT_EQ(reports.updates_[3].pulled_volume_, 2);
+  EXPECT_EQ(engine.Resting(0), 0U);
+}
+
+TEST(MatchTest, Latency) {
+  MatchEngine engine(1, 5 * kMs);
+  Reports reports;
+  engine.OnDepth(Book(kStart, 100, 101, {10}, {10}), kStart);
+  engine.Send(Order(kStart, 1, base::Direction_Buy, 101, 4));
+  // The asks are gone before the order arrives
+  engine.Advance(kStart + 4 * kMs);
+  engine.OnDepth(Book(kStart + 4 * kMs, 100, 101, {10}, {}), kStart + 4 * kMs);
+  engine.Advance(kStart + 6 * kMs);
+  reports.Drain(engine, kStart + 9 * kMs);
+  EXPECT_TRUE(reports.updates_.empty());
+  reports.Drain(engine, kStart + 10 * kMs);
+  ASSERT_EQ(reports.updates_.size(), 1U);
+  EXPECT_EQ(reports.times_[0], kStart + 10 * kMs);
+  EXPECT_EQ(reports.updates_[0].update_time_.tv_nsec, 5 * kMs);
+  EXPECT_EQ(reports.updates_[0].filled_volume_, 0);
+  EXPECT_EQ(engine.Resting(0), 1U);
+}
+
+} // namespace
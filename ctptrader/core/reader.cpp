@@ -1 +1,59 @@
-#include <core/reader.hpp>
\ No newline at end of file
+#include <core/reader.hpp>
+
+#include <cstring>
+#include <utility>
+
+namespace ctptrader::core {
+
+namespace {
+
+template <size_t I>
+bool Emplace(const void *data, uint16_t size, base::Msg &msg) {
+  using T = std::variant_alternative_t<I, base::Msg>;
+  if (size > sizeof(T)) {
+    return false;
+  }
+  // Levels a DepthDelta does not carry stay zero
+  std::memcpy(&msg.emplace<I>(), data, size);
+  return true;
+}
+
+template <size_t... I>
+bool ToMsg(uint16_t type, const void *data, uint16_t size, base::Msg &msg,
+           std::index_sequence<I...>) {
+  return ((type == I && Emplace<I>(data, size, msg)) || ...);
+}
+
+} // namespace
+
+bool ToMsg(uint16_t type, const void *data, uint16_t size, base::Msg &msg) {
+  return ToMsg(type, data, size, msg,
+               std::make_index_sequence<std::variant_size_v<base::Msg>>());
+}
+
+bool RecordFileReader::Open(const std::string &path, int64_t begin_ns) {
+  if (!reader_.Open(path)) {
+    offset_ = 0;
+    return false;
+  }
+  offset_ = begin_ns == INT64_MIN ? 0 : reader_.Seek(begin_ns);
+  return true;
+}
+
+bool RecordFileReader::Fill(MsgBlock &block) {
+  block.Clear();
+  // Records that hold no Msg are skipped
+  for (; offset_ < reader_.End() && block.msgs_.size() < kBlockMsgs;
+       offset_ = reader_.Next(offset_)) {
+    const auto &record = reader_.At(offset_);
+    if (ToMsg(record.type_, record.Data(), record.size_,
+              block.msgs_.emplace_back())) {
+      block.times_.push_back(record.time_ns_);
+    } else {
+      block.msgs_.pop_back();
+    }
+  }
+  return !block.msgs_.empty();
+}
+
+} // namespace ctptrader::core
\ No newline at end of file
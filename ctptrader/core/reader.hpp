@@ -1,45 +1,285 @@
 #pragma once
 
-#include <queue>
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
 
 #include <base/msg.hpp>
 #include <base/timestamp.hpp>
+#include <util/record.hpp>
+#include <util/tickfile.hpp>
 
 namespace ctptrader::core {
 
+/**
+ * @brief Messages decoded by a reader with their times in nanoseconds.
+ */
+struct MsgBlock {
+  std::vector<base::Msg> msgs_;
+  std::vector<int64_t> times_;
+
+  void Clear() {
+    msgs_.clear();
+    times_.clear();
+  }
+};
+
+/**
+ * @brief Messages per block. Every reader of a merge holds a block, so blocks
+ * are kept small enough for a thousand of them to stay in the caches.
+ */
+constexpr size_t kBlockMsgs = 64;
+
+/**
+ * @brief A source of messages in time order, read a block at a time so the
+ * merge costs one virtual call per block rather than per message.
+ */
 class IReader {
 public:
-  class Compare {
-  public:
-    bool operator()(const IReader *lhs, const IReader *rhs) const noexcept {
-      return lhs->PeekTimestamp() > rhs->PeekTimestamp();
-    }
-  };
   virtual ~IReader() = default;
-  [[nodiscard]] virtual base::Timestamp PeekTimestamp() const = 0;
-  [[nodiscard]] virtual bool Empty() const = 0;
-  [[nodiscard]] virtual base::Msg Pop() = 0;
+
+  /**
+   * @brief Reads the next block of messages.
+   *
+   * @param block Receives the messages, cleared first.
+   * @return False once the reader is exhausted and block is empty.
+   */
+  virtual bool Fill(MsgBlock &block) = 0;
 };
 
+/**
+ * @brief Merges readers in time order with a loser tree. Every message costs
+ * one comparison per level of the tree on int64 keys; readers are only
+ * called when a block runs out. Messages of equal time come in the order the
+ * readers were added.
+ */
 class MsgIter {
 public:
-  [[nodiscard]] bool Empty() const { return readers_.empty(); }
-  [[nodiscard]] base::Msg Next() {
-    const auto reader = readers_.top();
-    readers_.pop();
-    const auto msg = reader->Pop();
-    if (reader->Empty()) {
-      delete reader;
+  MsgIter() = default;
+
+  MsgIter(const MsgIter &) = delete;
+  MsgIter &operator=(const MsgIter &) = delete;
+
+  [[nodiscard]] bool Empty() {
+    if (!built_) {
+      Build();
+    }
+    return keys_[winner_] == kEnd;
+  }
+
+  /**
+   * @brief Time in nanoseconds of the message Next returns. Requires
+   * !Empty().
+   */
+  [[nodiscard]] int64_t PeekTime() {
+    if (!built_) {
+      Build();
+    }
+    return keys_[winner_];
+  }
+
+  /**
+   * @brief The next message. Requires !Empty().
+   *
+   * @return The message, valid until the next call.
+   */
+  [[nodiscard]] const base::Msg &Next() {
+    if (!built_) {
+      Build();
+    }
+    const auto leaf = winner_;
+    auto &l = leaves_[leaf];
+    const auto *msg = &l.block_.msgs_[l.pos_++];
+    if (l.pos_ < l.block_.msgs_.size()) {
+      keys_[leaf] = l.block_.times_[l.pos_];
     } else {
-      readers_.push(reader);
+      // The message returned lives on in retired_
+      std::swap(l.block_, retired_);
+      Load(leaf);
+    }
+    Replay(leaf);
+    return *msg;
+  }
+
+  /**
+   * @brief Takes ownership of a reader.
+   */
+  void AddReader(std::unique_ptr<IReader> reader) {
+    leaves_.push_back({std::move(reader), {}, 0});
+    built_ = false;
+  }
+
+private:
+  static constexpr int64_t kEnd = INT64_MAX;
+
+  struct Leaf {
+    std::unique_ptr<IReader> reader_;
+    MsgBlock block_;
+    size_t pos_;
+  };
+
+  /**
+   * @brief Whether leaf a at key ka beats leaf b at key kb, ties go to the
+   * leaf added first.
+   */
+  [[nodiscard]] static bool Beats(int64_t ka, uint32_t a, int64_t kb,
+                                  uint32_t b) {
+    // A coin toss for the branch predictor, so no branches
+    return (ka < kb) | ((ka == kb) & (a < b));
+  }
+
+  /** @brief Reads the next block of a leaf, its key is kEnd at the end. */
+  void Load(uint32_t leaf) {
+    auto &l = leaves_[leaf];
+    l.pos_ = 0;
+    keys_[leaf] = l.reader_->Fill(l.block_) && !l.block_.msgs_.empty()
+                      ? l.block_.times_[0]
+                      : kEnd;
+  }
+
+  /** @brief Plays the matches from a leaf whose key changed to the root. */
+  void Replay(uint32_t leaf) {
+    auto key = keys_[leaf];
+    auto winner = leaf;
+    for (auto node = (leaf + width_) / 2; node > 0; node /= 2) {
+      const auto loser_key = loser_keys_[node];
+      const auto loser = losers_[node];
+      // Selected with masks, the compiler would branch on a conditional
+      const auto swap = Beats(loser_key, loser, key, winner);
+      const auto key_mask = -static_cast<uint64_t>(swap);
+      const auto key_diff = (static_cast<uint64_t>(key) ^
+                             static_cast<uint64_t>(loser_key)) &
+                            key_mask;
+      const auto leaf_diff = (winner ^ loser) & static_cast<uint32_t>(key_mask);
+      loser_keys_[node] = static_cast<int64_t>(
+          static_cast<uint64_t>(loser_key) ^ key_diff);
+      losers_[node] = loser ^ leaf_diff;
+      key = static_cast<int64_t>(static_cast<uint64_t>(key) ^ key_diff);
+      winner ^= leaf_diff;
+    }
+    winner_ = winner;
+  }
+
+  /** @brief Loads the first blocks and plays every match once. */
+  void Build() {
+    built_ = true;
+    width_ = std::bit_ceil(std::max<uint32_t>(leaves_.size(), 1));
+    // Leaves past the readers are byes that never win
+    keys_.assign(width_, kEnd);
+    for (uint32_t leaf = 0; leaf < leaves_.size(); ++leaf) {
+      if (leaves_[leaf].block_.msgs_.empty()) {
+        Load(leaf);
+      } else {
+        keys_[leaf] = leaves_[leaf].block_.times_[leaves_[leaf].pos_];
+      }
+    }
+    std::vector<uint32_t> winners(2 * width_);
+    loser_keys_.assign(width_, kEnd);
+    losers_.assign(width_, 0);
+    for (uint32_t leaf = 0; leaf < width_; ++leaf) {
+      winners[width_ + leaf] = leaf;
+    }
+    for (auto node = width_ - 1; node > 0; --node) {
+      const auto a = winners[2 * node];
+      const auto b = winners[2 * node + 1];
+      const auto a_wins = Beats(keys_[a], a, keys_[b], b);
+      winners[node] = a_wins ? a : b;
+      losers_[node] = a_wins ? b : a;
+      loser_keys_[node] = keys_[losers_[node]];
+    }
+    winner_ = winners[1];
+  }
+
+  std::vector<Leaf> leaves_;
+  std::vector<int64_t> keys_;       // of the next message of every leaf
+  std::vector<int64_t> loser_keys_; // of the loser at every inner node
+  std::vector<uint32_t> losers_;    // of the match at every inner node
+  uint32_t width_{0};               // leaves, a power of two
+  uint32_t winner_{0};
+  MsgBlock retired_; // the block of the message last returned
+  bool built_{false};
+};
+
+/**
+ * @brief Copies a frame payload into a Msg.
+ *
+ * @param type The frame type, base::MsgType of the payload.
+ * @param data The payload.
+ * @param size Bytes of the payload, a DepthDelta may be shorter than its type.
+ * @param msg Receives the message.
+ * @return False if the type is no Msg or the payload is too large for it.
+ */
+bool ToMsg(uint16_t type, const void *data, uint16_t size, base::Msg &msg);
+
+/**
+ * @brief Replays a record file written by the recorder, in the order and at
+ * the times the frames were read from the market channel.
+ */
+class RecordFileReader final : public IReader {
+public:
+  /**
+   * @brief Opens a record file.
+   *
+   * @param path The record file.
+   * @param begin_ns Records read before this time are skipped.
+   * @return False if the file is missing or not a record file.
+   */
+  bool Open(const std::string &path, int64_t begin_ns = INT64_MIN);
+
+  bool Fill(MsgBlock &block) override;
+
+private:
+  util::RecordReader reader_;
+  uint64_t offset_{0};
+};
+
+/**
+ * @brief Replays the rows of one instrument from a tick file, a chunk at a
+ * time, at their update times.
+ *
+ * @tparam T base::Depth or base::Bar.
+ */
+template <typename T> class TickFileRowReader final : public IReader {
+public:
+  /**
+   * @param file The open tick file, shared by the readers of its
+   * instruments.
+   * @param chunks Chunks of the file with rows of one instrument and type,
+   * in time order.
+   */
+  TickFileRowReader(std::shared_ptr<const util::TickFileReader> file,
+                    std::span<const util::TickChunk> chunks)
+      : file_(std::move(file))
+      , chunks_(chunks) {}
+
+  bool Fill(MsgBlock &block) override {
+    block.Clear();
+    // Corrupt chunks are skipped
+    while (row_ == rows_.size() && next_chunk_ < chunks_.size()) {
+      const auto &chunk = chunks_[next_chunk_++];
+      rows_.resize(chunk.rows_);
+      rows_.resize(file_->Decode(chunk, rows_.data()));
+      row_ = 0;
+    }
+    const auto end = std::min(rows_.size(), row_ + kBlockMsgs);
+    for (; row_ < end; ++row_) {
+      const auto &row = rows_[row_];
+      block.msgs_.emplace_back(row);
+      block.times_.push_back(row.update_time_.tv_sec * base::NANOSINSECOND +
+                             row.update_time_.tv_nsec);
     }
-    return msg;
+    return !block.msgs_.empty();
   }
-  void AddReader(IReader *reader) { readers_.push(reader); }
 
 private:
-  std::priority_queue<IReader *, std::vector<IReader *>, IReader::Compare>
-      readers_;
+  std::shared_ptr<const util::TickFileReader> file_;
+  std::span<const util::TickChunk> chunks_;
+  size_t next_chunk_{0};
+  std::vector<T> rows_; // of the chunk being replayed
+  size_t row_{0};
 };
 
 } // namespace ctptrader::core
\ No newline at end of file
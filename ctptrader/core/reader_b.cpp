@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include <core/reader.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::core;
+
+constexpr int kMsgsPerStream = 1000;
+
+/// @brief Tick times of a stream: 500 ms apart with jitter, so streams
+/// interleave.
+std::vector<int64_t> Times(int stream) {
+  std::mt19937 rng(stream);
+  std::uniform_int_distribution<int64_t> jitter(0, 499999999);
+  std::vector<int64_t> times;
+  for (int i = 0; i < kMsgsPerStream; ++i) {
+    times.push_back(i * 500000000L + jitter(rng));
+  }
+  std::sort(times.begin(), times.end());
+  return times;
+}
+
+/// @brief Depths of one instrument at the given times, a block at a time.
+class DepthReader final : public IReader {
+public:
+  DepthReader(const std::vector<int64_t> &times, int id)
+      : times_(times) {
+    depth_.id_ = id;
+  }
+
+  bool Fill(MsgBlock &block) override {
+    block.Clear();
+    for (; next_ < times_.size() && block.msgs_.size() < kBlockMsgs;
+         ++next_) {
+      block.msgs_.emplace_back(depth_);
+      block.times_.push_back(times_[next_]);
+    }
+    return !block.msgs_.empty();
+  }
+
+private:
+  const std::vector<int64_t> &times_;
+  size_t next_{0};
+  base::Depth depth_{};
+};
+
+/// @brief The merge MsgIter used to do: a heap of readers with three virtual
+/// calls and a Msg copy per message.
+class HeapReader {
+public:
+  HeapReader(const std::vector<int64_t> &times, int id)
+      : times_(times) {
+    depth_.id_ = id;
+  }
+  virtual ~HeapReader() = default;
+  [[nodiscard]] virtual base::Timestamp PeekTimestamp() const {
+    base::Timestamp ts;
+    ts.tv_sec = times_[next_] / base::NANOSINSECOND;
+    ts.tv_nsec = times_[next_] % base::NANOSINSECOND;
+    return ts;
+  }
+  [[nodiscard]] virtual bool Empty() const { return next_ >= times_.size(); }
+  [[nodiscard]] virtual base::Msg Pop() {
+    ++next_;
+    return depth_;
+  }
+
+private:
+  const std::vector<int64_t> &times_;
+  size_t next_{0};
+  base::Depth depth_{};
+};
+
+struct HeapCompare {
+  bool operator()(const HeapReader *lhs, const HeapReader *rhs) const {
+    return lhs->PeekTimestamp() > rhs->PeekTimestamp();
+  }
+};
+
+std::vector<std::vector<int64_t>> Streams(int count) {
+  std::vector<std::vector<int64_t>> streams;
+  for (int s = 0; s < count; ++s) {
+    streams.push_back(Times(s));
+  }
+  return streams;
+}
+
+void LoserTreeMerge(benchmark::State &state) {
+  const auto streams = Streams(static_cast<int>(state.range(0)));
+  int64_t merged = 0;
+  for (auto _ : state) {
+    MsgIter iter;
+    for (size_t s = 0; s < streams.size(); ++s) {
+      iter.AddReader(
+          std::make_unique<DepthReader>(streams[s], static_cast<int>(s)));
+    }
+    while (!iter.Empty()) {
+      benchmark::DoNotOptimize(iter.PeekTime());
+      benchmark::DoNotOptimize(&iter.Next());
+      ++merged;
+    }
+  }
+  state.SetItemsProcessed(merged);
+}
+BENCHMARK(LoserTreeMerge)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+void HeapMerge(benchmark::State &state) {
+  const auto streams = Streams(static_cast<int>(state.range(0)));
+  int64_t merged = 0;
+  for (auto _ : state) {
+    std::priority_queue<HeapReader *, std::vector<HeapReader *>, HeapCompare>
+        readers;
+    for (size_t s = 0; s < streams.size(); ++s) {
+      readers.push(new HeapReader(streams[s], static_cast<int>(s)));
+    }
+    while (!readers.empty()) {
+      const auto reader = readers.top();
+      readers.pop();
+      benchmark::DoNotOptimize(reader->PeekTimestamp());
+      const auto msg = reader->Pop();
+      benchmark::DoNotOptimize(&msg);
+      if (reader->Empty()) {
+        delete reader;
+      } else {
+        readers.push(reader);
+      }
+      ++merged;
+    }
+  }
+  state.SetItemsProcessed(merged);
+}
+BENCHMARK(HeapMerge)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include <core/reader.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::core;
+
+constexpr int64_t kStart = 1699016400L * base::NANOSINSECOND;
+
+base::Timestamp At(int64_t ns) {
+  base::Timestamp ts;
+  ts.tv_sec = ns / base::NANOSINSECOND;
+  ts.tv_nsec = ns % base::NANOSINSECOND;
+  return ts;
+}
+
+/// @brief Frames as they sit on the market channel: header, then payload.
+struct Frame {
+  util::FrameHeader header_;
+  base::Depth depth_;
+};
+
+class ReaderTest : public ::testing::Test {
+protected:
+  void SetUp() override { TearDown(); }
+  void TearDown() override {
+    std::filesystem::remove(kRecordPath);
+    std::filesystem::remove(kTickPath);
+  }
+
+  static constexpr char kRecordPath[] = "reader_t.rec";
+  static constexpr char kTickPath[] = "reader_t.tick";
+};
+
+TEST_F(ReaderTest, ToMsg) {
+  base::DepthDelta delta{};
+  delta.id_ = 3;
+  delta.count_ = 1;
+  delta.levels_[0].price_ = 10;
+  base::Msg msg;
+  ASSERT_TRUE(ToMsg(base::MsgType<base::DepthDelta>, &delta,
+                    base::DepthDeltaSize(delta), msg));
+  ASSERT_TRUE(std::holds_alternative<base::DepthDelta>(msg));
+  EXPECT_EQ(std::get<base::DepthDelta>(msg).id_, 3);
+  EXPECT_EQ(std::get<base::DepthDelta>(msg).levels_[0].price_, 10);
+  const base::Depth depth{};
+  EXPECT_FALSE(ToMsg(base::MsgType<base::Bar>, &depth, sizeof(depth), msg));
+  EXPECT_FALSE(ToMsg(util::kPaddingFrame, &depth, 8, msg));
+}
+
+TEST_F(ReaderTest, MergeRecordAndTickFiles) {
+  // Instrument 0 is recorded at even, instrument 1 stored at odd seconds
+  util::RecordWriter writer;
+  ASSERT_TRUE(writer.Open(kRecordPath, 20231106));
+  Frame frame{};
+  frame.header_.type_ = base::MsgType<base::Depth>;
+  frame.header_.size_ = sizeof(base::Depth);
+  util::TickFileWriter ticks(4);
+  ASSERT_TRUE(ticks.Open(kTickPath));
+  for (int i = 0; i < 10; ++i) {
+    const auto ns = kStart + 2 * i * base::NANOSINSECOND;
+    frame.header_.seq_ = i;
+    frame.depth_.id_ = 0;
+    frame.depth_.last_ = i;
+    frame.depth_.update_time_ = At(ns);
+    writer.Append(frame.header_, ns);
+    auto depth = frame.depth_;
+    depth.id_ = 1;
+    depth.update_time_ = At(ns + base::NANOSINSECOND);
+    ticks.Append(depth, 1);
+  }
+  writer.Close();
+  ASSERT_TRUE(ticks.Close());
+
+  MsgIter iter;
+  auto record = std::make_unique<RecordFileReader>();
+  ASSERT_TRUE(record->Open(kRecordPath));
+  iter.AddReader(std::move(record));
+  auto file = std::make_shared<util::TickFileReader>();
+  ASSERT_TRUE(file->Open(kTickPath));
+  iter.AddReader(std::make_unique<TickFileRowReader<base::Depth>>(
+      file, file->FindDepths(1)));
+  iter.AddReader(std::make_unique<TickFileRowReader<base::Bar>>(
+      file, file->FindBars(1, 60)));
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_FALSE(iter.Empty());
+    EXPECT_EQ(iter.PeekTime(), kStart + i * base::NANOSINSECOND);
+    const auto &msg = iter.Next();
+    ASSERT_TRUE(std::holds_alternative<base::Depth>(msg));
+    const auto &depth = std::get<base::Depth>(msg);
+    EXPECT_EQ(depth.id_, i % 2);
+    EXPECT_EQ(depth.last_, i / 2);
+  }
+  EXPECT_TRUE(iter.Empty());
+}
+
+/// @brief Replays a list of times in blocks of three.
+class ListReader final : public IReader {
+public:
+  ListReader(std::vector<int64_t> times, int id)
+      : times_(std::move(times))
+      , id_(id) {}
+
+  bool Fill(MsgBlock &block) override {
+    block.Clear();
+    for (; next_ < times_.size() && block.msgs_.size() < 3; ++next_) {
+      base::Bar bar{};
+      bar.id_ = id_;
+      block.msgs_.emplace_back(bar);
+      block.times_.push_back(times_[next_]);
+    }
+    return !block.msgs_.empty();
+  }
+
+private:
+  std::vector<int64_t> times_;
+  size_t next_{0};
+  int id_;
+};
+
+TEST_F(ReaderTest, MergeOrder) {
+  MsgIter iter;
+  EXPECT_TRUE(iter.Empty());
+  iter.AddReader(std::make_unique<ListReader>(std::vector<int64_t>{}, 0));
+  iter.AddReader(
+      std::make_unique<ListReader>(std::vector<int64_t>{1, 4, 4, 9, 10}, 1));
+  iter.AddReader(
+      std::make_unique<ListReader>(std::vector<int64_t>{2, 3, 4, 5, 6, 7}, 2));
+  std::vector<std::pair<int64_t, base::InstrumentID>> seen;
+  const auto next = [&iter, &seen]() {
+    const auto time = iter.PeekTime();
+    seen.emplace_back(time, std::get<base::Bar>(iter.Next()).id_);
+  };
+  for (int i = 0; i < 4; ++i) {
+    next();
+  }
+  // Readers added while merging join at their first message
+  iter.AddReader(std::make_unique<ListReader>(std::vector<int64_t>{4, 8}, 3));
+  while (!iter.Empty()) {
+    next();
+  }
+  // Equal times come in the order the readers were added
+  const std::vector<std::pair<int64_t, base::InstrumentID>> expected = {
+      {1, 1}, {2, 2}, {3, 2}, {4, 1}, {4, 1}, {4, 2}, {4, 3},
+      {5, 2}, {6, 2}, {7, 2}, {8, 3}, {9, 1}, {10, 1}};
+  EXPECT_EQ(seen, expected);
+}
+
+TEST_F(ReaderTest, MissingRecordFile) {
+  RecordFileReader reader;
+  EXPECT_FALSE(reader.Open(kRecordPath));
+  MsgBlock block;
+  EXPECT_FALSE(reader.Fill(block));
+}
+
+} // namespace
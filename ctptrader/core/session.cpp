@@ -0,0 +1,86 @@
+#include <core/session.hpp>
+
+#include <algorithm>
+
+namespace ctptrader::core {
+
+namespace {
+
+constexpr int FromHhmm(int hhmm) {
+  return TradingHours::FromTimeOfDay(hhmm / 100 * 3600 + hhmm % 100 * 60);
+}
+
+} // namespace
+
+void TradingHours::Add(int begin_hhmm, int end_hhmm, bool opens) {
+  periods_[count_++] = {FromHhmm(begin_hhmm), FromHhmm(end_hhmm), opens};
+}
+
+TradingHours TradingHours::For(base::Exchange exchange,
+                               std::string_view product, int night_end) {
+  // Equity index futures and options, and treasury futures, which close a
+  // quarter of an hour later
+  static constexpr std::string_view kIndex[] = {"IF", "IH", "IC", "IM",
+                                                "IO", "HO", "MO"};
+  static constexpr std::string_view kTreasury[] = {"T", "TF", "TS", "TL"};
+  const auto listed = [product](const auto &products) {
+    return std::find(std::begin(products), std::end(products), product) !=
+           std::end(products);
+  };
+  TradingHours hours;
+  switch (exchange) {
+  case base::Exchange_FFEX:
+    if (listed(kIndex)) {
+      hours.Add(930, 1130, true);
+      hours.Add(1300, 1500, false);
+    } else if (listed(kTreasury)) {
+      hours.Add(930, 1130, true);
+      hours.Add(1300, 1515, false);
+    }
+    break;
+  case base::Exchange_XSHG:
+  case base::Exchange_XSHE:
+    hours.Add(930, 1130, true);
+    hours.Add(1300, 1500, false);
+    break;
+  default:
+    if (night_end != 0) {
+      hours.Add(2100, night_end, true);
+    }
+    // Opening auctions run from 20:55 and 8:55
+    hours.Add(900, 1015, true);
+    hours.Add(1030, 1130, false);
+    hours.Add(1330, 1500, false);
+    break;
+  }
+  return hours;
+}
+
+void TradingDays::Init(const CalendarCenter &calendar) {
+  days_.clear();
+  if (calendar.Count() == 0) {
+    return;
+  }
+  const auto day = [](base::Date date) {
+    return base::Timestamp::DaysFromCivil(date.Year(), date.Month(),
+                                          date.Day());
+  };
+  first_day_ = day(calendar.Get(0).date_);
+  for (auto i = 0; i < calendar.Count(); ++i) {
+    const auto &date = calendar.Get(i);
+    const auto evening = day(date.date_) - first_day_;
+    if (evening < 0) {
+      continue;
+    }
+    if (evening >= static_cast<long>(days_.size())) {
+      days_.resize(evening + 1, 0);
+    }
+    const auto next = date.next_trading_day_id_;
+    // The last days of the calendar have no next trading day in it
+    if (calendar.HasID(next) && calendar.Get(next).date_ > date.date_) {
+      days_[evening] = calendar.Get(next).date_.AsInt();
+    }
+  }
+}
+
+} // namespace ctptrader::core
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <vector>
+
+#include <base/def.hpp>
+#include <core/ctx.hpp>
+
+namespace ctptrader::core {
+
+/**
+ * @brief The continuous trading periods of a product. Times are seconds since
+ * 18:00 of the evening before the trading day, so that the night session sorts
+ * before the day session of the same trading day.
+ */
+class TradingHours {
+public:
+  /** Auction ticks up to this long before a session opens belong to it. */
+  static constexpr int kPreOpen = 15 * 60;
+  /** Closing ticks up to this long after a period ends belong to it. */
+  static constexpr int kCloseGrace = 60;
+
+  /** Where a tick falls in the trading hours. */
+  struct Placement {
+    int time_{-1};          /**< Placed time, -1 outside trading hours */
+    bool opens_day_{false}; /**< Auction tick before the first period */
+    bool closing_{false};   /**< Closing tick of a period */
+  };
+
+  /**
+   * @brief Converts seconds since midnight to seconds since 18:00 of the
+   * evening before the trading day.
+   */
+  static constexpr int FromTimeOfDay(int seconds) {
+    return seconds >= kEvening ? seconds - kEvening : seconds + kDay - kEvening;
+  }
+
+  /**
+   * @brief The trading hours of a product.
+   *
+   * @param exchange The exchange the product is listed on.
+   * @param product The product, the hours of CFFEX products differ.
+   * @param night_end HHMM the night session ends, 0 without one.
+   * @return The trading hours, none for a CFFEX product it does not know.
+   */
+  static TradingHours For(base::Exchange exchange, std::string_view product,
+                          int night_end);
+
+  /**
+   * @brief Places a tick. Auction ticks before a session opens move to its
+   * first second and closing ticks right after a period ends move to its
+   * last second.
+   *
+   * @param time Seconds since 18:00 of the evening before the trading day.
+   * @return The placement of the tick.
+   */
+  [[nodiscard]] Placement Place(int time) const {
+    for (int i = 0; i < count_; ++i) {
+      const auto &p = periods_[i];
+      if (time >= p.begin_ && time < p.end_) {
+        return {time, false, false};
+      }
+      if (p.opens_ && time >= p.begin_ - kPreOpen && time < p.begin_) {
+        return {p.begin_, i == 0, false};
+      }
+      if (time >= p.end_ && time < p.end_ + kCloseGrace) {
+        return {p.end_ - 1, false, true};
+      }
+    }
+    return {};
+  }
+
+private:
+  static constexpr int kEvening = 18 * 3600;
+  static constexpr int kDay = 24 * 3600;
+
+  struct Period {
+    int begin_;
+    int end_;
+    bool opens_; // preceded by an auction
+  };
+
+  void Add(int begin_hhmm, int end_hhmm, bool opens);
+
+  std::array<Period, 5> periods_{};
+  int count_{0};
+};
+
+/**
+ * @brief The trading day of every session in the calendar. The session that
+ * starts on an evening belongs to the next trading day, so a Friday night
+ * session belongs to Monday.
+ */
+class TradingDays {
+public:
+  /** The session a time falls in. */
+  struct Session {
+    long evening_;    /**< Days since the epoch of the evening it starts */
+    int time_;        /**< Seconds since 18:00 of that evening */
+    int trading_day_; /**< yyyymmdd, 0 if not in the calendar */
+  };
+
+  void Init(const CalendarCenter &calendar);
+
+  /**
+   * @brief Finds the session of a time.
+   *
+   * @param epoch Seconds since the epoch.
+   * @return The session, with trading_day_ 0 outside the calendar.
+   */
+  [[nodiscard]] Session Find(time_t epoch) const {
+    const auto local = epoch + base::CSTOFFSET;
+    const auto time = TradingHours::FromTimeOfDay(local % base::SECONDSINDAY);
+    const auto evening = (local - time) / base::SECONDSINDAY;
+    const auto i = evening - first_day_;
+    const auto trading_day =
+        i >= 0 && i < static_cast<long>(days_.size()) ? days_[i] : 0;
+    return {evening, time, trading_day};
+  }
+
+private:
+  std::vector<int> days_; // per evening since first_day_, 0 if none
+  long first_day_{0};
+};
+
+} // namespace ctptrader::core
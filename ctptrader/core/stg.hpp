@@ -8,6 +8,34 @@
 
 namespace ctptrader::core {
 
+/**
+ * @brief What a strategy made over a backtest, summed over the days and the
+ * strategies of a run.
+ */
+struct SimResult {
+  double pnl_{0};     /**< Profit and loss, fees included */
+  int64_t fills_{0};  /**< Fills of the orders sent, by the matching sim */
+  int64_t volume_{0}; /**< Lots filled, by the matching sim */
+
+  SimResult &operator+=(const SimResult &other) {
+    pnl_ += other.pnl_;
+    fills_ += other.fills_;
+    volume_ += other.volume_;
+    return *this;
+  }
+};
+
+/**
+ * @brief Where the orders of strategies go, the matching simulator in a
+ * backtest.
+ */
+class IOrderRouter {
+public:
+  virtual ~IOrderRouter() = default;
+  virtual void Send(const base::NewOrder &order) = 0;
+  virtual void Cancel(const base::CancelOrder &cancel) = 0;
+};
+
 class IStrategy : public boost::noncopyable {
 public:
   virtual ~IStrategy() = default;
@@ -16,6 +44,17 @@ public:
   virtual void OnDepth([[maybe_unused]] const base::Depth &depth) {}
   virtual void OnBar([[maybe_unused]] const base::Bar &bar) {}
   virtual void OnBalance([[maybe_unused]] const base::Balance &bal) {}
+  virtual void
+  OnOrderUpdate([[maybe_unused]] const base::OrderUpdate &update) {}
+  virtual void OnTrade([[maybe_unused]] const base::Trade &trade) {}
+
+  /**
+   * @brief Called when a backtest ran out of messages, for the strategy to
+   * add its PnL to the result of the run.
+   *
+   * @param result The result of the run so far.
+   */
+  virtual void OnSimEnd([[maybe_unused]] SimResult &result) {}
 
   /**
    * @brief Sets the context for the strategy.
@@ -28,6 +67,17 @@ public:
     acc_interests_.assign(ctx->GetAccountCenter().Count(), 0);
   }
 
+  /**
+   * @brief Sets where the orders of the strategy go.
+   *
+   * @param router The router, nullptr where orders cannot be sent.
+   * @param id The ID of the strategy, stamped on its orders.
+   */
+  void SetOrderRouter(IOrderRouter *router, base::ID id) {
+    router_ = router;
+    id_ = id;
+  }
+
   /**
    * @brief Checks if the strategy is currently watching the given instrument.
    *
@@ -72,8 +122,48 @@ protected:
    */
   void WatchAccount(base::AccountID id) { acc_interests_[id] = 1; }
 
+  /**
+   * @brief Sends an order, stamped with the time of the context clock and the
+   * ID of the strategy. Updates come to OnOrderUpdate and OnTrade with the
+   * client ID of the order.
+   *
+   * @param order The order, with a client ID unique within the strategy.
+   * @return False if there is nowhere to send orders.
+   */
+  bool SendOrder(base::NewOrder order) {
+    if (router_ == nullptr) {
+      return false;
+    }
+    order.create_time_ = ctx_->GetClock().Now();
+    order.strategy_id_ = id_;
+    router_->Send(order);
+    return true;
+  }
+
+  /**
+   * @brief Cancels what is left of an order.
+   *
+   * @param instrument_id The instrument of the order.
+   * @param client_id The client ID of the order.
+   * @return False if there is nowhere to send orders.
+   */
+  bool CancelOrder(base::InstrumentID instrument_id, base::ID client_id) {
+    if (router_ == nullptr) {
+      return false;
+    }
+    base::CancelOrder cancel{};
+    cancel.create_time_ = ctx_->GetClock().Now();
+    cancel.instrument_id_ = instrument_id;
+    cancel.client_id_ = client_id;
+    cancel.strategy_id_ = id_;
+    router_->Cancel(cancel);
+    return true;
+  }
+
 private:
   Context *ctx_{};
+  IOrderRouter *router_{};
+  base::ID id_{0};
   std::vector<int> ins_interests_;
   std::vector<int> acc_interests_;
 };
@@ -1,28 +1,77 @@
+#include <string>
 #include <string_view>
 
 #include <app/market.hpp>
+#include <app/recorder.hpp>
+#include <app/sim.hpp>
 #include <app/strategy.hpp>
 
 using namespace ctptrader;
 
 int main(int argc, char *argv[]) {
   if (argc < 2) {
-    std::cout << "Usage: " << argv[0] << " <config_file>\n";
+    std::cout << "Usage: " << argv[0]
+              << " <config_file> [market|strategy|recorder|sim|sweep]\n";
     return 1;
   }
   toml::table config;
   config = toml::parse_file(argv[1]);
   auto global_config = *config["global"].as_table();
-  auto market_config = *config["market"].as_table();
-  auto strategy_config = *config["strategy"].as_table();
-  auto pid = fork();
+  // Every role names the ring, its depth cache and the record files after it
+  const std::string market_channel =
+      global_config["market_channel"].value_or("market_channel");
+  // Without a role both sides run in a forked pair. The market channel is a
+  // broadcast ring, so more strategy processes can attach to it by starting
+  // this binary with the strategy role, and a recorder with the recorder role.
+  // The sim role backtests on recorded history without a market process, the
+  // sweep role over a range of days and a grid of parameters.
+  const std::string_view role = argc > 2 ? argv[2] : "";
+  if (role != "" && role != "market" && role != "strategy" &&
+      role != "recorder" && role != "sim" && role != "sweep") {
+    std::cout << "Unknown role: " << role << "\n";
+    return 1;
+  }
+  if (role == "recorder") {
+    auto recorder_config = *config["recorder"].as_table();
+    app::RecorderManager rm(market_channel);
+    if (!rm.Init(global_config, recorder_config)) {
+      return 1;
+    }
+    rm.Run();
+    return 0;
+  }
+  if (role == "sim") {
+    auto sim_config = *config["sim"].as_table();
+    app::SimManager sim(market_channel);
+    if (!sim.Init(global_config, sim_config)) {
+      return 1;
+    }
+    sim.Run();
+    return 0;
+  }
+  if (role == "sweep") {
+    auto sweep_config = *config["sweep"].as_table();
+    app::SweepManager sweep(market_channel);
+    if (!sweep.Init(global_config, sweep_config)) {
+      return 1;
+    }
+    sweep.Run();
+    return 0;
+  }
+  const auto pid = role.empty() ? fork() : role == "strategy" ? 0 : 1;
   if (pid == 0) {
-    app::StrategyManager sm("market_channel");
-    sm.Init(global_config, strategy_config);
+    auto strategy_config = *config["strategy"].as_table();
+    app::StrategyManager sm(market_channel);
+    if (!sm.Init(global_config, strategy_config)) {
+      return 1;
+    }
     sm.Run();
   } else {
-    app::MarketManager mm("market_channel");
-    mm.Init(global_config, market_config);
+    auto market_config = *config["market"].as_table();
+    app::MarketManager mm(market_channel);
+    if (!mm.Init(global_config, market_config)) {
+      return 1;
+    }
     mm.Run();
   }
   return 0;
@@ -1 +1,25 @@
-#include <util/channel.hpp>
\ No newline at end of file
+#include <util/channel.hpp>
+
+#include <climits>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ctptrader::util {
+
+void FutexWait(std::atomic<uint32_t> *addr, uint32_t expected,
+               long timeout_ns) {
+  timespec timeout{timeout_ns / 1000000000L, timeout_ns % 1000000000L};
+  // Not FUTEX_PRIVATE_FLAG: the word lives in memory shared across processes.
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT, expected,
+          &timeout, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t> *addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE, INT_MAX,
+          nullptr, nullptr, 0);
+}
+
+} // namespace ctptrader::util
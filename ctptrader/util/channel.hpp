@@ -1,28 +1,198 @@
 #pragma once
 
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include <boost/lockfree/spsc_queue.hpp>
 
 #include <util/readerwriterqueue.h>
+#include <util/shm.hpp>
+#include <util/stats.hpp>
 
 namespace ctptrader::util {
 
-namespace bip = boost::interprocess;
+/// @brief How a reader waits when its channel is empty
+enum class WaitPolicy {
+  /// @brief Poll in a tight loop, lowest wakeup latency
+  BusySpin,
+  /// @brief Poll with a cpu pause hint, then yield the core
+  SpinPause,
+  /// @brief Poll for a while, then sleep on a futex until the writer signals
+  SpinFutex
+};
+
+const static std::unordered_map<std::string, WaitPolicy> WaitPolicyMap = {
+    {"spin", WaitPolicy::BusySpin},
+    {"pause", WaitPolicy::SpinPause},
+    {"futex", WaitPolicy::SpinFutex}};
+
+/// @brief Wakeup word shared by the writer and the readers of a channel.
+/// Readers that may sleep count themselves in sleepers_, so the writer of a
+/// channel of spinning readers pays one plain load per publish. A reader about
+/// to sleep registers itself in waiters_; the writer only bumps seq_ and
+/// enters the kernel when it sees one.
+struct alignas(64) ShmSignal {
+  std::atomic<uint32_t> seq_{0};
+  std::atomic<uint32_t> waiters_{0};
+  /// @brief Readers under WaitPolicy::SpinFutex. Left behind by a killed
+  /// reader, which only costs the writer the fence of Notify.
+  std::atomic<uint32_t> sleepers_{0};
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+/// @brief Sleeps while *addr == expected, at most timeout_ns nanoseconds.
+void FutexWait(std::atomic<uint32_t> *addr, uint32_t expected,
+               long timeout_ns);
+
+/// @brief Wakes every thread sleeping on addr, in any process.
+void FutexWake(std::atomic<uint32_t> *addr);
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+/// @brief Wakes a reader sleeping in Waiter::Wait. Called by the writer after
+/// every publish. The fence pairs with the one in Waiter::Wait: either the
+/// writer sees the reader registered, or the reader sees the publish. A writer
+/// that has not seen a new sleeper yet delays it one futex timeout at worst.
+inline void Notify(ShmSignal &signal) {
+  if (signal.sleepers_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (signal.waiters_.load(std::memory_order_relaxed) != 0) {
+    signal.seq_.fetch_add(1, std::memory_order_release);
+    FutexWake(&signal.seq_);
+  }
+}
+
+/// @brief Backoff state of a channel reader, see WaitPolicy.
+class Waiter {
+public:
+  /// @brief Spins before a SpinPause reader yields or a SpinFutex reader
+  /// sleeps
+  static constexpr uint32_t kDefaultSpins = 1 << 14;
+  /// @brief Upper bound of one futex sleep, so callers can poll a stop flag
+  static constexpr long kFutexTimeoutNs = 100'000'000L;
+
+  Waiter() = default;
+  Waiter(const Waiter &) = delete;
+  Waiter &operator=(const Waiter &) = delete;
+  ~Waiter() { Unregister(); }
+
+  /// @brief Sets the policy of a reader of the channel of signal.
+  void SetPolicy(ShmSignal &signal, WaitPolicy policy,
+                 uint32_t spins = kDefaultSpins) {
+    Unregister();
+    if (policy == WaitPolicy::SpinFutex) {
+      signal.sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      sleeper_of_ = &signal;
+    }
+    policy_ = policy;
+    spins_ = spins;
+  }
+
+  /// @brief Called after a successful read.
+  void Reset() { idle_ = 0; }
+
+  /// @brief Backs off after a failed read. Returns immediately under
+  /// BusySpin, so a spinning reader keeps its wakeup latency.
+  template <typename EmptyFn> void Wait(ShmSignal &signal, EmptyFn &&empty) {
+    if (policy_ == WaitPolicy::BusySpin) {
+      return;
+    }
+    if (++idle_ < spins_) {
+      CpuRelax();
+      return;
+    }
+    if (policy_ == WaitPolicy::SpinPause) {
+      std::this_thread::yield();
+      return;
+    }
+    // Register before the last look at the channel, see Notify
+    signal.waiters_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const auto seq = signal.seq_.load(std::memory_order_acquire);
+    if (empty()) {
+      FutexWait(&signal.seq_, seq, kFutexTimeoutNs);
+    }
+    signal.waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+private:
+  void Unregister() {
+    if (sleeper_of_ != nullptr) {
+      sleeper_of_->sleepers_.fetch_sub(1, std::memory_order_relaxed);
+      sleeper_of_ = nullptr;
+    }
+  }
+
+  WaitPolicy policy_{WaitPolicy::BusySpin};
+  uint32_t spins_{kDefaultSpins};
+  uint32_t idle_{0};
+  ShmSignal *sleeper_of_{nullptr}; // counted in its sleepers_
+};
+
+/// @brief A queue element carrying the ReadTsc stamp taken by the writer.
+template <typename T> struct Stamped {
+  uint64_t tsc_;
+  T value_;
+};
 
 template <typename T, size_t Size> class ShmSpscQueue {
   using QueueType =
-      boost::lockfree::spsc_queue<T, boost::lockfree::capacity<Size>>;
+      boost::lockfree::spsc_queue<Stamped<T>, boost::lockfree::capacity<Size>>;
   using AllocatorType =
       bip::allocator<T, bip::managed_shared_memory::segment_manager>;
 
 public:
-  ShmSpscQueue(const std::string_view name, size_t size, bool readonly)
+  ShmSpscQueue(const std::string_view name, size_t size, bool readonly,
+               bool producer)
       : name_(name)
       , segment_(CreateSegment(name, size, readonly))
       , allocator_(segment_->get_segment_manager())
-      , queue_(segment_->find_or_construct<QueueType>("queue")()) {}
-  ~ShmSpscQueue() { bip::shared_memory_object::remove(name_.c_str()); }
+      , header_(segment_->find_or_construct<SegmentHeader>("header")())
+      , queue_(segment_->find_or_construct<QueueType>("queue")())
+      , signal_(segment_->find_or_construct<ShmSignal>("signal")())
+      , producer_(producer) {
+    if (InitSegmentHeader(*header_, Size)) {
+      ready_ = producer_ ? AttachProducer(*header_)
+                         : (AttachConsumer(*header_), true);
+    }
+  }
+  /// @brief Leaves the segment in place, so that either side can restart and
+  /// attach to it again.
+  ~ShmSpscQueue() {
+    if (ready_) {
+      producer_ ? DetachProducer(*header_) : DetachConsumer(*header_);
+    }
+  }
+
+  /// @brief False if the segment has an incompatible layout, or if this is a
+  /// producer and another live process is producing.
+  [[nodiscard]] bool Ready() const { return ready_; }
+
+  /// @brief Number of times a producer attached to the segment.
+  [[nodiscard]] uint32_t Generation() const {
+    return header_->generation_.load(std::memory_order_relaxed);
+  }
 
 private:
   static std::unique_ptr<bip::managed_shared_memory>
@@ -31,34 +201,113 @@ private:
       return std::make_unique<bip::managed_shared_memory>(bip::open_only,
                                                           name.data());
     }
-    return std::make_unique<bip::managed_shared_memory>(bip::open_or_create,
-                                                        name.data(), size);
+    return std::make_unique<bip::managed_shared_memory>(
+        bip::open_or_create, name.data(), size + kSegmentOverhead);
   }
 
+  /// @brief Room for the segment manager and the named objects next to the
+  /// queue
+  static constexpr size_t kSegmentOverhead = 4096;
+
 protected:
   const std::string name_;
   std::unique_ptr<bip::managed_shared_memory> segment_;
   AllocatorType allocator_;
+  SegmentHeader *header_;
   QueueType *queue_;
+  ShmSignal *signal_;
+  const bool producer_;
+  bool ready_{false};
 };
 
 template <typename T, size_t Size> class ShmSpscReader : ShmSpscQueue<T, Size> {
 public:
   explicit ShmSpscReader(const std::string_view name)
-      : ShmSpscQueue<T, Size>(name, Size * sizeof(T) * 2, false) {}
-  bool Read(T &value) { return this->queue_->pop(value); }
+      : ShmSpscQueue<T, Size>(name, Size * sizeof(Stamped<T>) * 2, false,
+                              false)
+      , stats_(name, false) {}
+
+  using ShmSpscQueue<T, Size>::Ready;
+  using ShmSpscQueue<T, Size>::Generation;
+
+  bool Read(T &value) {
+    const auto read = this->queue_->consume_one([&](const Stamped<T> &s) {
+      value = s.value_;
+      stats_.OnRead(s.tsc_);
+    });
+    if (read) {
+      waiter_.Reset();
+    }
+    return read;
+  }
+
+  /// @brief Pops up to out.size() values with a single update of the shared
+  /// read index.
+  ///
+  /// @return The number of values read.
+  size_t ReadBatch(std::span<T> out) {
+    if (batch_.size() < out.size()) {
+      batch_.resize(out.size());
+    }
+    const auto n = this->queue_->pop(batch_.data(), out.size());
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = batch_[i].value_;
+      stats_.OnRead(batch_[i].tsc_);
+    }
+    if (n > 0) {
+      waiter_.Reset();
+    }
+    return n;
+  }
+
   [[nodiscard]] bool Empty() const { return this->queue_->empty(); }
+
+  void SetWaitPolicy(WaitPolicy policy,
+                     uint32_t spins = Waiter::kDefaultSpins) {
+    waiter_.SetPolicy(*this->signal_, policy, spins);
+  }
+
+  /// @brief Backs off after a failed Read according to the wait policy.
+  void Wait() {
+    waiter_.Wait(*this->signal_, [this]() { return Empty(); });
+  }
+
+private:
+  std::vector<Stamped<T>> batch_;
+  Waiter waiter_;
+  StatsBlock stats_;
 };
 
 template <typename T, size_t Size> class ShmSpscWriter : ShmSpscQueue<T, Size> {
 public:
   explicit ShmSpscWriter(const std::string_view name)
-      : ShmSpscQueue<T, Size>(name, Size * sizeof(T) * 2, false) {}
-  bool Write(const T &value) { return this->queue_->push(value); }
+      : ShmSpscQueue<T, Size>(name, Size * sizeof(Stamped<T>) * 2, false,
+                              true)
+      , stats_(name, true, this->Ready()) {}
+
+  using ShmSpscQueue<T, Size>::Ready;
+  using ShmSpscQueue<T, Size>::Generation;
+
+  bool Write(const T &value) {
+    if (!this->queue_->push(Stamped<T>{ReadTsc(), value})) {
+      stats_.OnDrop();
+      return false;
+    }
+    stats_.OnWrite(Size - this->queue_->write_available());
+    Notify(*this->signal_);
+    return true;
+  }
+
+private:
+  StatsBlock stats_;
 };
 
+/// @brief moodycamel allocates the blocks of this queue from the heap of the
+/// process that constructs it, only the control block lives in the segment.
+/// The queue works between threads of one process, and the segment is
+/// removed on destruction since nobody could attach to it again.
 template <typename T, size_t N> class ShmReaderWriterQueue {
-  using QueueType = moodycamel::ReaderWriterQueue<T>;
+  using QueueType = moodycamel::ReaderWriterQueue<Stamped<T>>;
   using AllocatorType =
       bip::allocator<T, bip::managed_shared_memory::segment_manager>;
 
@@ -92,16 +341,824 @@ protected:
 template <typename T, size_t N> class ShmReader : ShmReaderWriterQueue<T, N> {
 public:
   explicit ShmReader(const std::string_view name)
-      : ShmReaderWriterQueue<T, N>(name, N * sizeof(T) * 2, false) {}
-  bool Read(T &value) { return this->queue_->try_dequeue(value); }
+      : ShmReaderWriterQueue<T, N>(name, N * sizeof(Stamped<T>) * 2, false)
+      , stats_(name, false) {}
+  bool Read(T &value) {
+    const auto *front = this->queue_->peek();
+    if (front == nullptr) {
+      return false;
+    }
+    value = front->value_;
+    stats_.OnRead(front->tsc_);
+    this->queue_->pop();
+    return true;
+  }
+
+  /// @brief Pops up to out.size() values.
+  ///
+  /// @return The number of values read.
+  size_t ReadBatch(std::span<T> out) {
+    size_t n = 0;
+    for (; n < out.size(); ++n) {
+      const auto *front = this->queue_->peek();
+      if (front == nullptr) {
+        break;
+      }
+      out[n] = front->value_;
+      stats_.OnRead(front->tsc_);
+      this->queue_->pop();
+    }
+    return n;
+  }
   [[nodiscard]] bool Empty() const { return this->queue_->size_approx() == 0; }
+
+private:
+  StatsBlock stats_;
 };
 
 template <typename T, size_t N> class ShmWriter : ShmReaderWriterQueue<T, N> {
 public:
   explicit ShmWriter(const std::string_view name)
-      : ShmReaderWriterQueue<T, N>(name, N * sizeof(T) * 2, false) {}
-  bool Write(const T &value) { return this->queue_->try_enqueue(value); }
+      : ShmReaderWriterQueue<T, N>(name, N * sizeof(Stamped<T>) * 2, false)
+      , stats_(name, true) {}
+  bool Write(const T &value) {
+    if (!this->queue_->try_enqueue(Stamped<T>{ReadTsc(), value})) {
+      stats_.OnDrop();
+      return false;
+    }
+    stats_.OnWrite(this->queue_->size_approx());
+    return true;
+  }
+
+private:
+  StatsBlock stats_;
+};
+
+/// @brief Header in front of every frame of a framed ring. The payload
+/// follows directly and is 8-byte aligned.
+struct alignas(8) FrameHeader {
+  uint32_t seq_;  // +4 bytes
+  uint16_t type_; // +2 bytes
+  uint16_t size_; // +2 bytes
+  uint64_t tsc_;  // +8 bytes, ReadTsc when the frame was written
+
+  [[nodiscard]] const void *Data() const { return this + 1; }
+
+  template <typename T> [[nodiscard]] const T &As() const {
+    return *static_cast<const T *>(Data());
+  }
+};
+static_assert(sizeof(FrameHeader) == 16);
+
+/// @brief Frame type reserved for the filler at the end of the ring
+constexpr uint16_t kPaddingFrame = 0xffff;
+
+/// @brief Bytes a frame with a payload of size bytes occupies in the ring.
+constexpr uint64_t FrameBytes(uint64_t size) {
+  return (sizeof(FrameHeader) + size + 7) & ~uint64_t{7};
+}
+
+/// @brief Control block at the start of a ShmFrameReader/ShmFrameWriter
+/// segment. Producer and consumer positions are byte offsets that only grow;
+/// they sit on separate cache lines.
+struct ShmFrameRing {
+  SegmentHeader header_;
+  alignas(64) std::atomic<uint64_t> write_pos_;
+  alignas(64) std::atomic<uint64_t> read_pos_;
+  ShmSignal signal_;
+};
+static_assert(sizeof(ShmFrameRing) % 64 == 0);
+
+/// @brief A byte oriented ring of frames in shared memory. Each message is
+/// stored as a FrameHeader followed by only its own payload, so small messages
+/// cost a few bytes instead of a full slot.
+///
+/// @tparam Ring The control block placed in front of the data area.
+template <typename Ring> class ShmFrameSegment {
+public:
+  static constexpr uint64_t kDefaultCapacity = 1 << 16;
+
+  /// @param capacity Ring size in bytes, rounded up to a power of two. An
+  /// existing segment keeps the capacity it was created with.
+  /// @param producer Whether this is the writing side.
+  ShmFrameSegment(const std::string_view name, uint64_t capacity,
+                  const ShmOptions &options, bool producer)
+      : name_(name)
+      , options_(options)
+      , producer_(producer) {
+    capacity = std::bit_ceil(capacity);
+    Map(capacity);
+    if (ring_ == nullptr) {
+      // A huge page segment that could not be sized: never Ready, and an
+      // empty private ring so that neither side touches unmapped memory.
+      unmapped_ = std::make_unique<Ring>();
+      ring_ = unmapped_.get();
+      capacity_ = mask_ = 0;
+      data_ = nullptr;
+      return;
+    }
+    auto compatible = InitSegmentHeader(ring_->header_, capacity);
+    if (!compatible && producer_) {
+      // Left behind by an incompatible build, no reader can use it either.
+      RemoveSegment(name_, options_);
+      Map(capacity);
+      compatible =
+          ring_ != nullptr && InitSegmentHeader(ring_->header_, capacity);
+    }
+    if (compatible) {
+      ready_ = producer_ ? AttachProducer(ring_->header_)
+                         : (AttachConsumer(ring_->header_), true);
+      capacity = ring_->header_.size_;
+    }
+    capacity_ = capacity;
+    mask_ = capacity_ - 1;
+    data_ = reinterpret_cast<char *>(ring_ + 1);
+  }
+  /// @brief Leaves the segment in place, so that either side can restart and
+  /// attach to it again.
+  ~ShmFrameSegment() {
+    if (ready_) {
+      producer_ ? DetachProducer(ring_->header_)
+                : DetachConsumer(ring_->header_);
+    }
+  }
+
+  [[nodiscard]] uint64_t Capacity() const { return capacity_; }
+
+  /// @brief Whether ShmOptions::lock_ was asked for and mlock succeeded.
+  [[nodiscard]] bool Locked() const { return locked_; }
+
+  /// @brief False if the segment has an incompatible layout, or if this is a
+  /// producer and another live process is producing.
+  [[nodiscard]] bool Ready() const { return ready_; }
+
+  /// @brief Number of times a producer attached to the segment.
+  [[nodiscard]] uint32_t Generation() const {
+    return ring_->header_.generation_.load(std::memory_order_relaxed);
+  }
+
+protected:
+  [[nodiscard]] FrameHeader *At(uint64_t pos) const {
+    return reinterpret_cast<FrameHeader *>(data_ + (pos & mask_));
+  }
+
+  void Map(uint64_t capacity) {
+    region_ = MapSegment(name_, sizeof(Ring) + capacity, options_);
+    if (options_.lock_ && region_.get_size() > 0) {
+      locked_ = mlock(region_.get_address(), region_.get_size()) == 0;
+    }
+    ring_ = static_cast<Ring *>(region_.get_address());
+  }
+
+  const std::string name_;
+  const ShmOptions options_;
+  const bool producer_;
+  bip::mapped_region region_;
+  std::unique_ptr<Ring> unmapped_;
+  Ring *ring_;
+  char *data_;
+  uint64_t capacity_;
+  uint64_t mask_;
+  bool locked_{false};
+  bool ready_{false};
+};
+
+/// @brief Consumer side of a single producer single consumer framed ring.
+class ShmFrameReader : ShmFrameSegment<ShmFrameRing> {
+public:
+  explicit ShmFrameReader(const std::string_view name,
+                          uint64_t capacity = kDefaultCapacity,
+                          const ShmOptions &options = {})
+      : ShmFrameSegment(name, capacity, options, false)
+      , pos_(ring_->read_pos_.load(std::memory_order_relaxed))
+      , write_pos_(pos_)
+      , stats_(name, false) {}
+
+  using ShmFrameSegment::Capacity;
+  using ShmFrameSegment::Locked;
+  using ShmFrameSegment::Ready;
+  using ShmFrameSegment::Generation;
+
+  /// @brief Returns the oldest unread frame in place, or nullptr if the ring
+  /// is empty. The frame stays valid until Commit.
+  [[nodiscard]] const FrameHeader *Peek() {
+    while (true) {
+      if (pos_ == write_pos_) {
+        write_pos_ = ring_->write_pos_.load(std::memory_order_acquire);
+        if (pos_ == write_pos_) {
+          return nullptr;
+        }
+      }
+      const auto *frame = At(pos_);
+      if (frame->type_ != kPaddingFrame) {
+        waiter_.Reset();
+        return frame;
+      }
+      pos_ += capacity_ - (pos_ & mask_);
+    }
+  }
+
+  /// @brief Releases the frame returned by the last Peek.
+  void Commit() {
+    const auto *frame = At(pos_);
+    stats_.OnRead(frame->tsc_);
+    pos_ += FrameBytes(frame->size_);
+    ring_->read_pos_.store(pos_, std::memory_order_release);
+  }
+
+  [[nodiscard]] bool Empty() const {
+    return pos_ == ring_->write_pos_.load(std::memory_order_acquire);
+  }
+
+  void SetWaitPolicy(WaitPolicy policy,
+                     uint32_t spins = Waiter::kDefaultSpins) {
+    waiter_.SetPolicy(ring_->signal_, policy, spins);
+  }
+
+  /// @brief Backs off after an empty Peek according to the wait policy.
+  void Wait() {
+    waiter_.Wait(ring_->signal_, [this]() { return Empty(); });
+  }
+
+private:
+  uint64_t pos_;
+  uint64_t write_pos_;
+  Waiter waiter_;
+  StatsBlock stats_;
+};
+
+/// @brief Producer side of a single producer single consumer framed ring.
+class ShmFrameWriter : ShmFrameSegment<ShmFrameRing> {
+public:
+  explicit ShmFrameWriter(const std::string_view name,
+                          uint64_t capacity = kDefaultCapacity,
+                          const ShmOptions &options = {})
+      : ShmFrameSegment(name, capacity, options, true)
+      , pos_(ring_->write_pos_.load(std::memory_order_relaxed))
+      , read_pos_(ring_->read_pos_.load(std::memory_order_acquire))
+      , stats_(name, true, this->Ready()) {}
+
+  using ShmFrameSegment::Capacity;
+  using ShmFrameSegment::Locked;
+  using ShmFrameSegment::Ready;
+  using ShmFrameSegment::Generation;
+
+  /// @brief Appends one frame. Returns false if the ring is full.
+  bool Write(uint16_t type, const void *data, uint16_t size) {
+    const auto bytes = FrameBytes(size);
+    const auto tail = capacity_ - (pos_ & mask_);
+    const auto needed = tail < bytes ? tail + bytes : bytes;
+    if (pos_ + needed - read_pos_ > capacity_) {
+      read_pos_ = ring_->read_pos_.load(std::memory_order_acquire);
+      if (pos_ + needed - read_pos_ > capacity_) {
+        stats_.OnDrop();
+        return false;
+      }
+    }
+    if (tail < bytes) {
+      At(pos_)->type_ = kPaddingFrame;
+      pos_ += tail;
+    }
+    auto *frame = At(pos_);
+    frame->seq_ = seq_++;
+    frame->type_ = type;
+    frame->size_ = size;
+    frame->tsc_ = ReadTsc();
+    std::memcpy(frame + 1, data, size);
+    pos_ += bytes;
+    ring_->write_pos_.store(pos_, std::memory_order_release);
+    stats_.OnWrite(pos_ - read_pos_);
+    Notify(ring_->signal_);
+    return true;
+  }
+
+  template <typename T> bool Write(uint16_t type, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(sizeof(T) <= UINT16_MAX);
+    return Write(type, &value, sizeof(T));
+  }
+
+private:
+  uint64_t pos_;
+  uint64_t read_pos_;
+  uint32_t seq_{0};
+  StatsBlock stats_;
+};
+
+/// @brief Control block of a broadcast ring. The writer publishes write_pos_
+/// after a frame is complete and raises claim_pos_ before it starts to
+/// overwrite old bytes, so a reader can tell whether what it copied was
+/// clobbered while it was copying.
+struct ShmBroadcastRing {
+  SegmentHeader header_;
+  alignas(64) std::atomic<uint64_t> write_pos_;
+  std::atomic<uint32_t> write_seq_;
+  alignas(64) std::atomic<uint64_t> claim_pos_;
+  ShmSignal signal_;
+};
+static_assert(sizeof(ShmBroadcastRing) % 64 == 0);
+
+/// @brief Producer side of a single producer multi consumer framed ring. The
+/// writer never waits for readers; a reader that falls more than a ring behind
+/// loses the overwritten frames and notices through the frame sequence.
+class ShmBroadcastWriter : ShmFrameSegment<ShmBroadcastRing> {
+public:
+  explicit ShmBroadcastWriter(const std::string_view name,
+                              uint64_t capacity = kDefaultCapacity,
+                              const ShmOptions &options = {})
+      : ShmFrameSegment(name, capacity, options, true)
+      , pos_(ring_->write_pos_.load(std::memory_order_relaxed))
+      , seq_(ring_->write_seq_.load(std::memory_order_relaxed))
+      , stats_(name, true, this->Ready()) {}
+
+  using ShmFrameSegment::Capacity;
+  using ShmFrameSegment::Locked;
+  using ShmFrameSegment::Ready;
+  using ShmFrameSegment::Generation;
+
+  /// @brief Appends one frame. Only fails if the frame is larger than the
+  /// ring.
+  bool Write(uint16_t type, const void *data, uint16_t size) {
+    const auto bytes = FrameBytes(size);
+    if (bytes > capacity_) {
+      stats_.OnDrop();
+      return false;
+    }
+    const auto tail = capacity_ - (pos_ & mask_);
+    const auto needed = tail < bytes ? tail + bytes : bytes;
+    ring_->claim_pos_.store(pos_ + needed, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (tail < bytes) {
+      At(pos_)->type_ = kPaddingFrame;
+      pos_ += tail;
+    }
+    auto *frame = At(pos_);
+    frame->seq_ = seq_++;
+    frame->type_ = type;
+    frame->size_ = size;
+    frame->tsc_ = ReadTsc();
+    std::memcpy(frame + 1, data, size);
+    pos_ += bytes;
+    ring_->write_seq_.store(seq_, std::memory_order_relaxed);
+    ring_->write_pos_.store(pos_, std::memory_order_release);
+    stats_.OnWrite(0);
+    Notify(ring_->signal_);
+    return true;
+  }
+
+  template <typename T> bool Write(uint16_t type, const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(sizeof(T) <= UINT16_MAX);
+    return Write(type, &value, sizeof(T));
+  }
+
+private:
+  uint64_t pos_;
+  uint32_t seq_;
+  StatsBlock stats_;
+};
+
+/// @brief Consumer side of a broadcast ring. Every reader keeps a private
+/// cursor, so any number of processes can follow the same writer. A reader
+/// joins at the live end of the ring.
+class ShmBroadcastReader : ShmFrameSegment<ShmBroadcastRing> {
+public:
+  explicit ShmBroadcastReader(const std::string_view name,
+                              uint64_t capacity = kDefaultCapacity,
+                              const ShmOptions &options = {})
+      : ShmFrameSegment(name, capacity, options, false)
+      , pos_(ring_->write_pos_.load(std::memory_order_acquire))
+      , write_pos_(pos_)
+      , buf_(FrameBytes(UINT16_MAX) / sizeof(uint64_t))
+      , next_seq_(ring_->write_seq_.load(std::memory_order_relaxed))
+      , stats_(name, false) {}
+
+  using ShmFrameSegment::Capacity;
+  using ShmFrameSegment::Locked;
+  using ShmFrameSegment::Ready;
+  using ShmFrameSegment::Generation;
+
+  /// @brief Copies the next frame into a buffer owned by the reader and
+  /// returns it, or nullptr if there is nothing new. The frame stays valid
+  /// until the next call.
+  [[nodiscard]] const FrameHeader *Read() {
+    const FrameHeader *next = nullptr;
+    ReadBatch(1, [&next](const FrameHeader &frame) { next = &frame; });
+    return next;
+  }
+
+  /// @brief Copies up to max frames into a buffer owned by the reader and
+  /// calls f on each of them in order. The whole batch is checked against
+  /// the writer once, so the cost of the check is shared by all its frames.
+  ///
+  /// @return The number of frames passed to f.
+  template <typename F> size_t ReadBatch(size_t max, F &&f) {
+    auto *buf = reinterpret_cast<uint8_t *>(buf_.data());
+    const auto buf_bytes = buf_.size() * sizeof(uint64_t);
+    while (true) {
+      if (pos_ == write_pos_) {
+        write_pos_ = ring_->write_pos_.load(std::memory_order_acquire);
+        if (pos_ == write_pos_) {
+          return 0;
+        }
+      }
+      if (write_pos_ - pos_ > capacity_) {
+        Resync();
+        continue;
+      }
+      auto pos = pos_;
+      size_t n = 0;
+      size_t used = 0;
+      bool torn = false;
+      while (n < max && pos != write_pos_) {
+        const auto *src = At(pos);
+        const auto type = src->type_;
+        const auto bytes = type == kPaddingFrame ? capacity_ - (pos & mask_)
+                                                 : FrameBytes(src->size_);
+        if ((pos & mask_) + bytes > capacity_) {
+          // A header torn by the writer, the frame is gone anyway.
+          torn = true;
+          break;
+        }
+        if (type != kPaddingFrame) {
+          if (used + bytes > buf_bytes) {
+            break;
+          }
+          std::memcpy(buf + used, src, bytes);
+          used += bytes;
+          ++n;
+        }
+        pos += bytes;
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (ring_->claim_pos_.load(std::memory_order_relaxed) - pos_ >
+              capacity_ ||
+          (torn && n == 0)) {
+        Resync();
+        continue;
+      }
+      pos_ = pos;
+      if (n == 0) {
+        continue;
+      }
+      stats_.OnDepth(write_pos_ - pos_);
+      waiter_.Reset();
+      for (size_t off = 0; off < used;) {
+        const auto *frame = reinterpret_cast<const FrameHeader *>(buf + off);
+        if (frame->seq_ != next_seq_) {
+          dropped_ += frame->seq_ - next_seq_;
+          stats_.OnDrop(frame->seq_ - next_seq_);
+        }
+        next_seq_ = frame->seq_ + 1;
+        stats_.OnRead(frame->tsc_);
+        off += FrameBytes(frame->size_);
+        f(*frame);
+      }
+      return n;
+    }
+  }
+
+  [[nodiscard]] bool Empty() const {
+    return pos_ == ring_->write_pos_.load(std::memory_order_acquire);
+  }
+
+  /// @brief Number of times the writer lapped this reader.
+  [[nodiscard]] uint64_t Overruns() const { return overruns_; }
+
+  /// @brief Number of frames lost to overruns.
+  [[nodiscard]] uint64_t Dropped() const { return dropped_; }
+
+  void SetWaitPolicy(WaitPolicy policy,
+                     uint32_t spins = Waiter::kDefaultSpins) {
+    waiter_.SetPolicy(ring_->signal_, policy, spins);
+  }
+
+  /// @brief Backs off after an empty Read according to the wait policy.
+  void Wait() {
+    waiter_.Wait(ring_->signal_, [this]() { return Empty(); });
+  }
+
+private:
+  /// @brief Skips to the live end after the writer overwrote unread frames.
+  void Resync() {
+    ++overruns_;
+    pos_ = write_pos_ = ring_->write_pos_.load(std::memory_order_acquire);
+  }
+
+  uint64_t pos_;
+  uint64_t write_pos_;
+  std::vector<uint64_t> buf_;
+  uint32_t next_seq_;
+  uint64_t overruns_{0};
+  uint64_t dropped_{0};
+  Waiter waiter_;
+  StatsBlock stats_;
+};
+
+/// @brief Control block of a conflated channel. Each attached reader owns one
+/// dirty bitmap, bit i set meaning slot i changed since the reader last
+/// looked.
+struct ShmConflatedHeader {
+  static constexpr uint32_t kMaxReaders = 4;
+
+  SegmentHeader header_;
+  std::atomic<uint32_t> readers_;
+  /// @brief Owner of each reader bitmap, so that the bitmaps of crashed
+  /// readers can be reclaimed
+  std::atomic<int32_t> reader_pids_[kMaxReaders];
+  ShmSignal signal_;
+};
+static_assert(sizeof(ShmConflatedHeader) % 64 == 0);
+
+/// @brief One value of a conflated channel, guarded by a seqlock: seq_ is odd
+/// while the writer is in the middle of an update.
+template <typename T> struct alignas(64) ConflatedSlot {
+  std::atomic<uint64_t> seq_;
+  uint64_t tsc_;
+  T value_;
+};
+
+/// @brief A latest-value cache in shared memory with one slot per id. The
+/// writer overwrites slots in place and never waits, readers only ever see
+/// the newest value of a slot and cannot fall behind.
+template <typename T> class ShmConflatedSegment {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+  /// @param count Number of slots. An existing segment keeps the count it was
+  /// created with.
+  /// @param producer Whether this is the writing side.
+  ShmConflatedSegment(const std::string_view name, uint64_t count,
+                      bool producer)
+      : name_(name)
+      , producer_(producer) {
+    Map(count);
+    auto compatible = InitSegmentHeader(header_->header_, count);
+    if (!compatible && producer_) {
+      RemoveSegment(name_, {});
+      Map(count);
+      compatible = InitSegmentHeader(header_->header_, count);
+    }
+    if (compatible) {
+      ready_ = producer_ ? AttachProducer(header_->header_)
+                         : (AttachConsumer(header_->header_), true);
+      if (header_->header_.size_ != count) {
+        count = header_->header_.size_;
+        Map(count);
+      }
+    }
+    count_ = count;
+    bitmap_words_ = BitmapWords(count_);
+    bitmaps_ = reinterpret_cast<std::atomic<uint64_t> *>(header_ + 1);
+    slots_ = reinterpret_cast<ConflatedSlot<T> *>(
+        bitmaps_ + bitmap_words_ * ShmConflatedHeader::kMaxReaders);
+  }
+  /// @brief Leaves the segment in place, so that either side can restart and
+  /// attach to it again.
+  ~ShmConflatedSegment() {
+    if (ready_) {
+      producer_ ? DetachProducer(header_->header_)
+                : DetachConsumer(header_->header_);
+    }
+  }
+
+  /// @brief False if the segment has an incompatible layout, or if this is a
+  /// producer and another live process is producing.
+  [[nodiscard]] bool Ready() const { return ready_; }
+
+  [[nodiscard]] uint64_t Count() const { return count_; }
+
+protected:
+  /// @brief Bitmap words per reader, rounded up to whole cache lines.
+  static uint64_t BitmapWords(uint64_t count) {
+    return ((count + 63) / 64 + 7) / 8 * 8;
+  }
+
+  void Map(uint64_t count) {
+    region_ = MapSegment(name_,
+                         sizeof(ShmConflatedHeader) +
+                             BitmapWords(count) *
+                                 ShmConflatedHeader::kMaxReaders *
+                                 sizeof(uint64_t) +
+                             count * sizeof(ConflatedSlot<T>),
+                         {});
+    header_ = static_cast<ShmConflatedHeader *>(region_.get_address());
+  }
+
+  [[nodiscard]] std::atomic<uint64_t> *Bitmap(uint32_t reader) const {
+    return bitmaps_ + bitmap_words_ * reader;
+  }
+
+  const std::string name_;
+  const bool producer_;
+  bool ready_{false};
+  bip::mapped_region region_;
+  ShmConflatedHeader *header_;
+  std::atomic<uint64_t> *bitmaps_;
+  ConflatedSlot<T> *slots_;
+  uint64_t bitmap_words_;
+  uint64_t count_;
+};
+
+/// @brief Producer side of a conflated channel.
+template <typename T>
+class ShmConflatedWriter : ShmConflatedSegment<T> {
+public:
+  ShmConflatedWriter(const std::string_view name, uint64_t count)
+      : ShmConflatedSegment<T>(name, count, true)
+      , stats_(name, true, this->Ready()) {
+    if (this->Ready()) {
+      Recover();
+    }
+  }
+
+  using ShmConflatedSegment<T>::Count;
+  using ShmConflatedSegment<T>::Ready;
+
+  /// @brief Overwrites slot id and marks it dirty for every attached reader.
+  bool Write(uint64_t id, const T &value) {
+    if (id >= this->count_) {
+      stats_.OnDrop();
+      return false;
+    }
+    auto &slot = this->slots_[id];
+    const auto seq = slot.seq_.load(std::memory_order_relaxed);
+    slot.seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.tsc_ = ReadTsc();
+    std::memcpy(&slot.value_, &value, sizeof(T));
+    slot.seq_.store(seq + 2, std::memory_order_release);
+    const auto bit = uint64_t{1} << (id % 64);
+    auto readers = this->header_->readers_.load(std::memory_order_acquire);
+    while (readers != 0) {
+      const auto reader = std::countr_zero(readers);
+      readers &= readers - 1;
+      auto &word = this->Bitmap(reader)[id / 64];
+      if ((word.load(std::memory_order_relaxed) & bit) == 0) {
+        word.fetch_or(bit, std::memory_order_release);
+      }
+    }
+    stats_.OnWrite(0);
+    Notify(this->header_->signal_);
+    return true;
+  }
+
+private:
+  /// @brief A producer that died in the middle of Write left its slot with
+  /// an odd sequence and a torn value. Such slots go back to never written,
+  /// and no reader is told they changed.
+  void Recover() {
+    for (uint64_t id = 0; id < this->count_; ++id) {
+      auto &seq = this->slots_[id].seq_;
+      if ((seq.load(std::memory_order_relaxed) & 1) == 0) {
+        continue;
+      }
+      seq.store(0, std::memory_order_release);
+      const auto bit = uint64_t{1} << (id % 64);
+      for (uint32_t r = 0; r < ShmConflatedHeader::kMaxReaders; ++r) {
+        this->Bitmap(r)[id / 64].fetch_and(~bit, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  StatsBlock stats_;
+};
+
+/// @brief Consumer side of a conflated channel. Up to
+/// ShmConflatedHeader::kMaxReaders readers can attach at the same time, each
+/// with a dirty bitmap of its own.
+template <typename T>
+class ShmConflatedReader : ShmConflatedSegment<T> {
+public:
+  ShmConflatedReader(const std::string_view name, uint64_t count)
+      : ShmConflatedSegment<T>(name, count, false)
+      , stats_(name, false) {
+    if (!this->ready_) {
+      return;
+    }
+    auto &header = *this->header_;
+    // A bitmap without a pid is being claimed right now.
+    for (uint32_t i = 0; i < ShmConflatedHeader::kMaxReaders; ++i) {
+      const auto pid = header.reader_pids_[i].load();
+      if ((header.readers_.load() & (1U << i)) != 0 && pid != 0 &&
+          !ProcessAlive(pid)) {
+        header.reader_pids_[i].store(0);
+        header.readers_.fetch_and(~(1U << i));
+      }
+    }
+    auto readers = header.readers_.load(std::memory_order_relaxed);
+    do {
+      reader_ = std::countr_one(readers);
+      if (reader_ >= ShmConflatedHeader::kMaxReaders) {
+        return;
+      }
+    } while (!header.readers_.compare_exchange_weak(
+        readers, readers | (1U << reader_)));
+    header.reader_pids_[reader_].store(getpid());
+    bitmap_ = this->Bitmap(reader_);
+    // Start from whatever the writer has published so far.
+    for (uint64_t i = 0; i < this->bitmap_words_; ++i) {
+      bitmap_[i].store(0, std::memory_order_relaxed);
+    }
+    for (uint64_t id = 0; id < this->count_; ++id) {
+      if (this->slots_[id].seq_.load(std::memory_order_acquire) != 0) {
+        bitmap_[id / 64].fetch_or(uint64_t{1} << (id % 64));
+      }
+    }
+  }
+  ~ShmConflatedReader() {
+    if (bitmap_ != nullptr) {
+      this->header_->reader_pids_[reader_].store(0);
+      this->header_->readers_.fetch_and(~(1U << reader_));
+    }
+  }
+
+  using ShmConflatedSegment<T>::Count;
+  using ShmConflatedSegment<T>::Ready;
+
+  /// @brief False if the segment is not Ready or all reader bitmaps were
+  /// taken by live readers when this reader attached.
+  [[nodiscard]] bool Attached() const { return bitmap_ != nullptr; }
+
+  /// @brief Times Read waits for a slot in the middle of an update, far
+  /// longer than any write takes.
+  static constexpr uint32_t kMaxRetries = 1 << 16;
+
+  /// @brief Copies the newest value of slot id. Returns false if the slot was
+  /// never written, or stays in the middle of an update because its writer
+  /// died there.
+  bool Read(uint64_t id, T &value) const {
+    const auto &slot = this->slots_[id];
+    for (uint32_t retry = 0; retry < kMaxRetries; ++retry) {
+      const auto seq = slot.seq_.load(std::memory_order_acquire);
+      if (seq == 0) {
+        return false;
+      }
+      if (seq & 1) {
+        CpuRelax();
+        continue;
+      }
+      std::memcpy(&value, &slot.value_, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq_.load(std::memory_order_relaxed) == seq) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// @brief Calls f(id, value) once for every slot written since the last
+  /// Drain, with the newest value of the slot.
+  ///
+  /// @return The number of slots visited.
+  template <typename F> size_t Drain(F &&f) {
+    size_t n = 0;
+    for (uint64_t w = 0; w < this->bitmap_words_; ++w) {
+      if (bitmap_[w].load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+      auto bits = bitmap_[w].exchange(0, std::memory_order_acquire);
+      while (bits != 0) {
+        const auto id = w * 64 + std::countr_zero(bits);
+        bits &= bits - 1;
+        if (Read(id, value_)) {
+          stats_.OnRead(this->slots_[id].tsc_);
+          f(id, value_);
+          ++n;
+        }
+      }
+    }
+    if (n > 0) {
+      waiter_.Reset();
+    }
+    return n;
+  }
+
+  [[nodiscard]] bool Empty() const {
+    for (uint64_t w = 0; w < this->bitmap_words_; ++w) {
+      if (bitmap_[w].load(std::memory_order_acquire) != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void SetWaitPolicy(WaitPolicy policy,
+                     uint32_t spins = Waiter::kDefaultSpins) {
+    waiter_.SetPolicy(this->header_->signal_, policy, spins);
+  }
+
+  /// @brief Backs off after an empty Drain according to the wait policy.
+  void Wait() {
+    waiter_.Wait(this->header_->signal_, [this]() { return Empty(); });
+  }
+
+private:
+  uint32_t reader_{0};
+  std::atomic<uint64_t> *bitmap_{nullptr};
+  T value_{};
+  Waiter waiter_;
+  StatsBlock stats_;
 };
 
 } // namespace ctptrader::util
\ No newline at end of file
@@ -0,0 +1,337 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <base/msg.hpp>
+#include <util/channel.hpp>
+#include <util/readerwritercircularbuffer.h>
+#include <util/readerwriterqueue.h>
+#include <util/spsc.hpp>
+
+// Producer and consumer run on the cores given by BENCH_PRODUCER_CPU and
+// BENCH_CONSUMER_CPU (0 and 1 by default). Shared memory channels are
+// measured between two processes, the producer is forked from the benchmark
+// process. In-process queues are measured between two threads.
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::util;
+
+constexpr size_t kQueueSize = 4096;
+constexpr long kThroughputMessages = 1 << 20;
+constexpr long kRoundTrips = 1 << 16;
+
+int EnvCpu(const char *name, int fallback) {
+  const char *value = std::getenv(name);
+  return value == nullptr ? fallback : std::atoi(value);
+}
+
+int ProducerCpu() { return EnvCpu("BENCH_PRODUCER_CPU", 0); }
+
+int ConsumerCpu() { return EnvCpu("BENCH_CONSUMER_CPU", 1); }
+
+/// @brief Pins the calling thread, cores that do not exist are ignored.
+void PinTo(int cpu) {
+  const auto cpus = static_cast<int>(std::thread::hardware_concurrency());
+  if (cpu < 0 || cpu >= cpus) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  sched_setaffinity(0, sizeof(set), &set);
+}
+
+/// @brief Polls with a pause hint and yields now and then, so that the run
+/// still finishes when both sides share a core.
+void Backoff(uint32_t &idle) {
+  if (++idle % 1024 == 0) {
+    std::this_thread::yield();
+  } else {
+    CpuRelax();
+  }
+}
+
+template <typename Channel, typename T>
+void Send(Channel &channel, const T &v) {
+  for (uint32_t idle = 0; !channel.Write(v);) {
+    Backoff(idle);
+  }
+}
+
+template <typename Channel, typename T>
+void Receive(Channel &channel, T &v) {
+  for (uint32_t idle = 0; !channel.Read(v);) {
+    Backoff(idle);
+  }
+}
+
+void ReportPercentiles(benchmark::State &state, std::vector<double> &ns) {
+  if (ns.empty()) {
+    return;
+  }
+  std::sort(ns.begin(), ns.end());
+  const auto at = [&ns](double q) {
+    return ns[std::min(ns.size() - 1, static_cast<size_t>(q * ns.size()))];
+  };
+  state.counters["p50_ns"] = at(0.5);
+  state.counters["p99_ns"] = at(0.99);
+  state.counters["p99.9_ns"] = at(0.999);
+  state.counters["max_ns"] = ns.back();
+}
+
+template <typename T> struct Spsc {
+  using Value = T;
+  using Reader = ShmSpscReader<T, kQueueSize>;
+  using Writer = ShmSpscWriter<T, kQueueSize>;
+};
+
+template <typename T> struct Padded {
+  using Value = T;
+  using Reader = ShmPaddedReader<T, kQueueSize>;
+  using Writer = ShmPaddedWriter<T, kQueueSize>;
+};
+
+/// @brief The market channel. It never blocks the writer, so it is only
+/// measured for round trips, where one message is in flight at a time.
+template <typename T> struct Broadcast {
+  using Value = T;
+  struct Reader {
+    explicit Reader(const std::string_view name) : rx_(name) {}
+    bool Read(T &value) {
+      const auto *frame = rx_.Read();
+      if (frame == nullptr) {
+        return false;
+      }
+      value = frame->As<T>();
+      return true;
+    }
+    ShmBroadcastReader rx_;
+  };
+  struct Writer {
+    explicit Writer(const std::string_view name) : tx_(name) {}
+    bool Write(const T &value) { return tx_.Write(0, value); }
+    ShmBroadcastWriter tx_;
+  };
+};
+
+/// @brief Channel segments outlive their endpoints, every benchmark starts
+/// and ends without them.
+struct ScopedSegments {
+  explicit ScopedSegments(std::vector<std::string> names)
+      : names_(std::move(names)) {
+    Remove();
+  }
+  ~ScopedSegments() { Remove(); }
+  void Remove() {
+    for (const auto &name : names_) {
+      RemoveSegment(name, {});
+    }
+  }
+
+  const std::vector<std::string> names_;
+};
+
+/// @brief Runs f in a forked child pinned to the producer core. Both sides
+/// attach before the fork, so no message is sent before its reader exists.
+/// The child leaves with _exit and never destroys the endpoints it inherited,
+/// the parent cleans up after waitpid.
+template <typename F> pid_t ForkProducer(F &&f) {
+  const pid_t pid = fork();
+  if (pid == 0) {
+    PinTo(ProducerCpu());
+    f();
+    _exit(0);
+  }
+  return pid;
+}
+
+/// @brief Same thread write then read, the cost of one publish and consume.
+template <typename Q> void WriteRead(benchmark::State &state) {
+  ScopedSegments segments({"bench_queue"});
+  typename Q::Writer writer("bench_queue");
+  typename Q::Reader reader("bench_queue");
+  typename Q::Value value{};
+  for (auto _ : state) {
+    writer.Write(value);
+    reader.Read(value);
+    benchmark::DoNotOptimize(value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/// @brief A forked producer keeps the queue busy, the benchmark process
+/// drains it.
+template <typename Q> void ForkedThroughput(benchmark::State &state) {
+  using T = typename Q::Value;
+  constexpr char kName[] = "bench_throughput";
+  ScopedSegments segments({kName});
+  typename Q::Reader reader(kName);
+  typename Q::Writer writer(kName);
+  const auto count = static_cast<long>(state.max_iterations);
+  const auto pid = ForkProducer([&writer, count]() {
+    const T value{};
+    for (long i = 0; i < count; ++i) {
+      Send(writer, value);
+    }
+  });
+  PinTo(ConsumerCpu());
+  T value{};
+  for (auto _ : state) {
+    Receive(reader, value);
+    benchmark::DoNotOptimize(value);
+  }
+  waitpid(pid, nullptr, 0);
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * sizeof(T));
+}
+
+/// @brief Ping-pong with a forked echo process, one message in flight.
+template <typename Q> void ForkedRoundTrip(benchmark::State &state) {
+  using T = typename Q::Value;
+  constexpr char kPing[] = "bench_ping";
+  constexpr char kPong[] = "bench_pong";
+  ScopedSegments segments({kPing, kPong});
+  typename Q::Writer ping(kPing);
+  typename Q::Reader pong(kPong);
+  typename Q::Reader echo_rx(kPing);
+  typename Q::Writer echo_tx(kPong);
+  const auto count = static_cast<long>(state.max_iterations);
+  const auto pid = ForkProducer([&echo_rx, &echo_tx, count]() {
+    T value{};
+    for (long i = 0; i < count; ++i) {
+      Receive(echo_rx, value);
+      Send(echo_tx, value);
+    }
+  });
+  PinTo(ConsumerCpu());
+  const auto tsc_per_ns = TscPerNs();
+  std::vector<double> ns;
+  ns.reserve(count);
+  T value{};
+  for (auto _ : state) {
+    const auto start = ReadTsc();
+    Send(ping, value);
+    Receive(pong, value);
+    ns.push_back(static_cast<double>(ReadTsc() - start) / tsc_per_ns);
+  }
+  waitpid(pid, nullptr, 0);
+  ReportPercentiles(state, ns);
+  state.SetItemsProcessed(state.iterations());
+}
+
+/// @brief In-process moodycamel queue.
+template <typename T> struct Rwq {
+  using Value = T;
+  bool Write(const T &value) { return queue_.try_enqueue(value); }
+  bool Read(T &value) { return queue_.try_dequeue(value); }
+  moodycamel::ReaderWriterQueue<T> queue_{kQueueSize};
+};
+
+/// @brief In-process moodycamel circular buffer.
+template <typename T> struct Circular {
+  using Value = T;
+  bool Write(const T &value) { return queue_.try_enqueue(value); }
+  bool Read(T &value) { return queue_.try_dequeue(value); }
+  moodycamel::BlockingReaderWriterCircularBuffer<T> queue_{kQueueSize};
+};
+
+/// @brief ShmReaderWriterQueue keeps only the moodycamel control block in
+/// the segment, its blocks come from the heap of the process that created
+/// it, so it cannot be shared with a forked process and is measured between
+/// threads instead.
+template <typename T> struct ShmRwq {
+  using Value = T;
+  ShmRwq() : name_(NextName()), writer_(name_), reader_(name_) {}
+  bool Write(const T &value) { return writer_.Write(value); }
+  bool Read(T &value) { return reader_.Read(value); }
+  static std::string NextName() {
+    static int n = 0;
+    return "bench_rwq" + std::to_string(n++);
+  }
+  const std::string name_;
+  ShmWriter<T, kQueueSize> writer_;
+  ShmReader<T, kQueueSize> reader_;
+};
+
+template <typename Q> void ThreadThroughput(benchmark::State &state) {
+  using T = typename Q::Value;
+  Q queue;
+  const auto count = static_cast<long>(state.max_iterations);
+  std::thread producer([&queue, count]() {
+    PinTo(ProducerCpu());
+    const T value{};
+    for (long i = 0; i < count; ++i) {
+      Send(queue, value);
+    }
+  });
+  PinTo(ConsumerCpu());
+  T value{};
+  for (auto _ : state) {
+    Receive(queue, value);
+    benchmark::DoNotOptimize(value);
+  }
+  producer.join();
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * sizeof(T));
+}
+
+template <typename Q> void ThreadRoundTrip(benchmark::State &state) {
+  using T = typename Q::Value;
+  auto ping = std::make_unique<Q>();
+  auto pong = std::make_unique<Q>();
+  const auto count = static_cast<long>(state.max_iterations);
+  std::thread echo([&ping, &pong, count]() {
+    PinTo(ProducerCpu());
+    T value{};
+    for (long i = 0; i < count; ++i) {
+      Receive(*ping, value);
+      Send(*pong, value);
+    }
+  });
+  PinTo(ConsumerCpu());
+  const auto tsc_per_ns = TscPerNs();
+  std::vector<double> ns;
+  ns.reserve(count);
+  T value{};
+  for (auto _ : state) {
+    const auto start = ReadTsc();
+    Send(*ping, value);
+    Receive(*pong, value);
+    ns.push_back(static_cast<double>(ReadTsc() - start) / tsc_per_ns);
+  }
+  echo.join();
+  ReportPercentiles(state, ns);
+  state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+#define CHANNEL_BENCHMARKS(T)                                                  \
+  BENCHMARK(WriteRead<Spsc<T>>);                                               \
+  BENCHMARK(WriteRead<Padded<T>>);                                             \
+  BENCHMARK(ForkedThroughput<Spsc<T>>)->Iterations(kThroughputMessages);       \
+  BENCHMARK(ForkedThroughput<Padded<T>>)->Iterations(kThroughputMessages);     \
+  BENCHMARK(ForkedRoundTrip<Spsc<T>>)->Iterations(kRoundTrips);                \
+  BENCHMARK(ForkedRoundTrip<Padded<T>>)->Iterations(kRoundTrips);              \
+  BENCHMARK(ForkedRoundTrip<Broadcast<T>>)->Iterations(kRoundTrips);           \
+  BENCHMARK(ThreadThroughput<ShmRwq<T>>)->Iterations(kThroughputMessages);     \
+  BENCHMARK(ThreadThroughput<Rwq<T>>)->Iterations(kThroughputMessages);        \
+  BENCHMARK(ThreadThroughput<Circular<T>>)->Iterations(kThroughputMessages);   \
+  BENCHMARK(ThreadRoundTrip<ShmRwq<T>>)->Iterations(kRoundTrips);              \
+  BENCHMARK(ThreadRoundTrip<Rwq<T>>)->Iterations(kRoundTrips);                 \
+  BENCHMARK(ThreadRoundTrip<Circular<T>>)->Iterations(kRoundTrips)
+
+CHANNEL_BENCHMARKS(base::Trade);
+CHANNEL_BENCHMARKS(base::Depth);
+CHANNEL_BENCHMARKS(base::Msg);
+
+BENCHMARK_MAIN();
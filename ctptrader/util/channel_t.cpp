@@ -1,16 +1,38 @@
 #include <gtest/gtest.h>
+#include <array>
+#include <filesystem>
 #include <thread>
 
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <util/channel.hpp>
 
 namespace {
 
 using namespace ctptrader::util;
 
+/// @brief Channel segments outlive their endpoints, so every test removes
+/// its segment before and after running.
+struct ScopedSegment {
+  explicit ScopedSegment(const std::string &name,
+                         const ShmOptions &options = {})
+      : name_(name)
+      , options_(options) {
+    RemoveSegment(name_, options_);
+  }
+  ~ScopedSegment() { RemoveSegment(name_, options_); }
+
+  const std::string name_;
+  const ShmOptions options_;
+};
+
 TEST(ShmSpscQueueTest, ReadWrite) {
   constexpr size_t kQueueSize = 1024;
   constexpr size_t kNumMessages = 1000;
   constexpr char kQueueName[] = "test_queue";
+  ScopedSegment segment(kQueueName);
 
   // Create writer process
   ShmSpscWriter<int, kQueueSize> writer(kQueueName);
@@ -29,9 +51,29 @@ TEST(ShmSpscQueueTest, ReadWrite) {
   }
 }
 
+TEST(ShmSpscQueueTest, ReadBatch) {
+  constexpr size_t kQueueSize = 64;
+  constexpr char kQueueName[] = "test_queue_batch";
+  ScopedSegment segment(kQueueName);
+
+  ShmSpscWriter<int, kQueueSize> writer(kQueueName);
+  ShmSpscReader<int, kQueueSize> reader(kQueueName);
+  for (int i = 0; i < 50; ++i) {
+    ASSERT_TRUE(writer.Write(i));
+  }
+  std::array<int, 32> batch{};
+  ASSERT_EQ(reader.ReadBatch(batch), 32);
+  ASSERT_EQ(batch[31], 31);
+  ASSERT_EQ(reader.ReadBatch(batch), 18);
+  ASSERT_EQ(batch[0], 32);
+  ASSERT_EQ(batch[17], 49);
+  ASSERT_EQ(reader.ReadBatch(batch), 0);
+}
+
 TEST(ShmSpscQueueTest, Empty) {
   constexpr size_t kQueueSize = 1024;
   constexpr char kQueueName[] = "test_queue_empty";
+  ScopedSegment segment(kQueueName);
 
   // Create reader process
   ShmSpscReader<int, kQueueSize> reader(kQueueName);
@@ -48,10 +90,53 @@ TEST(ShmSpscQueueTest, Empty) {
   ASSERT_FALSE(reader.Empty());
 }
 
+TEST(ShmSpscQueueTest, FutexWait) {
+  constexpr size_t kQueueSize = 1024;
+  constexpr int kNumMessages = 100;
+  constexpr char kQueueName[] = "test_queue_futex";
+  ScopedSegment segment(kQueueName);
+
+  ShmSpscReader<int, kQueueSize> reader(kQueueName);
+  reader.SetWaitPolicy(WaitPolicy::SpinFutex, 1);
+
+  std::thread producer([&]() {
+    ShmSpscWriter<int, kQueueSize> writer(kQueueName);
+    for (int i = 0; i < kNumMessages; ++i) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      ASSERT_TRUE(writer.Write(i));
+    }
+  });
+
+  for (int i = 0; i < kNumMessages; ++i) {
+    int value;
+    while (!reader.Read(value)) {
+      reader.Wait();
+    }
+    ASSERT_EQ(value, i);
+  }
+  producer.join();
+}
+
+TEST(WaiterTest, Sleepers) {
+  ShmSignal signal;
+  {
+    Waiter waiter;
+    waiter.SetPolicy(signal, WaitPolicy::SpinFutex);
+    EXPECT_EQ(signal.sleepers_.load(), 1U);
+    waiter.SetPolicy(signal, WaitPolicy::BusySpin);
+    EXPECT_EQ(signal.sleepers_.load(), 0U);
+    waiter.SetPolicy(signal, WaitPolicy::SpinFutex);
+    waiter.SetPolicy(signal, WaitPolicy::SpinFutex);
+    EXPECT_EQ(signal.sleepers_.load(), 1U);
+  }
+  EXPECT_EQ(signal.sleepers_.load(), 0U);
+}
+
 TEST(ShmReaderWriterTest, ReadWrite) {
   constexpr size_t kQueueSize = 1024;
   constexpr size_t kNumMessages = 1000;
   constexpr char kQueueName[] = "test_queue";
+  ScopedSegment segment(kQueueName);
 
   // Create writer process
   ShmWriter<int, kQueueSize> writer(kQueueName);
@@ -70,4 +155,413 @@ TEST(ShmReaderWriterTest, ReadWrite) {
   }
 }
 
+TEST(ShmReaderWriterTest, ReadBatch) {
+  constexpr size_t kQueueSize = 64;
+  constexpr char kQueueName[] = "test_queue_batch";
+  ScopedSegment segment(kQueueName);
+
+  ShmWriter<int, kQueueSize> writer(kQueueName);
+  ShmReader<int, kQueueSize> reader(kQueueName);
+  for (int i = 0; i < 50; ++i) {
+    ASSERT_TRUE(writer.Write(i));
+  }
+  std::array<int, 32> batch{};
+  ASSERT_EQ(reader.ReadBatch(batch), 32);
+  ASSERT_EQ(batch[31], 31);
+  ASSERT_EQ(reader.ReadBatch(batch), 18);
+  ASSERT_EQ(batch[17], 49);
+  ASSERT_TRUE(reader.Empty());
+}
+
+TEST(ShmFrameQueueTest, ReadWrite) {
+  constexpr char kQueueName[] = "test_frame_queue";
+  ScopedSegment segment(kQueueName);
+  constexpr int kNumMessages = 1000;
+  struct Small {
+    int value_;
+  };
+  struct Large {
+    long value_;
+    char pad_[120];
+  };
+
+  ShmFrameWriter writer(kQueueName, 1024);
+  ShmFrameReader reader(kQueueName);
+  ASSERT_EQ(reader.Capacity(), 1024);
+  ASSERT_EQ(reader.Peek(), nullptr);
+
+  // Interleave sizes so frames keep wrapping around the end of the ring.
+  for (int i = 0; i < kNumMessages; ++i) {
+    if (i % 3 == 0) {
+      ASSERT_TRUE(writer.Write(1, Large{i, {}}));
+    } else {
+      ASSERT_TRUE(writer.Write(0, Small{i}));
+    }
+    const auto *frame = reader.Peek();
+    ASSERT_NE(frame, nullptr);
+    ASSERT_EQ(frame->seq_, i);
+    if (i % 3 == 0) {
+      ASSERT_EQ(frame->type_, 1);
+      ASSERT_EQ(frame->size_, sizeof(Large));
+      ASSERT_EQ(frame->As<Large>().value_, i);
+    } else {
+      ASSERT_EQ(frame->type_, 0);
+      ASSERT_EQ(frame->size_, sizeof(Small));
+      ASSERT_EQ(frame->As<Small>().value_, i);
+    }
+    reader.Commit();
+  }
+  ASSERT_EQ(reader.Peek(), nullptr);
+}
+
+TEST(ShmFrameQueueTest, Full) {
+  constexpr char kQueueName[] = "test_frame_queue_full";
+  ScopedSegment segment(kQueueName);
+
+  ShmFrameWriter writer(kQueueName, 256);
+  ShmFrameReader reader(kQueueName);
+  // 16 byte header + 24 byte payload per frame
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_TRUE(writer.Write(0, std::array<long, 3>{i, i, i}));
+  }
+  ASSERT_FALSE(writer.Write(0, std::array<long, 3>{}));
+  ASSERT_NE(reader.Peek(), nullptr);
+  reader.Commit();
+  ASSERT_TRUE(writer.Write(0, std::array<long, 3>{6, 6, 6}));
+  for (int i = 1; i <= 6; ++i) {
+    const auto *frame = reader.Peek();
+    ASSERT_NE(frame, nullptr);
+    ASSERT_EQ((frame->As<std::array<long, 3>>()[0]), i);
+    reader.Commit();
+  }
+}
+
+TEST(ShmFrameQueueTest, Options) {
+  constexpr char kQueueName[] = "test_frame_queue_options";
+  ShmOptions options;
+  options.populate_ = true;
+  options.hugepage_dir_ = std::filesystem::temp_directory_path().string();
+  ScopedSegment segment(kQueueName, options);
+
+  // Any directory works in place of a hugetlbfs mount for the test.
+  ShmFrameWriter writer(kQueueName, 3000, options);
+  ShmFrameReader reader(kQueueName, 3000, options);
+  ASSERT_EQ(writer.Capacity(), 4096);
+  ASSERT_TRUE(
+      std::filesystem::exists(options.hugepage_dir_ + "/" + kQueueName));
+  ASSERT_TRUE(writer.Write(0, 42));
+  const auto *frame = reader.Peek();
+  ASSERT_NE(frame, nullptr);
+  ASSERT_EQ(frame->As<int>(), 42);
+}
+
+TEST(ShmFrameQueueTest, HugepageFailure) {
+  constexpr char kQueueName[] = "test_frame_queue_hugepage_failure";
+  ShmOptions options;
+  options.hugepage_dir_ = "/nonexistent";
+
+  ShmFrameWriter writer(kQueueName, 4096, options);
+  ShmFrameReader reader(kQueueName, 4096, options);
+  ASSERT_FALSE(writer.Ready());
+  ASSERT_FALSE(reader.Ready());
+  ASSERT_FALSE(writer.Write(0, 42));
+  ASSERT_EQ(reader.Peek(), nullptr);
+}
+
+TEST(ShmBroadcastTest, MultipleReaders) {
+  constexpr char kQueueName[] = "test_broadcast";
+  ScopedSegment segment(kQueueName);
+  constexpr int kNumMessages = 1000;
+
+  ShmBroadcastWriter writer(kQueueName, 4096);
+  ShmBroadcastReader reader1(kQueueName);
+  ShmBroadcastReader reader2(kQueueName);
+  ASSERT_EQ(reader1.Read(), nullptr);
+  for (int i = 0; i < kNumMessages; ++i) {
+    ASSERT_TRUE(writer.Write(i % 2, std::array<int, 5>{i}));
+    for (auto *reader : {&reader1, &reader2}) {
+      const auto *frame = reader->Read();
+      ASSERT_NE(frame, nullptr);
+      ASSERT_EQ(frame->seq_, i);
+      ASSERT_EQ(frame->type_, i % 2);
+      ASSERT_EQ((frame->As<std::array<int, 5>>()[0]), i);
+    }
+  }
+  ASSERT_EQ(reader1.Read(), nullptr);
+  ASSERT_EQ(reader2.Dropped(), 0);
+}
+
+TEST(ShmBroadcastTest, ReadBatch) {
+  constexpr char kQueueName[] = "test_broadcast_batch";
+  ScopedSegment segment(kQueueName);
+
+  ShmBroadcastWriter writer(kQueueName, 1024);
+  ShmBroadcastReader reader(kQueueName);
+  // Frames of 40 bytes, so the batches run across the end of the ring.
+  int expected = 0;
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 20; ++i) {
+      ASSERT_TRUE(writer.Write(0, std::array<int, 5>{round * 20 + i}));
+    }
+    size_t total = 0;
+    while (const auto n = reader.ReadBatch(8, [&](const FrameHeader &frame) {
+             ASSERT_EQ((frame.As<std::array<int, 5>>()[0]), expected++);
+           })) {
+      ASSERT_LE(n, 8);
+      total += n;
+    }
+    ASSERT_EQ(total, 20);
+  }
+  ASSERT_EQ(reader.Overruns(), 0);
+  ASSERT_EQ(reader.Dropped(), 0);
+}
+
+TEST(ShmBroadcastTest, Overrun) {
+  constexpr char kQueueName[] = "test_broadcast_overrun";
+  ScopedSegment segment(kQueueName);
+
+  ShmBroadcastWriter writer(kQueueName, 256);
+  ShmBroadcastReader slow(kQueueName);
+  ShmBroadcastReader fast(kQueueName);
+  // The writer never blocks, even with a reader that does not keep up.
+  for (long i = 0; i < 100; ++i) {
+    ASSERT_TRUE(writer.Write(0, std::array<long, 3>{i}));
+    const auto *frame = fast.Read();
+    ASSERT_NE(frame, nullptr);
+    ASSERT_EQ((frame->As<std::array<long, 3>>()[0]), i);
+  }
+  ASSERT_EQ(slow.Read(), nullptr);
+  ASSERT_EQ(slow.Overruns(), 1);
+  ASSERT_TRUE(writer.Write(0, std::array<long, 3>{100}));
+  const auto *frame = slow.Read();
+  ASSERT_NE(frame, nullptr);
+  ASSERT_EQ((frame->As<std::array<long, 3>>()[0]), 100);
+  ASSERT_EQ(slow.Dropped(), 100);
+  ASSERT_EQ(fast.Overruns(), 0);
+}
+
+TEST(ShmBroadcastTest, Reattach) {
+  constexpr char kQueueName[] = "test_broadcast_reattach";
+  ScopedSegment segment(kQueueName);
+
+  auto writer = std::make_unique<ShmBroadcastWriter>(kQueueName, 4096);
+  ASSERT_TRUE(writer->Ready());
+  ASSERT_EQ(writer->Generation(), 1);
+  {
+    ShmBroadcastReader reader(kQueueName);
+    ASSERT_TRUE(writer->Write(0, 1));
+    ASSERT_NE(reader.Read(), nullptr);
+  }
+  // A restarted reader attaches to the same segment at the live end.
+  ASSERT_TRUE(writer->Write(0, 2));
+  ShmBroadcastReader reader(kQueueName);
+  ASSERT_TRUE(reader.Ready());
+  ASSERT_TRUE(writer->Write(0, 3));
+  const auto *frame = reader.Read();
+  ASSERT_NE(frame, nullptr);
+  ASSERT_EQ(frame->As<int>(), 3);
+  // So does a restarted writer, the reader carries on.
+  writer.reset();
+  writer = std::make_unique<ShmBroadcastWriter>(kQueueName, 4096);
+  ASSERT_TRUE(writer->Ready());
+  ASSERT_EQ(reader.Generation(), 2);
+  ASSERT_TRUE(writer->Write(0, 4));
+  frame = reader.Read();
+  ASSERT_NE(frame, nullptr);
+  ASSERT_EQ(frame->As<int>(), 4);
+  ASSERT_EQ(reader.Dropped(), 0);
+}
+
+TEST(ShmBroadcastTest, LiveProducer) {
+  constexpr char kQueueName[] = "test_broadcast_producer";
+  ScopedSegment segment(kQueueName);
+
+  { ShmBroadcastWriter writer(kQueueName); }
+  const pid_t child = fork();
+  if (child == 0) {
+    pause();
+    _exit(0);
+  }
+  const auto region = MapSegment(kQueueName, sizeof(SegmentHeader), {});
+  static_cast<SegmentHeader *>(region.get_address())->producer_pid_ = child;
+  const auto ready = ShmBroadcastWriter(kQueueName).Ready();
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+  ASSERT_FALSE(ready);
+  // The producer is gone, its segment can be taken over.
+  ShmBroadcastWriter writer(kQueueName);
+  ASSERT_TRUE(writer.Ready());
+  ASSERT_EQ(writer.Generation(), 2);
+}
+
+TEST(ShmFrameQueueTest, Incompatible) {
+  constexpr char kQueueName[] = "test_frame_queue_version";
+  ScopedSegment segment(kQueueName);
+
+  {
+    const auto region = MapSegment(kQueueName, sizeof(SegmentHeader), {});
+    auto &header = *static_cast<SegmentHeader *>(region.get_address());
+    ASSERT_TRUE(InitSegmentHeader(header, 1024));
+    header.version_ = kSegmentVersion + 1;
+  }
+  ASSERT_FALSE(ShmFrameReader(kQueueName, 1024).Ready());
+  // The writer replaces a segment nobody can use.
+  ShmFrameWriter writer(kQueueName, 1024);
+  ASSERT_TRUE(writer.Ready());
+  ShmFrameReader reader(kQueueName, 1024);
+  ASSERT_TRUE(reader.Ready());
+  ASSERT_TRUE(writer.Write(0, 42));
+  ASSERT_NE(reader.Peek(), nullptr);
+}
+
+TEST(ShmConflatedTest, LatestValue) {
+  constexpr char kQueueName[] = "test_conflated";
+  ScopedSegment segment(kQueueName);
+  constexpr uint64_t kCount = 100;
+
+  ShmConflatedWriter<std::array<long, 3>> writer(kQueueName, kCount);
+  ShmConflatedReader<std::array<long, 3>> first(kQueueName, kCount);
+  ASSERT_TRUE(first.Attached());
+  ASSERT_EQ(first.Count(), kCount);
+  // Every slot is written ten times, each reader only sees the last write.
+  for (long round = 0; round < 10; ++round) {
+    for (uint64_t id = 0; id < kCount; id += 3) {
+      ASSERT_TRUE(writer.Write(id, {static_cast<long>(id), round}));
+    }
+  }
+  ASSERT_FALSE(writer.Write(kCount, {}));
+  ShmConflatedReader<std::array<long, 3>> second(kQueueName, kCount);
+  for (auto *reader : {&first, &second}) {
+    std::vector<uint64_t> ids;
+    reader->Drain([&ids](uint64_t id, const std::array<long, 3> &value) {
+      ASSERT_EQ(value[0], static_cast<long>(id));
+      ASSERT_EQ(value[1], 9);
+      ids.push_back(id);
+    });
+    ASSERT_EQ(ids.size(), 34);
+    ASSERT_TRUE(reader->Empty());
+    ASSERT_EQ(reader->Drain([](uint64_t, const std::array<long, 3> &) {}), 0);
+  }
+  std::array<long, 3> value{};
+  ASSERT_FALSE(second.Read(1, value));
+  ASSERT_TRUE(second.Read(99, value));
+  ASSERT_EQ(value[1], 9);
+}
+
+TEST(ShmConflatedTest, DeadWriter) {
+  constexpr char kQueueName[] = "test_conflated_dead";
+  ScopedSegment segment(kQueueName);
+  constexpr uint64_t kCount = 64;
+  using Slot = ConflatedSlot<long>;
+
+  auto writer = std::make_unique<ShmConflatedWriter<long>>(kQueueName, kCount);
+  ShmConflatedReader<long> reader(kQueueName, kCount);
+  ASSERT_TRUE(writer->Write(1, 10));
+  ASSERT_TRUE(writer->Write(2, 20));
+  // A writer dying in the middle of a write leaves the sequence odd. One
+  // bitmap word per reader rounded up to a cache line.
+  const auto region = MapSegment(kQueueName, 0, {});
+  auto *slots = reinterpret_cast<Slot *>(
+      static_cast<char *>(region.get_address()) +
+      sizeof(ShmConflatedHeader) +
+      8 * ShmConflatedHeader::kMaxReaders * sizeof(uint64_t));
+  slots[1].seq_.fetch_add(1);
+  long value = 0;
+  ASSERT_FALSE(reader.Read(1, value));
+  ASSERT_TRUE(reader.Read(2, value));
+  ASSERT_EQ(value, 20);
+
+  // The next writer drops the torn value
+  writer.reset();
+  writer = std::make_unique<ShmConflatedWriter<long>>(kQueueName, kCount);
+  ASSERT_TRUE(writer->Ready());
+  ASSERT_EQ(slots[1].seq_.load(), 0);
+  std::vector<uint64_t> ids;
+  reader.Drain([&ids](uint64_t id, long) { ids.push_back(id); });
+  ASSERT_EQ(ids, std::vector<uint64_t>{2});
+  ASSERT_TRUE(writer->Write(1, 11));
+  ASSERT_TRUE(reader.Read(1, value));
+  ASSERT_EQ(value, 11);
+}
+
+TEST(ChannelStatsTest, Counters) {
+  constexpr size_t kQueueSize = 16;
+  constexpr char kQueueName[] = "test_queue_stats";
+  ScopedSegment segment(kQueueName);
+
+  ShmSpscWriter<int, kQueueSize> writer(kQueueName);
+  ShmSpscReader<int, kQueueSize> reader(kQueueName);
+  for (int i = 0; i < 20; ++i) {
+    writer.Write(i);
+  }
+  int value;
+  while (reader.Read(value)) {
+  }
+
+  const auto region = MapSegment(StatsPrefix(kQueueName) + "tx",
+                                 sizeof(ChannelStats), {});
+  const auto &stats = *static_cast<ChannelStats *>(region.get_address());
+  ASSERT_EQ(stats.magic_, ChannelStats::kMagic);
+  ASSERT_EQ(stats.writer_, 1);
+  ASSERT_EQ(stats.messages_, kQueueSize);
+  ASSERT_EQ(stats.drops_, 4);
+  ASSERT_EQ(stats.high_water_, kQueueSize);
+}
+
+TEST(StatsBlockTest, RemoveDeadReaders) {
+  constexpr char kChannel[] = "test_queue_stats_dead";
+  const auto prefix = StatsPrefix(kChannel) + "rx.";
+  // A reader killed without removing its block
+  const auto child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    _exit(0);
+  }
+  waitpid(child, nullptr, 0);
+  const auto dead = prefix + std::to_string(child) + ".0";
+  MapSegment(dead, sizeof(ChannelStats), {});
+  ASSERT_TRUE(std::filesystem::exists("/dev/shm/" + dead));
+
+  StatsBlock live(kChannel, false);
+  EXPECT_FALSE(std::filesystem::exists("/dev/shm/" + dead));
+  EXPECT_TRUE(std::filesystem::exists("/dev/shm/" + live.Name()));
+  EXPECT_EQ(live.Get().pid_, getpid());
+  StatsBlock other(kChannel, false);
+  EXPECT_TRUE(std::filesystem::exists("/dev/shm/" + live.Name()));
+}
+
+TEST(StatsBlockTest, RefusedWriter) {
+  constexpr char kQueueName[] = "test_queue_stats_refused";
+  ScopedSegment segment(kQueueName);
+
+  ShmBroadcastWriter writer(kQueueName);
+  ASSERT_TRUE(writer.Write(0, 1));
+  ASSERT_TRUE(writer.Write(0, 2));
+  // A second producer is refused and leaves the block of the live one alone
+  const auto child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    {
+      ShmBroadcastWriter second(kQueueName);
+      if (second.Ready()) {
+        _exit(1);
+      }
+    }
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(child, &status, 0);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  const auto name = StatsPrefix(kQueueName) + "tx";
+  ASSERT_TRUE(std::filesystem::exists("/dev/shm/" + name));
+  const auto region = MapSegment(name, sizeof(ChannelStats), {});
+  const auto &stats = *static_cast<ChannelStats *>(region.get_address());
+  EXPECT_EQ(stats.magic_, ChannelStats::kMagic);
+  EXPECT_EQ(stats.pid_, getpid());
+  EXPECT_EQ(stats.messages_, 2);
+  EXPECT_EQ(stats.drops_, 0);
+}
+
 } // namespace
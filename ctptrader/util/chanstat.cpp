@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+#include <util/stats.hpp>
+
+using namespace ctptrader::util;
+
+namespace {
+
+struct Snapshot {
+  uint64_t messages_;
+  uint64_t drops_;
+  uint64_t high_water_;
+  uint64_t latency_[ChannelStats::kLatencyBuckets];
+};
+
+/// @brief Copies a block mapped read only, the endpoint keeps running.
+Snapshot Read(const ChannelStats &stats) {
+  Snapshot snap{};
+  snap.messages_ = stats.messages_.load(std::memory_order_relaxed);
+  snap.drops_ = stats.drops_.load(std::memory_order_relaxed);
+  snap.high_water_ = stats.high_water_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < ChannelStats::kLatencyBuckets; ++i) {
+    snap.latency_[i] = stats.latency_[i].load(std::memory_order_relaxed);
+  }
+  return snap;
+}
+
+/// @brief Upper bound in nanoseconds of the bucket holding quantile q.
+double Percentile(const Snapshot &snap, double tsc_per_ns, double q) {
+  uint64_t total = 0;
+  for (const auto n : snap.latency_) {
+    total += n;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const auto rank = static_cast<uint64_t>(std::ceil(q * total));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < ChannelStats::kLatencyBuckets; ++i) {
+    seen += snap.latency_[i];
+    if (seen >= rank) {
+      return std::ldexp(1.0, i) / tsc_per_ns;
+    }
+  }
+  return 0;
+}
+
+void Print(const std::string &name, const ChannelStats &stats,
+           const Snapshot &snap, const Snapshot &prev, double seconds) {
+  const auto rate = seconds > 0 ? (snap.messages_ - prev.messages_) / seconds
+                                : 0.0;
+  std::printf("%-40s %s msgs %12lu %10.0f/s drops %8lu high %10lu",
+              name.c_str(), stats.writer_ ? "tx" : "rx", snap.messages_, rate,
+              snap.drops_, snap.high_water_);
+  if (!stats.writer_) {
+    std::printf("  p50 <%.0fns p99 <%.0fns p99.9 <%.0fns",
+                Percentile(snap, stats.tsc_per_ns_, 0.5),
+                Percentile(snap, stats.tsc_per_ns_, 0.99),
+                Percentile(snap, stats.tsc_per_ns_, 0.999));
+  }
+  if (!ProcessAlive(stats.pid_)) {
+    std::printf("  [pid %d gone]", stats.pid_);
+  }
+  std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::printf("Usage: %s <channel> [interval_ms]\n", argv[0]);
+    return 1;
+  }
+  const auto prefix = StatsPrefix(argv[1]);
+  const int interval = argc > 2 ? std::stoi(argv[2]) : 0;
+  std::map<std::string, Snapshot> prev;
+  while (true) {
+    for (const auto &entry : std::filesystem::directory_iterator("/dev/shm")) {
+      const auto name = entry.path().filename().string();
+      if (name.rfind(prefix, 0) != 0) {
+        continue;
+      }
+      // A block can be removed after the listing, or still be sized by the
+      // endpoint creating it.
+      bip::mapped_region region;
+      try {
+        bip::shared_memory_object shm(bip::open_only, name.c_str(),
+                                      bip::read_only);
+        region = bip::mapped_region(shm, bip::read_only);
+      } catch (const bip::interprocess_exception &) {
+        continue;
+      }
+      if (region.get_size() < sizeof(ChannelStats)) {
+        continue;
+      }
+      const auto &stats = *static_cast<const ChannelStats *>(
+          region.get_address());
+      if (stats.magic_.load(std::memory_order_acquire) !=
+          ChannelStats::kMagic) {
+        continue;
+      }
+      const auto snap = Read(stats);
+      const auto it = prev.find(name);
+      Print(name, stats, snap, it == prev.end() ? snap : it->second,
+            interval / 1000.0);
+      prev[name] = snap;
+    }
+    if (interval <= 0) {
+      break;
+    }
+    std::printf("\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+  }
+  return 0;
+}
@@ -0,0 +1,340 @@
+#include <util/record.hpp>
+
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ctptrader::util {
+
+namespace {
+
+constexpr uint64_t kIndexBytes =
+    RecordFileHeader::kIndexSlots * sizeof(RecordIndexEntry);
+constexpr uint64_t kDataOffset = kRecordAlign + kIndexBytes;
+
+constexpr uint64_t AlignUp(uint64_t bytes) {
+  return (bytes + kRecordAlign - 1) & ~(kRecordAlign - 1);
+}
+
+constexpr uint64_t AlignDown(uint64_t bytes) {
+  return bytes & ~(kRecordAlign - 1);
+}
+
+uint8_t *AllocAligned(uint64_t bytes) {
+  auto *p = static_cast<uint8_t *>(std::aligned_alloc(kRecordAlign, bytes));
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  std::memset(p, 0, bytes);
+  return p;
+}
+
+int64_t NowNs() {
+  timespec ts{};
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/// @brief Reads up to bytes, short at the end of the file.
+bool ReadAll(int fd, uint8_t *data, uint64_t bytes, uint64_t offset) {
+  while (bytes > 0) {
+    const auto n = pread(fd, data, bytes, static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return n == 0;
+    }
+    data += n;
+    bytes -= n;
+    offset += n;
+  }
+  return true;
+}
+
+} // namespace
+
+RecordWriter::RecordWriter(uint64_t block_bytes, size_t blocks)
+    : block_bytes_(std::max(AlignUp(block_bytes), kRecordAlign))
+    , header_(reinterpret_cast<RecordFileHeader *>(AllocAligned(kRecordAlign)))
+    , index_(reinterpret_cast<RecordIndexEntry *>(AllocAligned(kIndexBytes)))
+    , meta_(AllocAligned(kDataOffset))
+    , io_meta_(AllocAligned(kDataOffset)) {
+  // One block is filled while the others are on their way to the disk
+  for (size_t i = 0; i < std::max<size_t>(blocks, 2); ++i) {
+    blocks_.push_back(AllocAligned(block_bytes_));
+  }
+}
+
+RecordWriter::~RecordWriter() {
+  Close();
+  for (auto *block : blocks_) {
+    std::free(block);
+  }
+  std::free(header_);
+  std::free(index_);
+  std::free(meta_);
+  std::free(io_meta_);
+}
+
+bool RecordWriter::Open(const std::string &path, int32_t trading_day) {
+  Close();
+  failed_ = false;
+  direct_ = true;
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+  if (fd_ < 0 && errno == EINVAL) {
+    direct_ = false;
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+  if (fd_ < 0) {
+    return false;
+  }
+  struct stat st {};
+  bool ok = fstat(fd_, &st) == 0;
+  if (ok && st.st_size == 0) {
+    std::memset(header_, 0, kRecordAlign);
+    std::memset(index_, 0, kIndexBytes);
+    header_->magic_ = RecordFileHeader::kMagic;
+    header_->version_ = RecordFileHeader::kVersion;
+    header_->trading_day_ = trading_day;
+    header_->data_offset_ = kDataOffset;
+    header_->created_ns_ = header_->updated_ns_ = NowNs();
+    ok = ftruncate(fd_, kDataOffset) == 0 &&
+         WriteAll(reinterpret_cast<uint8_t *>(header_), kRecordAlign, 0);
+  } else if (ok) {
+    // Records past data_bytes_ were never flushed, they are overwritten
+    ok = ReadAll(fd_, reinterpret_cast<uint8_t *>(header_), kRecordAlign, 0) &&
+         ReadAll(fd_, reinterpret_cast<uint8_t *>(index_), kIndexBytes,
+                 kRecordAlign) &&
+         header_->magic_ == RecordFileHeader::kMagic &&
+         header_->version_ == RecordFileHeader::kVersion &&
+         header_->trading_day_ == trading_day &&
+         header_->data_offset_ == kDataOffset &&
+         header_->index_used_ <= RecordFileHeader::kIndexSlots;
+  }
+  if (!ok) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  data_bytes_ = flushed_bytes_ = header_->data_bytes_;
+  records_ = header_->records_;
+  index_used_ = dirty_begin_ = header_->index_used_;
+  std::memcpy(meta_, header_, kRecordAlign);
+  std::memcpy(meta_ + kRecordAlign, index_, kIndexBytes);
+  meta_begin_ = meta_end_ = index_used_;
+  free_ = blocks_;
+  block_ = TakeBlock();
+  // Appending starts inside the last page on disk, which is read back
+  const auto end = kDataOffset + data_bytes_;
+  block_offset_ = AlignDown(end);
+  used_ = end - block_offset_;
+  if (used_ > 0 && !ReadAll(fd_, block_, kRecordAlign, block_offset_)) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  io_ = std::thread([this]() { Io(); });
+  return true;
+}
+
+void RecordWriter::Close() {
+  if (!IsOpen()) {
+    return;
+  }
+  Flush();
+  {
+    std::lock_guard lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_one();
+  io_.join();
+  stop_ = false;
+  if (ftruncate(fd_, static_cast<off_t>(kDataOffset + data_bytes_)) != 0 ||
+      fdatasync(fd_) != 0) {
+    failed_ = true;
+  }
+  close(fd_);
+  fd_ = -1;
+}
+
+void RecordWriter::Flush() {
+  if (!IsOpen() || data_bytes_ == flushed_bytes_) {
+    return;
+  }
+  // Whole pages go to the disk, the partial last page moves to the next
+  // block and is written again with the records that complete it.
+  if (used_ > 0) {
+    const auto whole = AlignDown(used_);
+    const auto partial = used_ - whole;
+    auto *next = TakeBlock();
+    std::memcpy(next, block_ + whole, partial);
+    std::memset(block_ + used_, 0, AlignUp(used_) - used_);
+    Submit({block_, AlignUp(used_), block_offset_, 0});
+    block_ = next;
+    block_offset_ += whole;
+    used_ = partial;
+  }
+
+  header_->data_bytes_ = data_bytes_;
+  header_->records_ = records_;
+  header_->index_used_ = index_used_;
+  header_->updated_ns_ = NowNs();
+  {
+    std::lock_guard lock(mutex_);
+    std::memcpy(meta_, header_, kRecordAlign);
+    std::memcpy(meta_ + kRecordAlign + dirty_begin_ * sizeof(RecordIndexEntry),
+                index_ + dirty_begin_,
+                (index_used_ - dirty_begin_) * sizeof(RecordIndexEntry));
+    meta_end_ = index_used_;
+    jobs_.push_back({nullptr, 0, 0, ++meta_id_});
+  }
+  work_cv_.notify_one();
+  dirty_begin_ = index_used_;
+  flushed_bytes_ = data_bytes_;
+}
+
+void RecordWriter::Submit(const Job &job) {
+  {
+    std::lock_guard lock(mutex_);
+    jobs_.push_back(job);
+  }
+  work_cv_.notify_one();
+}
+
+uint8_t *RecordWriter::TakeBlock() {
+  std::unique_lock lock(mutex_);
+  free_cv_.wait(lock, [this]() { return !free_.empty(); });
+  auto *block = free_.back();
+  free_.pop_back();
+  return block;
+}
+
+void RecordWriter::Io() {
+  while (true) {
+    Job job{};
+    // Index bytes of io_meta_ to write
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    {
+      std::unique_lock lock(mutex_);
+      work_cv_.wait(lock, [this]() { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      job = jobs_.front();
+      jobs_.pop_front();
+      if (job.block_ == nullptr) {
+        // Only the newest update is written, it covers the older ones
+        if (job.meta_id_ != meta_id_) {
+          continue;
+        }
+        begin = AlignDown(meta_begin_ * sizeof(RecordIndexEntry));
+        end = AlignUp(meta_end_ * sizeof(RecordIndexEntry));
+        std::memcpy(io_meta_, meta_, kRecordAlign);
+        std::memcpy(io_meta_ + kRecordAlign + begin,
+                    meta_ + kRecordAlign + begin, end - begin);
+        meta_begin_ = meta_end_;
+      }
+    }
+    if (job.block_ != nullptr) {
+      WriteAll(job.block_, job.bytes_, job.offset_);
+      {
+        std::lock_guard lock(mutex_);
+        free_.push_back(job.block_);
+      }
+      free_cv_.notify_one();
+      continue;
+    }
+    // The index before the header, so the header never points past it
+    if (end > begin) {
+      WriteAll(io_meta_ + kRecordAlign + begin, end - begin,
+               kRecordAlign + begin);
+    }
+    WriteAll(io_meta_, kRecordAlign, 0);
+  }
+}
+
+bool RecordWriter::WriteAll(const uint8_t *data, uint64_t bytes,
+                            uint64_t offset) {
+  while (bytes > 0) {
+    const auto n = pwrite(fd_, data, bytes, static_cast<off_t>(offset));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      failed_ = true;
+      return false;
+    }
+    data += n;
+    bytes -= n;
+    offset += n;
+  }
+  return true;
+}
+
+RecordReader::~RecordReader() { Unmap(); }
+
+void RecordReader::Unmap() {
+  if (map_ != nullptr) {
+    munmap(map_, map_bytes_);
+    map_ = nullptr;
+  }
+  header_ = nullptr;
+  end_ = 0;
+}
+
+bool RecordReader::Open(const std::string &path) {
+  Unmap();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < kDataOffset) {
+    close(fd);
+    return false;
+  }
+  map_bytes_ = st.st_size;
+  map_ = mmap(nullptr, map_bytes_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map_ == MAP_FAILED) {
+    map_ = nullptr;
+    return false;
+  }
+  const auto *base = static_cast<const uint8_t *>(map_);
+  header_ = reinterpret_cast<const RecordFileHeader *>(base);
+  if (header_->magic_ != RecordFileHeader::kMagic ||
+      header_->version_ != RecordFileHeader::kVersion ||
+      header_->data_offset_ != kDataOffset) {
+    Unmap();
+    return false;
+  }
+  index_ = reinterpret_cast<const RecordIndexEntry *>(base + kRecordAlign);
+  data_ = base + kDataOffset;
+  end_ = std::min(header_->data_bytes_, map_bytes_ - kDataOffset);
+  // Replay walks the records front to back
+  madvise(map_, map_bytes_, MADV_SEQUENTIAL);
+  return true;
+}
+
+uint64_t RecordReader::Seek(int64_t time_ns) const {
+  const auto slots =
+      std::min(header_->index_used_, RecordFileHeader::kIndexSlots);
+  const auto *slot = std::partition_point(
+      index_, index_ + slots,
+      [time_ns](const RecordIndexEntry &e) { return e.time_ns_ < time_ns; });
+  auto offset = slot == index_ ? 0 : std::min((slot - 1)->offset_, end_);
+  while (offset < end_ && At(offset).time_ns_ < time_ns) {
+    offset = Next(offset);
+  }
+  return offset;
+}
+
+} // namespace ctptrader::util
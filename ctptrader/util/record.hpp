@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <util/channel.hpp>
+
+namespace ctptrader::util {
+
+/// @brief Alignment of every write to a record file, the logical block size
+/// O_DIRECT asks for.
+constexpr uint64_t kRecordAlign = 4096;
+
+/// @brief First page of a record file. A record file keeps the frames of a
+/// channel for one trading day: this header, a fixed size index and then the
+/// records, one after the other.
+struct RecordFileHeader {
+  static constexpr uint64_t kMagic = 0x3143455254505443; // "CTPTREC1"
+  static constexpr uint32_t kVersion = 1;
+  /// @brief Slots of the index, slot i points at the first record starting
+  /// at or after i * kIndexStride bytes of records.
+  static constexpr uint64_t kIndexSlots = 65536;
+  static constexpr uint64_t kIndexStride = 1 << 20;
+
+  uint64_t magic_;
+  uint32_t version_;
+  int32_t trading_day_;  // yyyymmdd
+  uint64_t data_offset_; // file offset of the first record
+  uint64_t data_bytes_;  // bytes of records on disk
+  uint64_t records_;     // records on disk
+  uint64_t index_used_;  // index slots filled
+  int64_t created_ns_;
+  int64_t updated_ns_; // last flush
+};
+
+/// @brief Slot of the index of a record file.
+struct RecordIndexEntry {
+  int64_t time_ns_; // of the record the slot points at
+  uint64_t offset_; // from the first record
+};
+
+/// @brief Header in front of every record: the frame header of the channel
+/// with the time the frame was read in place of its TSC, which means nothing
+/// after a reboot. Records are 8-byte aligned like frames.
+struct alignas(8) RecordHeader {
+  uint32_t seq_;    // +4 bytes, sequence number on the channel
+  uint16_t type_;   // +2 bytes
+  uint16_t size_;   // +2 bytes
+  int64_t time_ns_; // +8 bytes, CLOCK_REALTIME when the frame was read
+
+  [[nodiscard]] const void *Data() const { return this + 1; }
+
+  template <typename T> [[nodiscard]] const T &As() const {
+    return *static_cast<const T *>(Data());
+  }
+};
+static_assert(sizeof(RecordHeader) == sizeof(FrameHeader));
+
+/// @brief Bytes a record with a payload of size bytes occupies in the file.
+constexpr uint64_t RecordBytes(uint64_t size) { return FrameBytes(size); }
+
+/// @brief Appends records to a record file from a single thread.
+///
+/// Records are gathered in aligned blocks that a background thread writes
+/// with O_DIRECT, so appending is a copy and never waits for the disk unless
+/// every block is still in flight. Flush hands over the partial block and
+/// updates the header and the dirty index pages, a crash loses the records
+/// since the last flush only.
+class RecordWriter {
+public:
+  static constexpr uint64_t kDefaultBlockBytes = 4 << 20;
+  static constexpr size_t kDefaultBlocks = 4;
+
+  /// @param block_bytes Bytes per block, a multiple of kRecordAlign.
+  /// @param blocks Blocks the appending thread and the disk share.
+  /// @throws std::bad_alloc If the blocks cannot be allocated.
+  explicit RecordWriter(uint64_t block_bytes = kDefaultBlockBytes,
+                        size_t blocks = kDefaultBlocks);
+  ~RecordWriter();
+
+  RecordWriter(const RecordWriter &) = delete;
+  RecordWriter &operator=(const RecordWriter &) = delete;
+
+  /// @brief Creates a record file, or appends to the one of the same trading
+  /// day left by an earlier run.
+  ///
+  /// @return False if the file cannot be opened or belongs to another
+  /// trading day or format.
+  bool Open(const std::string &path, int32_t trading_day);
+
+  /// @brief Flushes, waits for the disk and cuts the file after its last
+  /// record.
+  void Close();
+
+  [[nodiscard]] bool IsOpen() const { return fd_ >= 0; }
+
+  /// @brief Whether the file bypasses the page cache. File systems without
+  /// O_DIRECT, such as tmpfs, are written through the page cache instead.
+  [[nodiscard]] bool Direct() const { return direct_; }
+
+  /// @brief Whether a write to the file failed.
+  [[nodiscard]] bool Failed() const {
+    return failed_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] int32_t TradingDay() const { return header_->trading_day_; }
+
+  /// @brief Records appended, including the ones not flushed yet.
+  [[nodiscard]] uint64_t Records() const { return records_; }
+
+  /// @brief Appends a frame read from a channel.
+  void Append(const FrameHeader &frame, int64_t time_ns) {
+    const RecordHeader record{frame.seq_, frame.type_, frame.size_, time_ns};
+    Index(time_ns);
+    Put(&record, sizeof(record));
+    Put(frame.Data(), RecordBytes(frame.size_) - sizeof(record));
+    ++records_;
+  }
+
+  /// @brief Hands the records appended so far to the disk.
+  void Flush();
+
+private:
+  struct Job {
+    uint8_t *block_;   // nullptr for a header and index update
+    uint64_t bytes_;   // to write, a multiple of kRecordAlign
+    uint64_t offset_;  // in the file
+    uint64_t meta_id_; // of the header and index update
+  };
+
+  /// @brief Points the next index slot at a record starting at data_bytes_.
+  void Index(int64_t time_ns) {
+    while (index_used_ < RecordFileHeader::kIndexSlots &&
+           data_bytes_ >= index_used_ * RecordFileHeader::kIndexStride) {
+      index_[index_used_++] = {time_ns, data_bytes_};
+    }
+  }
+
+  void Put(const void *data, uint64_t bytes) {
+    const auto *src = static_cast<const uint8_t *>(data);
+    data_bytes_ += bytes;
+    while (bytes > 0) {
+      const auto n = std::min(bytes, block_bytes_ - used_);
+      std::memcpy(block_ + used_, src, n);
+      used_ += n;
+      src += n;
+      bytes -= n;
+      if (used_ == block_bytes_) {
+        Submit({block_, block_bytes_, block_offset_, 0});
+        block_ = TakeBlock();
+        block_offset_ += block_bytes_;
+        used_ = 0;
+      }
+    }
+  }
+
+  void Submit(const Job &job);
+  uint8_t *TakeBlock();
+  void Io();
+  bool WriteAll(const uint8_t *data, uint64_t bytes, uint64_t offset);
+
+  const uint64_t block_bytes_;
+  std::vector<uint8_t *> blocks_; // every block, owned
+  int fd_{-1};
+  bool direct_{false};
+  std::atomic<bool> failed_{false};
+
+  // Appending thread
+  uint8_t *block_{nullptr};   // being filled
+  uint64_t used_{0};          // bytes in block_
+  uint64_t block_offset_{0};  // file offset of block_
+  uint64_t data_bytes_{0};    // bytes of records appended
+  uint64_t records_{0};       // records appended
+  uint64_t flushed_bytes_{0}; // data_bytes_ at the last flush
+  RecordFileHeader *header_;  // in an aligned page
+  RecordIndexEntry *index_;   // every slot, aligned
+  uint64_t index_used_{0};
+  uint64_t dirty_begin_{0}; // first slot filled since the last flush
+
+  // Shared with the disk thread
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable free_cv_;
+  std::deque<Job> jobs_;
+  std::vector<uint8_t *> free_;
+  bool stop_{false};
+  uint8_t *meta_;          // header page and index as of the newest flush
+  uint64_t meta_id_{0};    // of the newest flush
+  uint64_t meta_begin_{0}; // slots of meta_ not on disk yet
+  uint64_t meta_end_{0};
+
+  // Disk thread
+  uint8_t *io_meta_; // header page and dirty index pages being written
+  std::thread io_;
+};
+
+/// @brief Maps a record file read only. Records are walked by their offset
+/// from the first record, the end offset is the one of a record past the
+/// last.
+class RecordReader {
+public:
+  RecordReader() = default;
+  ~RecordReader();
+
+  RecordReader(const RecordReader &) = delete;
+  RecordReader &operator=(const RecordReader &) = delete;
+
+  /// @return False if the file is missing or not a record file.
+  bool Open(const std::string &path);
+
+  [[nodiscard]] const RecordFileHeader &Header() const { return *header_; }
+
+  /// @brief Offset past the last record.
+  [[nodiscard]] uint64_t End() const { return end_; }
+
+  [[nodiscard]] const RecordHeader &At(uint64_t offset) const {
+    return *reinterpret_cast<const RecordHeader *>(data_ + offset);
+  }
+
+  [[nodiscard]] uint64_t Next(uint64_t offset) const {
+    return offset + RecordBytes(At(offset).size_);
+  }
+
+  /// @brief Offset of the first record read at or after time_ns, found with
+  /// the index and a short scan.
+  [[nodiscard]] uint64_t Seek(int64_t time_ns) const;
+
+  /// @brief Calls f on every record from offset on.
+  template <typename F> void ForEach(F &&f, uint64_t offset = 0) const {
+    for (; offset < end_; offset = Next(offset)) {
+      f(At(offset));
+    }
+  }
+
+private:
+  void Unmap();
+
+  void *map_{nullptr};
+  uint64_t map_bytes_{0};
+  const RecordFileHeader *header_{nullptr};
+  const RecordIndexEntry *index_{nullptr};
+  const uint8_t *data_{nullptr};
+  uint64_t end_{0};
+};
+
+} // namespace ctptrader::util
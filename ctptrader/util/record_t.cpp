@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <filesystem>
+
+#include <util/record.hpp>
+
+namespace {
+
+using namespace ctptrader::util;
+
+/// @brief A frame as the broadcast reader hands it out, with a payload of
+/// size bytes that all hold the low byte of seq.
+struct TestFrame {
+  TestFrame(uint32_t seq, uint16_t size) {
+    auto &header = *reinterpret_cast<FrameHeader *>(buf_.data());
+    header = {seq, static_cast<uint16_t>(seq % 9), size, 0};
+    std::memset(buf_.data() + 2, static_cast<int>(seq & 0xff), size);
+  }
+
+  [[nodiscard]] const FrameHeader &Header() const {
+    return *reinterpret_cast<const FrameHeader *>(buf_.data());
+  }
+
+  std::array<uint64_t, 64> buf_{};
+};
+
+uint16_t SizeOf(uint32_t seq) { return static_cast<uint16_t>(seq * 37 % 400); }
+
+/// @brief Record files are removed before and after every test.
+struct ScopedFile {
+  explicit ScopedFile(std::string path) : path_(std::move(path)) {
+    std::filesystem::remove(path_);
+  }
+  ~ScopedFile() { std::filesystem::remove(path_); }
+
+  const std::string path_;
+};
+
+void Append(RecordWriter &writer, uint32_t begin, uint32_t end) {
+  for (auto seq = begin; seq < end; ++seq) {
+    writer.Append(TestFrame(seq, SizeOf(seq)).Header(), 1000L * seq);
+  }
+}
+
+void Check(const RecordReader &reader, uint32_t count) {
+  uint32_t seq = 0;
+  reader.ForEach([&seq](const RecordHeader &record) {
+    ASSERT_EQ(record.seq_, seq);
+    EXPECT_EQ(record.type_, seq % 9);
+    EXPECT_EQ(record.size_, SizeOf(seq));
+    EXPECT_EQ(record.time_ns_, 1000L * seq);
+    const auto *data = static_cast<const uint8_t *>(record.Data());
+    for (uint16_t i = 0; i < record.size_; ++i) {
+      ASSERT_EQ(data[i], seq & 0xff);
+    }
+    ++seq;
+  });
+  EXPECT_EQ(seq, count);
+}
+
+TEST(RecordTest, RoundTrip) {
+  ScopedFile file("record_t.rec");
+  // Small blocks, so records span blocks and blocks wait for the disk
+  RecordWriter writer(2 * kRecordAlign, 2);
+  ASSERT_TRUE(writer.Open(file.path_, 20231106));
+  Append(writer, 0, 5000);
+  writer.Flush();
+  Append(writer, 5000, 10000);
+  writer.Close();
+  EXPECT_FALSE(writer.Failed());
+
+  RecordReader reader;
+  ASSERT_TRUE(reader.Open(file.path_));
+  EXPECT_EQ(reader.Header().trading_day_, 20231106);
+  EXPECT_EQ(reader.Header().records_, 10000U);
+  EXPECT_EQ(reader.Header().index_used_,
+            reader.End() / RecordFileHeader::kIndexStride + 1);
+  Check(reader, 10000);
+}
+
+TEST(RecordTest, Reopen) {
+  ScopedFile file("record_t.rec");
+  {
+    RecordWriter writer;
+    ASSERT_TRUE(writer.Open(file.path_, 20231106));
+    Append(writer, 0, 3);
+  }
+  RecordWriter writer;
+  EXPECT_FALSE(writer.Open(file.path_, 20231107));
+  ASSERT_TRUE(writer.Open(file.path_, 20231106));
+  EXPECT_EQ(writer.Records(), 3U);
+  Append(writer, 3, 7000);
+  writer.Close();
+
+  RecordReader reader;
+  ASSERT_TRUE(reader.Open(file.path_));
+  Check(reader, 7000);
+  EXPECT_FALSE(RecordReader().Open("record_t.missing"));
+}
+
+TEST(RecordTest, Seek) {
+  ScopedFile file("record_t.rec");
+  constexpr uint32_t kCount = 30000;
+  {
+    RecordWriter writer;
+    ASSERT_TRUE(writer.Open(file.path_, 20231106));
+    Append(writer, 0, kCount);
+  }
+  RecordReader reader;
+  ASSERT_TRUE(reader.Open(file.path_));
+  // More than a few index slots
+  ASSERT_GT(reader.Header().index_used_, 3U);
+  EXPECT_EQ(reader.Seek(0), 0U);
+  for (const uint32_t seq : {1U, 7777U, 15000U, kCount - 1}) {
+    const auto offset = reader.Seek(1000L * seq);
+    ASSERT_LT(offset, reader.End());
+    EXPECT_EQ(reader.At(offset).seq_, seq);
+  }
+  EXPECT_EQ(reader.Seek(1000L * kCount), reader.End());
+}
+
+} // namespace
@@ -0,0 +1,127 @@
+#include <util/shm.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+namespace ctptrader::util {
+
+namespace {
+
+std::string HugepagePath(const std::string &name, const ShmOptions &options) {
+  return options.hugepage_dir_ + "/" + name;
+}
+
+} // namespace
+
+bip::mapped_region MapSegment(const std::string &name, uint64_t size,
+                              const ShmOptions &options) {
+  const bip::map_options_t map_options =
+      options.populate_ ? MAP_POPULATE : bip::default_map_options;
+  const auto bytes = static_cast<bip::offset_t>(size);
+  if (options.hugepage_dir_.empty()) {
+    bip::shared_memory_object shm(bip::open_or_create, name.c_str(),
+                                  bip::read_write);
+    if (bip::offset_t cur = 0; !shm.get_size(cur) || cur < bytes) {
+      shm.truncate(bytes);
+    }
+    return {shm, bip::read_write, 0, 0, nullptr, map_options};
+  }
+  // Files on hugetlbfs are always backed by huge pages, and can only be sized
+  // in whole huge pages: ftruncate fails with EINVAL otherwise.
+  const auto path = HugepagePath(name, options);
+  const int fd = open(path.c_str(), O_CREAT | O_RDWR, 0666);
+  if (fd < 0) {
+    std::cerr << "Failed to open " << path << ": " << std::strerror(errno)
+              << std::endl;
+    return {};
+  }
+  struct statfs fs {};
+  struct stat st {};
+  bool sized = fstatfs(fd, &fs) == 0 && fstat(fd, &st) == 0;
+  if (sized && st.st_size < bytes) {
+    const auto page = static_cast<bip::offset_t>(fs.f_bsize);
+    sized = ftruncate(fd, (bytes + page - 1) / page * page) == 0;
+  }
+  const int error = errno;
+  close(fd);
+  if (!sized) {
+    std::cerr << "Failed to size " << path << ": " << std::strerror(error)
+              << std::endl;
+    return {};
+  }
+  bip::file_mapping file(path.c_str(), bip::read_write);
+  return {file, bip::read_write, 0, 0, nullptr, map_options};
+}
+
+void RemoveSegment(const std::string &name, const ShmOptions &options) {
+  if (options.hugepage_dir_.empty()) {
+    bip::shared_memory_object::remove(name.c_str());
+  } else {
+    bip::file_mapping::remove(HugepagePath(name, options).c_str());
+  }
+}
+
+bool InitSegmentHeader(SegmentHeader &header, uint64_t size) {
+  uint32_t state = 0;
+  if (header.state_.compare_exchange_strong(state, 1)) {
+    header.magic_ = SegmentHeader::kMagic;
+    header.version_ = kSegmentVersion;
+    header.size_ = size;
+    header.state_.store(SegmentHeader::kReady, std::memory_order_release);
+  }
+  while (header.state_.load(std::memory_order_acquire) !=
+         SegmentHeader::kReady) {
+    if (header.state_.load(std::memory_order_relaxed) > SegmentHeader::kReady) {
+      // Not a segment header at all
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return header.magic_ == SegmentHeader::kMagic &&
+         header.version_ == kSegmentVersion;
+}
+
+bool ProcessAlive(int32_t pid) {
+  return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+bool AttachProducer(SegmentHeader &header) {
+  const int32_t self = getpid();
+  auto pid = header.producer_pid_.load(std::memory_order_acquire);
+  do {
+    if (pid != self && ProcessAlive(pid)) {
+      return false;
+    }
+  } while (!header.producer_pid_.compare_exchange_weak(pid, self));
+  header.generation_.fetch_add(1, std::memory_order_release);
+  return true;
+}
+
+void AttachConsumer(SegmentHeader &header) {
+  header.consumer_pid_.store(getpid(), std::memory_order_release);
+}
+
+void DetachProducer(SegmentHeader &header) {
+  int32_t self = getpid();
+  header.producer_pid_.compare_exchange_strong(self, 0);
+}
+
+void DetachConsumer(SegmentHeader &header) {
+  int32_t self = getpid();
+  header.consumer_pid_.compare_exchange_strong(self, 0);
+}
+
+} // namespace ctptrader::util
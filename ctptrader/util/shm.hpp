@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace ctptrader::util {
+
+namespace bip = boost::interprocess;
+
+/// @brief How the pages of a shared memory segment are backed.
+struct ShmOptions {
+  /// @brief Pre-fault every page when mapping (MAP_POPULATE)
+  bool populate_{false};
+  /// @brief Lock the pages in RAM (mlock), so they are never paged out
+  bool lock_{false};
+  /// @brief Directory on a hugetlbfs mount to place the segment in, so it is
+  /// backed by huge pages. Empty to use POSIX shared memory.
+  std::string hugepage_dir_;
+};
+
+/// @brief Maps the named segment with at least size bytes, creating it if it
+/// does not exist yet. An empty region if a huge page segment could not be
+/// sized.
+bip::mapped_region MapSegment(const std::string &name, uint64_t size,
+                              const ShmOptions &options);
+
+/// @brief Removes a segment created by MapSegment.
+void RemoveSegment(const std::string &name, const ShmOptions &options);
+
+/// @brief Bumped whenever the layout of a channel segment changes, so a
+/// process never attaches to a segment left behind by an incompatible build.
+constexpr uint32_t kSegmentVersion = 2;
+
+/// @brief First bytes of every channel segment. Segments outlive the
+/// processes using them: nobody removes a segment on exit, so a restarted
+/// process attaches to the same segment again and carries on from the
+/// cursors stored in it. Not over-aligned, so that a boost segment manager
+/// can place it too.
+struct SegmentHeader {
+  static constexpr uint32_t kMagic = 0x43544348;
+  static constexpr uint32_t kReady = 2;
+
+  std::atomic<uint32_t> state_;
+  uint32_t magic_;
+  uint32_t version_;
+  /// @brief Capacity or slot count the segment was created with
+  uint64_t size_;
+  /// @brief Bumped every time a producer attaches
+  std::atomic<uint32_t> generation_;
+  std::atomic<int32_t> producer_pid_;
+  /// @brief Last consumer that attached
+  std::atomic<int32_t> consumer_pid_;
+};
+
+/// @brief Initializes the header of a fresh segment, or waits until the
+/// process that created it has done so.
+///
+/// @return False if the segment was created with another layout version.
+bool InitSegmentHeader(SegmentHeader &header, uint64_t size);
+
+/// @brief Whether pid names a running process.
+bool ProcessAlive(int32_t pid);
+
+/// @brief Registers the calling process as the producer of a segment and
+/// bumps its generation.
+///
+/// @return False while another live process is the producer.
+bool AttachProducer(SegmentHeader &header);
+
+/// @brief Registers the calling process as the latest consumer of a segment.
+void AttachConsumer(SegmentHeader &header);
+
+/// @brief Clears the producer or consumer pid if it is still the calling
+/// process.
+void DetachProducer(SegmentHeader &header);
+void DetachConsumer(SegmentHeader &header);
+
+} // namespace ctptrader::util
\ No newline at end of file
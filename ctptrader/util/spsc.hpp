@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <span>
+#include <string>
+
+#include <util/channel.hpp>
+#include <util/shm.hpp>
+#include <util/stats.hpp>
+
+namespace ctptrader::util {
+
+/// @brief Distance between the producer and the consumer index. Two lines,
+/// so the adjacent line prefetcher does not pull the other side's index in.
+constexpr size_t kIndexAlign = 128;
+
+/// @brief Layout of a padded single producer single consumer queue in shared
+/// memory. Everything is placed by hand, so the layout is the same for every
+/// compiler and library version on both sides of the channel.
+template <typename T, size_t Size> struct ShmPaddedQueue {
+  static_assert(std::has_single_bit(Size), "Size must be a power of two");
+  static_assert(std::is_trivially_copyable_v<T>);
+  alignas(kIndexAlign) SegmentHeader header_;
+  // Written by the producer only
+  alignas(kIndexAlign) std::atomic<uint64_t> write_idx_;
+  // Written by the consumer only
+  alignas(kIndexAlign) std::atomic<uint64_t> read_idx_;
+  alignas(kIndexAlign) ShmSignal signal_;
+  alignas(kIndexAlign) Stamped<T> slots_[Size];
+};
+
+/// @brief Maps a padded queue and waits until it is initialized.
+template <typename T, size_t Size> class ShmPaddedSegment {
+  using Queue = ShmPaddedQueue<T, Size>;
+
+public:
+  /// @param producer Whether this is the writing side.
+  ShmPaddedSegment(const std::string_view name, bool producer)
+      : name_(name)
+      , producer_(producer) {
+    Map();
+    // The slots are laid out for Size, there is no adopting another size.
+    auto compatible = InitSegmentHeader(queue_->header_, Size) &&
+                      queue_->header_.size_ == Size;
+    if (!compatible && producer_) {
+      RemoveSegment(name_, {});
+      Map();
+      compatible = InitSegmentHeader(queue_->header_, Size);
+    }
+    if (compatible) {
+      ready_ = producer_ ? AttachProducer(queue_->header_)
+                         : (AttachConsumer(queue_->header_), true);
+    }
+  }
+  /// @brief Leaves the segment in place, so that either side can restart and
+  /// attach to it again.
+  ~ShmPaddedSegment() {
+    if (ready_) {
+      producer_ ? DetachProducer(queue_->header_)
+                : DetachConsumer(queue_->header_);
+    }
+  }
+
+  /// @brief False if the segment has an incompatible layout or size, or if
+  /// this is a producer and another live process is producing.
+  [[nodiscard]] bool Ready() const { return ready_; }
+
+  /// @brief Number of times a producer attached to the segment.
+  [[nodiscard]] uint32_t Generation() const {
+    return queue_->header_.generation_.load(std::memory_order_relaxed);
+  }
+
+protected:
+  static constexpr uint64_t kMask = Size - 1;
+
+  void Map() {
+    region_ = MapSegment(name_, sizeof(Queue), {});
+    queue_ = static_cast<Queue *>(region_.get_address());
+  }
+
+  const std::string name_;
+  const bool producer_;
+  bool ready_{false};
+  bip::mapped_region region_;
+  Queue *queue_;
+};
+
+/// @brief Consumer side of a padded queue. The producer index is cached and
+/// only reloaded once the cached value says the queue is empty, so a reader
+/// that keeps up touches the producer's line once per burst.
+template <typename T, size_t Size>
+class ShmPaddedReader : ShmPaddedSegment<T, Size> {
+public:
+  explicit ShmPaddedReader(const std::string_view name)
+      : ShmPaddedSegment<T, Size>(name, false)
+      , read_idx_(this->queue_->read_idx_.load(std::memory_order_relaxed))
+      , write_idx_(read_idx_)
+      , stats_(name, false) {}
+
+  using ShmPaddedSegment<T, Size>::Ready;
+  using ShmPaddedSegment<T, Size>::Generation;
+
+  bool Read(T &value) {
+    if (read_idx_ == write_idx_) {
+      write_idx_ = this->queue_->write_idx_.load(std::memory_order_acquire);
+      if (read_idx_ == write_idx_) {
+        return false;
+      }
+    }
+    const auto &slot = this->queue_->slots_[read_idx_ & this->kMask];
+    value = slot.value_;
+    stats_.OnRead(slot.tsc_);
+    this->queue_->read_idx_.store(++read_idx_, std::memory_order_release);
+    waiter_.Reset();
+    return true;
+  }
+
+  /// @brief Pops up to out.size() values with a single update of the shared
+  /// read index.
+  ///
+  /// @return The number of values read.
+  size_t ReadBatch(std::span<T> out) {
+    if (write_idx_ - read_idx_ < out.size()) {
+      write_idx_ = this->queue_->write_idx_.load(std::memory_order_acquire);
+    }
+    const auto n = std::min<uint64_t>(write_idx_ - read_idx_, out.size());
+    if (n == 0) {
+      return 0;
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+      const auto &slot = this->queue_->slots_[(read_idx_ + i) & this->kMask];
+      out[i] = slot.value_;
+      stats_.OnRead(slot.tsc_);
+    }
+    read_idx_ += n;
+    this->queue_->read_idx_.store(read_idx_, std::memory_order_release);
+    waiter_.Reset();
+    return n;
+  }
+
+  [[nodiscard]] bool Empty() const {
+    return read_idx_ ==
+           this->queue_->write_idx_.load(std::memory_order_acquire);
+  }
+
+  void SetWaitPolicy(WaitPolicy policy,
+                     uint32_t spins = Waiter::kDefaultSpins) {
+    waiter_.SetPolicy(this->queue_->signal_, policy, spins);
+  }
+
+  /// @brief Backs off after a failed Read according to the wait policy.
+  void Wait() {
+    waiter_.Wait(this->queue_->signal_, [this]() { return Empty(); });
+  }
+
+private:
+  uint64_t read_idx_;
+  uint64_t write_idx_; // cached producer index
+  Waiter waiter_;
+  StatsBlock stats_;
+};
+
+/// @brief Producer side of a padded queue. The consumer index is cached and
+/// only reloaded once the cached value says the queue is full.
+template <typename T, size_t Size>
+class ShmPaddedWriter : ShmPaddedSegment<T, Size> {
+public:
+  explicit ShmPaddedWriter(const std::string_view name)
+      : ShmPaddedSegment<T, Size>(name, true)
+      , write_idx_(this->queue_->write_idx_.load(std::memory_order_relaxed))
+      , read_idx_(this->queue_->read_idx_.load(std::memory_order_acquire))
+      , stats_(name, true) {}
+
+  using ShmPaddedSegment<T, Size>::Ready;
+  using ShmPaddedSegment<T, Size>::Generation;
+
+  bool Write(const T &value) {
+    if (write_idx_ - read_idx_ == Size) {
+      read_idx_ = this->queue_->read_idx_.load(std::memory_order_acquire);
+      if (write_idx_ - read_idx_ == Size) {
+        stats_.OnDrop();
+        return false;
+      }
+    }
+    auto &slot = this->queue_->slots_[write_idx_ & this->kMask];
+    slot.tsc_ = ReadTsc();
+    slot.value_ = value;
+    this->queue_->write_idx_.store(++write_idx_, std::memory_order_release);
+    stats_.OnWrite(write_idx_ - read_idx_);
+    Notify(this->queue_->signal_);
+    return true;
+  }
+
+private:
+  uint64_t write_idx_;
+  uint64_t read_idx_; // cached consumer index
+  StatsBlock stats_;
+};
+
+} // namespace ctptrader::util
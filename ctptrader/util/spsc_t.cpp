@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <thread>
+
+#include <util/spsc.hpp>
+
+namespace {
+
+using namespace ctptrader::util;
+
+struct ScopedSegment {
+  explicit ScopedSegment(const std::string &name) : name_(name) {
+    RemoveSegment(name_, {});
+  }
+  ~ScopedSegment() { RemoveSegment(name_, {}); }
+
+  const std::string name_;
+};
+
+TEST(ShmPaddedQueueTest, Layout) {
+  using Queue = ShmPaddedQueue<int, 16>;
+  ASSERT_EQ(offsetof(Queue, write_idx_) - offsetof(Queue, header_),
+            kIndexAlign);
+  ASSERT_EQ(offsetof(Queue, read_idx_) - offsetof(Queue, write_idx_),
+            kIndexAlign);
+}
+
+TEST(ShmPaddedQueueTest, ReadWrite) {
+  constexpr size_t kQueueSize = 16;
+  constexpr char kQueueName[] = "test_padded";
+  ScopedSegment segment(kQueueName);
+
+  ShmPaddedWriter<int, kQueueSize> writer(kQueueName);
+  ShmPaddedReader<int, kQueueSize> reader(kQueueName);
+  int value;
+  ASSERT_FALSE(reader.Read(value));
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 16; ++i) {
+      ASSERT_TRUE(writer.Write(round * 16 + i));
+    }
+    ASSERT_FALSE(writer.Write(-1));
+    for (int i = 0; i < 6; ++i) {
+      ASSERT_TRUE(reader.Read(value));
+      ASSERT_EQ(value, round * 16 + i);
+    }
+    std::array<int, 16> batch{};
+    ASSERT_EQ(reader.ReadBatch(batch), 10);
+    ASSERT_EQ(batch[9], round * 16 + 15);
+    ASSERT_TRUE(reader.Empty());
+  }
+}
+
+TEST(ShmPaddedQueueTest, Threads) {
+  constexpr size_t kQueueSize = 64;
+  constexpr int kNumMessages = 100000;
+  constexpr char kQueueName[] = "test_padded_threads";
+  ScopedSegment segment(kQueueName);
+
+  ShmPaddedWriter<int, kQueueSize> writer(kQueueName);
+  ShmPaddedReader<int, kQueueSize> reader(kQueueName);
+  reader.SetWaitPolicy(WaitPolicy::SpinFutex, 16);
+  std::thread producer([&writer]() {
+    for (int i = 0; i < kNumMessages; ++i) {
+      while (!writer.Write(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  for (int i = 0; i < kNumMessages; ++i) {
+    int value;
+    while (!reader.Read(value)) {
+      reader.Wait();
+    }
+    ASSERT_EQ(value, i);
+  }
+  producer.join();
+}
+
+} // namespace
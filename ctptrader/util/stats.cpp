@@ -0,0 +1,86 @@
+#include <util/stats.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <new>
+
+#include <unistd.h>
+
+namespace ctptrader::util {
+
+namespace {
+
+std::string EndpointName(std::string_view channel, bool writer) {
+  RemoveDeadReaderStats(channel);
+  if (writer) {
+    return StatsPrefix(channel) + "tx";
+  }
+  // One block per reader, a broadcast channel has several in one process.
+  static std::atomic<int> readers{0};
+  return StatsPrefix(channel) + "rx." + std::to_string(getpid()) + "." +
+         std::to_string(readers.fetch_add(1));
+}
+
+} // namespace
+
+double TscPerNs() {
+  static const double ratio = []() {
+    timespec t0{}, t1{};
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    const auto c0 = ReadTsc();
+    long elapsed = 0;
+    while (elapsed < 10'000'000L) {
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      elapsed = (t1.tv_sec - t0.tv_sec) * 1'000'000'000L +
+                (t1.tv_nsec - t0.tv_nsec);
+    }
+    return static_cast<double>(ReadTsc() - c0) / elapsed;
+  }();
+  return ratio;
+}
+
+std::string StatsPrefix(std::string_view channel) {
+  return std::string(channel) + ".stats.";
+}
+
+void RemoveDeadReaderStats(std::string_view channel) {
+  const auto prefix = StatsPrefix(channel) + "rx.";
+  std::error_code ec;
+  for (const auto &entry :
+       std::filesystem::directory_iterator("/dev/shm", ec)) {
+    const auto name = entry.path().filename().string();
+    if (name.rfind(prefix, 0) != 0) {
+      continue;
+    }
+    // <channel>.stats.rx.<pid>.<n>
+    const auto pid = std::atoi(name.c_str() + prefix.size());
+    if (pid > 0 && !ProcessAlive(pid)) {
+      RemoveSegment(name, {});
+    }
+  }
+}
+
+StatsBlock::StatsBlock(std::string_view channel, bool writer, bool attached)
+    : name_(attached ? EndpointName(channel, writer) : std::string())
+    , region_(attached ? MapSegment(name_, sizeof(ChannelStats), {})
+                       : bip::mapped_region())
+    , stats_(attached ? static_cast<ChannelStats *>(region_.get_address())
+                      : &unattached_) {
+  // A restarted writer carries on with the counters of the one before it.
+  if (!attached || !writer ||
+      stats_->magic_.load(std::memory_order_acquire) != ChannelStats::kMagic) {
+    stats_ = new (stats_) ChannelStats{};
+  }
+  stats_->writer_ = writer;
+  stats_->pid_ = getpid();
+  stats_->tsc_per_ns_ = TscPerNs();
+  stats_->magic_.store(ChannelStats::kMagic, std::memory_order_release);
+}
+
+StatsBlock::~StatsBlock() {
+  if (!name_.empty() && stats_->pid_ == getpid()) {
+    RemoveSegment(name_, {});
+  }
+}
+
+} // namespace ctptrader::util
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <util/shm.hpp>
+
+namespace ctptrader::util {
+
+/// @brief Reads the cpu time stamp counter, or the monotonic clock in
+/// nanoseconds where there is none. The counter is invariant and synchronized
+/// across cores on current x86 parts, so stamps compare across processes.
+inline uint64_t ReadTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+#endif
+}
+
+/// @brief ReadTsc ticks per nanosecond, measured once per process.
+double TscPerNs();
+
+/// @brief Counters of one channel endpoint, placed in their own shared memory
+/// segment. Every block has a single updating thread, so counters are bumped
+/// with relaxed loads and stores instead of locked instructions, and a
+/// monitor mapping the block never touches the channel itself.
+struct ChannelStats {
+  static constexpr uint32_t kMagic = 0x43535432;
+  static constexpr size_t kLatencyBuckets = 64;
+
+  std::atomic<uint32_t> magic_;
+  /// @brief 1 for the writer of the channel, 0 for a reader
+  uint32_t writer_;
+  /// @brief Process of the endpoint
+  int32_t pid_;
+  double tsc_per_ns_;
+  /// @brief Messages written or read
+  std::atomic<uint64_t> messages_;
+  /// @brief Failed writes, or messages a reader lost to overruns
+  std::atomic<uint64_t> drops_;
+  /// @brief Deepest backlog seen, in slots for typed queues and bytes for
+  /// framed rings
+  std::atomic<uint64_t> high_water_;
+  /// @brief Bucket i counts enqueue-to-dequeue latencies in [2^(i-1), 2^i)
+  /// ticks, bucket 0 counts zero
+  std::atomic<uint64_t> latency_[kLatencyBuckets];
+};
+
+/// @brief Prefix of the names of all stats segments of a channel.
+std::string StatsPrefix(std::string_view channel);
+
+/// @brief Removes the reader stats segments of a channel left behind by
+/// processes that are gone.
+void RemoveDeadReaderStats(std::string_view channel);
+
+/// @brief The stats segment of one channel endpoint, removed again when the
+/// endpoint goes away. Segments of killed readers are removed by the next
+/// endpoint attaching to the channel.
+///
+/// The writer block has a fixed name and outlives a restarted producer: a new
+/// producer keeps counting in the block it finds, and only the process that
+/// last attached to it removes it.
+class StatsBlock {
+public:
+  /// @param attached False for an endpoint that was refused by its channel,
+  /// which then counts into private memory and leaves the segment alone.
+  StatsBlock(std::string_view channel, bool writer, bool attached = true);
+  ~StatsBlock();
+  StatsBlock(const StatsBlock &) = delete;
+  StatsBlock &operator=(const StatsBlock &) = delete;
+
+  void OnWrite(uint64_t depth) {
+    Add(stats_->messages_, 1);
+    Max(stats_->high_water_, depth);
+  }
+
+  void OnDrop(uint64_t count = 1) { Add(stats_->drops_, count); }
+
+  /// @param tsc The ReadTsc stamp the writer put into the message.
+  void OnRead(uint64_t tsc) {
+    Add(stats_->messages_, 1);
+    const auto now = ReadTsc();
+    const auto bucket = now > tsc ? std::bit_width(now - tsc) : 0;
+    Add(stats_->latency_[bucket < ChannelStats::kLatencyBuckets
+                             ? bucket
+                             : ChannelStats::kLatencyBuckets - 1],
+        1);
+  }
+
+  void OnDepth(uint64_t depth) { Max(stats_->high_water_, depth); }
+
+  [[nodiscard]] const ChannelStats &Get() const { return *stats_; }
+
+  [[nodiscard]] const std::string &Name() const { return name_; }
+
+private:
+  static void Add(std::atomic<uint64_t> &counter, uint64_t n) {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  static void Max(std::atomic<uint64_t> &counter, uint64_t value) {
+    if (value > counter.load(std::memory_order_relaxed)) {
+      counter.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  const std::string name_;
+  bip::mapped_region region_;
+  ChannelStats unattached_{};
+  ChannelStats *stats_;
+};
+
+} // namespace ctptrader::util
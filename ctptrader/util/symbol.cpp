@@ -0,0 +1,34 @@
+#include <util/symbol.hpp>
+
+#include <algorithm>
+#include <bit>
+
+namespace ctptrader::util {
+
+bool SymbolIndex::Build(std::span<const std::string_view> symbols) {
+  const auto size = std::bit_ceil(std::max<size_t>(symbols.size() * 4, 16));
+  keys_.assign(size, Key{});
+  ids_.assign(size, -1);
+  mask_ = size - 1;
+  shift_ = 64 - std::countr_zero(size);
+  count_ = 0;
+  for (const auto &symbol : symbols) {
+    if (symbol.empty() || symbol.size() > kMaxLength || Find(symbol) >= 0) {
+      keys_.clear();
+      ids_.clear();
+      count_ = 0;
+      return false;
+    }
+    Key key{};
+    std::memcpy(key.words_, symbol.data(), symbol.size());
+    auto i = Slot(key);
+    while (ids_[i] >= 0) {
+      i = (i + 1) & mask_;
+    }
+    keys_[i] = key;
+    ids_[i] = static_cast<int32_t>(count_++);
+  }
+  return true;
+}
+
+} // namespace ctptrader::util
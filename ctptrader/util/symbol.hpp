@@ -0,0 +1,109 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ctptrader::util {
+
+/// @brief Maps symbols of up to 31 characters to dense ids without
+/// allocating. A symbol is kept as a zero padded 32-byte key in an open
+/// addressing table that is at most a quarter full, so a lookup is a short
+/// copy, one hash and usually a single key compare.
+class SymbolIndex {
+public:
+  /// @brief Longest symbol, the size of a CTP instrument id field minus the
+  /// terminating zero
+  static constexpr size_t kMaxLength = 31;
+
+  /// @brief Rebuilds the index, symbols[i] gets id i.
+  ///
+  /// @return False if a symbol is empty, longer than kMaxLength or repeated.
+  bool Build(std::span<const std::string_view> symbols);
+
+  /// @brief Looks up a symbol in a fixed size, zero terminated field such as
+  /// a CTP instrument id. The whole field is copied at once and cut at the
+  /// first zero in registers, which is several times faster than a strlen and
+  /// a copy of variable size.
+  ///
+  /// @return The id of the symbol, or -1 if it is unknown.
+  template <size_t N>
+  [[nodiscard]] int32_t Find(const char (&symbol)[N]) const {
+    static_assert(N <= sizeof(Key));
+    Key key{};
+    std::memcpy(key.words_, symbol, N);
+    Terminate(key);
+    return Lookup(key);
+  }
+
+  /// @return The id of the symbol, or -1 if it is unknown.
+  [[nodiscard]] int32_t Find(std::string_view symbol) const {
+    if (symbol.size() > kMaxLength) {
+      return -1;
+    }
+    Key key{};
+    std::memcpy(key.words_, symbol.data(), symbol.size());
+    return Lookup(key);
+  }
+
+  [[nodiscard]] size_t Count() const { return count_; }
+
+private:
+  struct alignas(32) Key {
+    uint64_t words_[4];
+
+    bool operator==(const Key &) const = default;
+  };
+
+  /// @brief Clears everything from the first zero byte on.
+  static void Terminate(Key &key) {
+    constexpr uint64_t kLow = 0x0101010101010101ULL;
+    constexpr uint64_t kHigh = 0x8080808080808080ULL;
+    bool done = false;
+    for (auto &word : key.words_) {
+      if (done) {
+        word = 0;
+        continue;
+      }
+      // The lowest flagged byte is exactly the first zero byte.
+      if (const auto zero = (word - kLow) & ~word & kHigh; zero != 0) {
+        const auto bits = std::countr_zero(zero) - 7;
+        word &= bits == 0 ? 0 : ~uint64_t{0} >> (64 - bits);
+        done = true;
+      }
+    }
+  }
+
+  [[nodiscard]] int32_t Lookup(const Key &key) const {
+    if (key.words_[0] == 0 || ids_.empty()) {
+      return -1;
+    }
+    for (auto i = Slot(key);; i = (i + 1) & mask_) {
+      if (ids_[i] < 0 || keys_[i] == key) {
+        return ids_[i];
+      }
+    }
+  }
+
+  /// @brief Home slot of a key. Symbols differ in their last characters and
+  /// a product only carries into the high bits, so the slot is taken from the
+  /// top of the mixed hash.
+  [[nodiscard]] uint64_t Slot(const Key &key) const {
+    auto h = key.words_[0] * 0x9e3779b97f4a7c15ULL;
+    h ^= key.words_[1] * 0xc2b2ae3d27d4eb4fULL;
+    h ^= key.words_[2] * 0x165667b19e3779f9ULL;
+    h ^= key.words_[3] * 0x27d4eb2f165667c5ULL;
+    return ((h ^ (h >> 29)) * 0x9e3779b97f4a7c15ULL) >> shift_;
+  }
+
+  std::vector<Key> keys_;
+  std::vector<int32_t> ids_;
+  uint64_t mask_{0};
+  uint32_t shift_{63};
+  size_t count_{0};
+};
+
+} // namespace ctptrader::util
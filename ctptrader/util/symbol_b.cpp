@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <util/symbol.hpp>
+
+namespace {
+
+using namespace ctptrader::util;
+
+/// @brief Roughly the listed futures of the Chinese exchanges, about a
+/// thousand symbols.
+std::vector<std::string> Universe() {
+  static const char *kProducts[] = {
+      "cu", "al", "zn", "pb", "ni", "sn", "au", "ag", "rb", "wr", "hc", "ss",
+      "fu", "bu", "ru", "br", "sp", "ao", "sc", "lu", "nr", "bc", "ec", "a",
+      "b",  "c",  "cs", "m",  "y",  "p",  "fb", "bb", "jd", "rr", "lh", "l",
+      "v",  "pp", "j",  "jm", "i",  "eg", "eb", "pg", "WH", "PM", "CF", "CY",
+      "SR", "OI", "RI", "RS", "RM", "JR", "LR", "AP", "CJ", "PK", "TA", "MA",
+      "FG", "SF", "SM", "ZC", "UR", "SA", "PF", "PX", "SH", "IF", "IC", "IH",
+      "IM", "TS", "TF", "T",  "TL", "si", "lc"};
+  std::vector<std::string> names;
+  for (const auto *product : kProducts) {
+    for (int month = 1; month <= 12; ++month) {
+      names.push_back(product + std::to_string(2400 + month));
+    }
+  }
+  return names;
+}
+
+/// @brief A CTP instrument id field
+struct Field {
+  char symbol_[31];
+};
+
+/// @brief Symbols as they arrive from CTP: fixed size fields in random order.
+std::vector<Field> Fields(const std::vector<std::string> &names) {
+  std::vector<Field> fields;
+  for (int i = 0; i < 8; ++i) {
+    for (const auto &name : names) {
+      Field field{};
+      std::memcpy(field.symbol_, name.data(), name.size());
+      fields.push_back(field);
+    }
+  }
+  std::shuffle(fields.begin(), fields.end(), std::mt19937(42));
+  return fields;
+}
+
+void SymbolIndexFind(benchmark::State &state) {
+  const auto names = Universe();
+  const std::vector<std::string_view> symbols(names.begin(), names.end());
+  SymbolIndex index;
+  index.Build(symbols);
+  const auto fields = Fields(names);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(index.Find(fields[i].symbol_));
+    i = i + 1 == fields.size() ? 0 : i + 1;
+  }
+  state.counters["symbols"] = static_cast<double>(names.size());
+}
+
+/// @brief What RefCenter::GetID does: a std::string per lookup and a hash map.
+void StringMapFind(benchmark::State &state) {
+  const auto names = Universe();
+  std::unordered_map<std::string, int> map;
+  for (size_t i = 0; i < names.size(); ++i) {
+    map[names[i]] = static_cast<int>(i);
+  }
+  const auto fields = Fields(names);
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto it = map.find(std::string(fields[i].symbol_));
+    benchmark::DoNotOptimize(it == map.end() ? -1 : it->second);
+    i = i + 1 == fields.size() ? 0 : i + 1;
+  }
+  state.counters["symbols"] = static_cast<double>(names.size());
+}
+
+} // namespace
+
+BENCHMARK(SymbolIndexFind);
+BENCHMARK(StringMapFind);
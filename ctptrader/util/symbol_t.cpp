@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <util/symbol.hpp>
+
+namespace {
+
+using namespace ctptrader::util;
+
+TEST(SymbolIndexTest, Find) {
+  const std::array<std::string_view, 4> symbols{"cu2311", "cu2312", "IF2312",
+                                                "m2401-C-3900"};
+  SymbolIndex index;
+  ASSERT_EQ(index.Find("cu2311"), -1);
+  ASSERT_TRUE(index.Build(symbols));
+  ASSERT_EQ(index.Count(), 4);
+  for (int32_t i = 0; i < 4; ++i) {
+    ASSERT_EQ(index.Find(symbols[i]), i);
+  }
+  ASSERT_EQ(index.Find("cu231"), -1);
+  ASSERT_EQ(index.Find("cu23111"), -1);
+  ASSERT_EQ(index.Find(""), -1);
+
+  // A CTP field is a fixed size array with a terminating zero.
+  char field[31] = {};
+  std::memcpy(field, "IF2312", 6);
+  ASSERT_EQ(index.Find(field), 2);
+}
+
+TEST(SymbolIndexTest, Invalid) {
+  SymbolIndex index;
+  const std::array<std::string_view, 2> repeated{"cu2311", "cu2311"};
+  ASSERT_FALSE(index.Build(repeated));
+  ASSERT_EQ(index.Find("cu2311"), -1);
+  const std::string longest(SymbolIndex::kMaxLength, 'x');
+  const std::string too_long(SymbolIndex::kMaxLength + 1, 'x');
+  const std::array<std::string_view, 1> ok{longest};
+  ASSERT_TRUE(index.Build(ok));
+  ASSERT_EQ(index.Find(longest), 0);
+  char field[32] = {};
+  std::memcpy(field, longest.data(), longest.size());
+  ASSERT_EQ(index.Find(field), 0);
+  const std::array<std::string_view, 1> bad{too_long};
+  ASSERT_FALSE(index.Build(bad));
+}
+
+TEST(SymbolIndexTest, Universe) {
+  std::vector<std::string> names;
+  for (int product = 0; product < 100; ++product) {
+    for (int month = 1; month <= 12; ++month) {
+      names.push_back(std::string{char('a' + product % 26),
+                                  char('a' + product / 26)} +
+                      std::to_string(2400 + month));
+    }
+  }
+  const std::vector<std::string_view> symbols(names.begin(), names.end());
+  SymbolIndex index;
+  ASSERT_TRUE(index.Build(symbols));
+  for (size_t i = 0; i < names.size(); ++i) {
+    char field[31];
+    std::memset(field, 'x', sizeof(field));
+    std::memcpy(field, names[i].c_str(), names[i].size() + 1);
+    ASSERT_EQ(index.Find(names[i]), static_cast<int32_t>(i));
+    ASSERT_EQ(index.Find(field), static_cast<int32_t>(i));
+  }
+}
+
+} // namespace
@@ -0,0 +1,111 @@
+#include <util/thread.hpp>
+
+#include <charconv>
+#include <fstream>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace ctptrader::util {
+
+namespace {
+
+bool ParseInt(std::string_view s, int &value) {
+  const auto *end = s.data() + s.size();
+  const auto [ptr, ec] = std::from_chars(s.data(), end, value);
+  return ec == std::errc() && ptr == end && value >= 0;
+}
+
+} // namespace
+
+std::vector<int> ParseCpuList(std::string_view list) {
+  std::vector<int> cpus;
+  while (!list.empty() && (list.back() == '\n' || list.back() == ' ')) {
+    list.remove_suffix(1);
+  }
+  while (!list.empty()) {
+    const auto comma = list.find(',');
+    const auto range = list.substr(0, comma);
+    list = comma == std::string_view::npos ? "" : list.substr(comma + 1);
+    const auto dash = range.find('-');
+    int first = 0;
+    int last = 0;
+    if (!ParseInt(range.substr(0, dash), first) ||
+        (dash != std::string_view::npos &&
+         !ParseInt(range.substr(dash + 1), last))) {
+      return {};
+    }
+    if (dash == std::string_view::npos) {
+      last = first;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<int> IsolatedCpus() {
+  std::ifstream file("/sys/devices/system/cpu/isolated");
+  std::string list;
+  std::getline(file, list);
+  return ParseCpuList(list);
+}
+
+std::vector<int> AllowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    return cpus;
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+bool PinThread(int cpu) {
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+bool SetFifoPriority(int priority) {
+  sched_param param{};
+  param.sched_priority = priority;
+  return sched_setscheduler(0, priority > 0 ? SCHED_FIFO : SCHED_OTHER,
+                            &param) == 0;
+}
+
+void NameThread(const std::string &name) {
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+}
+
+std::string DescribeThread() {
+  std::string s = "tid " + std::to_string(gettid());
+  s += " on cpu " + std::to_string(sched_getcpu());
+  s += ", affinity ";
+  const auto cpus = AllowedCpus();
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    s += (i == 0 ? "" : ",");
+    s += std::to_string(cpus[i]);
+  }
+  sched_param param{};
+  sched_getparam(0, &param);
+  if (sched_getscheduler(0) == SCHED_FIFO) {
+    s += ", SCHED_FIFO " + std::to_string(param.sched_priority);
+  } else {
+    s += ", SCHED_OTHER";
+  }
+  return s;
+}
+
+} // namespace ctptrader::util
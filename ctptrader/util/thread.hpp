@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ctptrader::util {
+
+/// @brief Where and how a hot thread runs.
+struct ThreadOptions {
+  /// @brief Leave the affinity alone
+  static constexpr int kAnyCpu = -1;
+  /// @brief Pick an isolated core nobody in this process has taken yet
+  static constexpr int kIsolatedCpu = -2;
+
+  /// @brief Thread name, shown by top and in the startup report
+  std::string name_;
+  /// @brief Core to pin the thread to, kAnyCpu or kIsolatedCpu
+  int cpu_{kAnyCpu};
+  /// @brief SCHED_FIFO priority from 1 to 99, 0 keeps SCHED_OTHER
+  int priority_{0};
+};
+
+/// @brief Parses a kernel cpu list such as "2-5,7".
+///
+/// @return The cores in the list, empty if the list is malformed.
+std::vector<int> ParseCpuList(std::string_view list);
+
+/// @brief Cores taken out of the scheduler with isolcpus, from
+/// /sys/devices/system/cpu/isolated.
+std::vector<int> IsolatedCpus();
+
+/// @brief Cores the calling thread may run on.
+std::vector<int> AllowedCpus();
+
+/// @brief Pins the calling thread to a single core.
+///
+/// @return False if the core does not exist or is not allowed.
+bool PinThread(int cpu);
+
+/// @brief Runs the calling thread under SCHED_FIFO with the given priority,
+/// or back under SCHED_OTHER for 0. Needs CAP_SYS_NICE or an rtprio limit.
+///
+/// @return False if the policy could not be set.
+bool SetFifoPriority(int priority);
+
+/// @brief Sets the name of the calling thread, cut to 15 characters.
+void NameThread(const std::string &name);
+
+/// @brief Where the calling thread landed: its tid, the core it runs on, its
+/// affinity and scheduling policy.
+std::string DescribeThread();
+
+} // namespace ctptrader::util
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include <sched.h>
+
+#include <util/thread.hpp>
+
+namespace {
+
+using namespace ctptrader::util;
+
+TEST(ThreadTest, ParseCpuList) {
+  EXPECT_EQ(ParseCpuList("2-5,7\n"), (std::vector<int>{2, 3, 4, 5, 7}));
+  EXPECT_EQ(ParseCpuList("0"), (std::vector<int>{0}));
+  EXPECT_TRUE(ParseCpuList("").empty());
+  EXPECT_TRUE(ParseCpuList("1-x").empty());
+  EXPECT_TRUE(ParseCpuList("-1").empty());
+}
+
+TEST(ThreadTest, Pin) {
+  // A separate thread, so the affinity of the test runner is left alone
+  std::thread([]() {
+    const auto allowed = AllowedCpus();
+    ASSERT_FALSE(allowed.empty());
+    ASSERT_TRUE(PinThread(allowed.back()));
+    EXPECT_EQ(AllowedCpus(), (std::vector<int>{allowed.back()}));
+    EXPECT_EQ(sched_getcpu(), allowed.back());
+    EXPECT_FALSE(PinThread(-1));
+    EXPECT_FALSE(PinThread(CPU_SETSIZE));
+    EXPECT_NE(DescribeThread().find("affinity " +
+                                    std::to_string(allowed.back())),
+              std::string::npos);
+  }).join();
+}
+
+TEST(ThreadTest, OtherPolicy) {
+  std::thread([]() {
+    EXPECT_TRUE(SetFifoPriority(0));
+    EXPECT_NE(DescribeThread().find("SCHED_OTHER"), std::string::npos);
+  }).join();
+}
+
+} // namespace
@@ -0,0 +1,693 @@
+#include <util/tickfile.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ctptrader::util {
+
+namespace {
+
+constexpr int64_t kPow10[] = {1,         10,         100,      1000,
+                              10000,     100000,     1000000,  10000000,
+                              100000000, 1000000000};
+
+constexpr uint64_t ZigZag(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+constexpr int64_t UnZigZag(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+constexpr int64_t Nanos(const base::Timestamp &ts) {
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+void SetNanos(base::Timestamp &ts, int64_t ns) {
+  ts.tv_sec = ns / 1000000000L;
+  ts.tv_nsec = ns % 1000000000L;
+}
+
+/// @brief Rows of a block. Every column of a block is stored as the
+/// smallest zigzag difference of the block and the rest of them bit packed,
+/// so a block decodes without branches and its rows stay in L1.
+constexpr size_t kBlockRows = 64;
+
+/// @brief Widest bit packed value read with one 8 byte load, wider ones are
+/// stored in 64 bits.
+constexpr int kMaxPackedWidth = 56;
+
+/// @brief Zero bytes after the columns of a chunk, for the 8 byte loads.
+constexpr size_t kChunkPadding = 8;
+
+/// @brief Most columns in a chunk
+constexpr uint32_t kMaxColumns = 32;
+
+/// @brief Decimal fixed point of a price column. Prices are decoded as
+/// ticks * step_ / 10^digits_, which is exact for every decimal tick size.
+struct Scale {
+  int64_t step_;
+  int digits_;
+};
+
+Scale ScaleOf(base::Price tick_size) {
+  for (int digits = 0; digits < 7; ++digits) {
+    const auto scaled = tick_size * static_cast<double>(kPow10[digits]);
+    if (std::abs(scaled - std::round(scaled)) < 1e-9 * scaled &&
+        std::round(scaled) >= 1) {
+      return {std::llround(scaled), digits};
+    }
+  }
+  // No decimal tick size, prices are kept as they are
+  return {0, 0};
+}
+
+/// @brief Cents, the scale of turnover
+constexpr Scale kMoneyScale{1, 2};
+/// @brief Whole numbers kept in doubles, open interest
+constexpr Scale kCountScale{1, 0};
+
+/// @brief Encodes the columns of a chunk, see Columns. The chunk starts with
+/// the number of columns and their offsets.
+template <typename Row> class Encoder {
+public:
+  Encoder(const std::vector<Row> &rows, Scale price)
+      : rows_(rows)
+      , price_(price) {}
+
+  template <typename Get, typename Set> void Int(Get get, Set) {
+    int digits = 0;
+    while (digits + 1 < static_cast<int>(std::size(kPow10)) &&
+           std::all_of(rows_.begin(), rows_.end(), [&](const Row &row) {
+             return get(row) % kPow10[digits + 1] == 0;
+           })) {
+      ++digits;
+    }
+    Blocks(static_cast<uint8_t>(digits), [&](const Row &row, double &) {
+      return std::optional<int64_t>(get(row) / kPow10[digits]);
+    });
+  }
+
+  template <typename Get, typename Set> void Price(Get get, Set) {
+    Double(get, price_);
+  }
+
+  template <typename Get, typename Set> void Money(Get get, Set) {
+    Double(get, kMoneyScale);
+  }
+
+  template <typename Get, typename Set> void Count(Get get, Set) {
+    Double(get, kCountScale);
+  }
+
+  /// @brief Writes the offset table, the columns and the padding to out.
+  void Finish(std::vector<uint8_t> &out) const {
+    const auto columns = static_cast<uint32_t>(offsets_.size());
+    Append(out, columns);
+    for (const auto offset : offsets_) {
+      Append(out, offset);
+    }
+    out.insert(out.end(), body_.begin(), body_.end());
+    out.resize(out.size() + kChunkPadding);
+  }
+
+private:
+  template <typename T> static void Append(std::vector<uint8_t> &out, T v) {
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&v);
+    out.insert(out.end(), bytes, bytes + sizeof(v));
+  }
+
+  /// @brief Doubles that are whole steps go as steps, the others as they
+  /// are.
+  template <typename Get> void Double(Get get, Scale scale) {
+    Blocks(0, [&](const Row &row, double &raw) {
+      raw = get(row);
+      int64_t steps = 0;
+      return ToSteps(raw, scale, steps) ? std::optional<int64_t>(steps)
+                                        : std::nullopt;
+    });
+  }
+
+  static bool ToSteps(double v, Scale scale, int64_t &steps) {
+    // Differences of up to 2^61 steps fit a zigzag value
+    constexpr double kLimit = 1e17;
+    if (scale.step_ == 0 || !(std::abs(v) < kLimit)) {
+      return false;
+    }
+    // Only values the decoder gives back bit for bit are stored as steps
+    const auto step = static_cast<double>(scale.step_);
+    const auto div = static_cast<double>(kPow10[scale.digits_]);
+    steps = std::llround(v * div / step);
+    return static_cast<double>(steps) * step / div == v;
+  }
+
+  /// @brief Writes a column: the header, then per block the smallest zigzag
+  /// difference, the bit width and the number of exceptions, the packed
+  /// differences and the exceptions, rows kept as raw doubles.
+  template <typename F> void Blocks(uint8_t header, F value) {
+    offsets_.push_back(static_cast<uint32_t>(body_.size()));
+    body_.push_back(header);
+    int64_t units = 0;
+    for (size_t begin = 0; begin < rows_.size(); begin += kBlockRows) {
+      const auto n = std::min(kBlockRows, rows_.size() - begin);
+      std::array<uint64_t, kBlockRows> zigzags{};
+      std::array<double, kBlockRows> raws{};
+      std::array<uint8_t, kBlockRows> raw_rows{};
+      size_t exceptions = 0;
+      for (size_t i = 0; i < n; ++i) {
+        double raw = 0;
+        if (const auto v = value(rows_[begin + i], raw)) {
+          zigzags[i] = ZigZag(*v - units);
+          units = *v;
+        } else {
+          // The difference is 0, the decoder puts the raw value over it
+          raw_rows[exceptions] = static_cast<uint8_t>(i);
+          raws[exceptions++] = raw;
+        }
+      }
+      const auto base = *std::min_element(zigzags.begin(), zigzags.begin() + n);
+      uint64_t top = 0;
+      for (size_t i = 0; i < n; ++i) {
+        zigzags[i] -= base;
+        top = std::max(top, zigzags[i]);
+      }
+      auto width = std::bit_width(top);
+      if (width > kMaxPackedWidth) {
+        width = 64;
+      }
+      Varint(base);
+      body_.push_back(static_cast<uint8_t>(width));
+      body_.push_back(static_cast<uint8_t>(exceptions));
+      Pack(zigzags.data(), n, width);
+      for (size_t e = 0; e < exceptions; ++e) {
+        body_.push_back(raw_rows[e]);
+        Append(body_, raws[e]);
+      }
+    }
+  }
+
+  /// @brief Packs values of width bits, least significant bit first.
+  void Pack(const uint64_t *values, size_t n, int width) {
+    if (width == 64) {
+      for (size_t i = 0; i < n; ++i) {
+        Append(body_, values[i]);
+      }
+      return;
+    }
+    uint64_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < n && width > 0; ++i) {
+      acc |= values[i] << bits;
+      bits += width;
+      if (bits >= 64) {
+        Append(body_, acc);
+        bits -= 64;
+        acc = bits > 0 ? values[i] >> (width - bits) : 0;
+      }
+    }
+    for (; bits > 0; bits -= 8, acc >>= 8) {
+      body_.push_back(static_cast<uint8_t>(acc));
+    }
+  }
+
+  void Varint(uint64_t v) {
+    while (v >= 0x80) {
+      body_.push_back(static_cast<uint8_t>(v | 0x80));
+      v >>= 7;
+    }
+    body_.push_back(static_cast<uint8_t>(v));
+  }
+
+  const std::vector<Row> &rows_;
+  const Scale price_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint8_t> body_;
+};
+
+/// @brief Decodes the columns of a chunk straight into its rows, a block of
+/// rows at a time.
+template <typename Row> class Decoder {
+public:
+  Decoder(const uint8_t *p, const uint8_t *end, Row *rows, Scale price)
+      : rows_(rows)
+      , price_(price) {
+    uint32_t columns = 0;
+    if (end - p < static_cast<long>(sizeof(columns) + kChunkPadding)) {
+      return;
+    }
+    // The padding is never read as part of a column
+    end_of_chunk_ = end - kChunkPadding;
+    std::memcpy(&columns, p, sizeof(columns));
+    const auto table = sizeof(columns) * (columns + 1);
+    if (columns > kMaxColumns || end_of_chunk_ - p < static_cast<long>(table)) {
+      return;
+    }
+    const auto *body = p + table;
+    for (uint32_t k = 0; k < columns; ++k) {
+      uint32_t offset = 0;
+      std::memcpy(&offset, p + sizeof(columns) * (k + 1), sizeof(offset));
+      if (offset >= static_cast<uint64_t>(end_of_chunk_ - body)) {
+        return;
+      }
+      columns_[k].p_ = body + offset;
+      columns_[k].header_ = *columns_[k].p_++;
+    }
+    count_ = columns;
+    ok_ = true;
+  }
+
+  /// @brief False once a column was missing or ran past the chunk.
+  [[nodiscard]] bool Ok() const { return ok_; }
+
+  /// @brief Starts the next block of rows.
+  void Block(size_t begin, size_t end) {
+    begin_ = begin;
+    end_ = end;
+    next_ = 0;
+  }
+
+  template <typename Get, typename Set> void Int(Get, Set set) {
+    auto *c = Next();
+    if (c == nullptr || c->header_ >= std::size(kPow10)) {
+      ok_ = false;
+      return;
+    }
+    const auto mult = kPow10[c->header_];
+    if (Unpack(*c, set, [mult](int64_t units) { return units * mult; }) != 0) {
+      // Integers have no exceptions
+      ok_ = false;
+    }
+  }
+
+  template <typename Get, typename Set> void Price(Get, Set set) {
+    // Whole yuan tick sizes need no division
+    if (price_.digits_ == 0) {
+      Double<false>(set, price_);
+    } else {
+      Double<true>(set, price_);
+    }
+  }
+
+  template <typename Get, typename Set> void Money(Get, Set set) {
+    Double<true>(set, kMoneyScale);
+  }
+
+  template <typename Get, typename Set> void Count(Get, Set set) {
+    Double<false>(set, kCountScale);
+  }
+
+private:
+  struct Column {
+    const uint8_t *p_{nullptr};
+    int64_t units_{0}; // of the last row decoded
+    uint8_t header_{0};
+  };
+
+  Column *Next() {
+    if (!ok_ || next_ >= count_) {
+      ok_ = false;
+      return nullptr;
+    }
+    return &columns_[next_++];
+  }
+
+  template <bool kDivide, typename Set> void Double(Set set, Scale scale) {
+    auto *c = Next();
+    if (c == nullptr) {
+      return;
+    }
+    const auto step = static_cast<double>(scale.step_);
+    const auto div = static_cast<double>(kPow10[scale.digits_]);
+    const auto exceptions =
+        Unpack(*c, set, [step, div](int64_t units) {
+          const auto v = static_cast<double>(units) * step;
+          return kDivide ? v / div : v;
+        });
+    constexpr auto kException = sizeof(uint8_t) + sizeof(double);
+    if (!ok_ || end_of_chunk_ - c->p_ <
+                    static_cast<long>(exceptions * kException)) {
+      ok_ = false;
+      return;
+    }
+    for (size_t e = 0; e < exceptions; ++e, c->p_ += kException) {
+      const auto row = begin_ + c->p_[0];
+      double v = 0;
+      std::memcpy(&v, c->p_ + 1, sizeof(v));
+      if (row >= end_) {
+        ok_ = false;
+        return;
+      }
+      set(rows_[row], v);
+    }
+  }
+
+  /// @brief Sets a column of the rows of the block from the packed
+  /// differences.
+  ///
+  /// @return The number of exceptions that follow.
+  template <typename Set, typename Convert>
+  size_t Unpack(Column &c, Set set, Convert convert) {
+    uint64_t base = 0;
+    if (!Varint(c.p_, base) || end_of_chunk_ - c.p_ < 2) {
+      ok_ = false;
+      return 0;
+    }
+    const int width = c.p_[0];
+    const size_t exceptions = c.p_[1];
+    c.p_ += 2;
+    const auto n = end_ - begin_;
+    const auto bytes = (n * width + 7) / 8;
+    if ((width > kMaxPackedWidth && width != 64) ||
+        end_of_chunk_ - c.p_ < static_cast<long>(bytes)) {
+      ok_ = false;
+      return 0;
+    }
+    // Locals, as the rows could alias the column state
+    auto *rows = rows_ + begin_;
+    const auto *packed = c.p_;
+    auto units = c.units_;
+    if (width == 0) {
+      const auto delta = UnZigZag(base);
+      for (size_t i = 0; i < n; ++i) {
+        units += delta;
+        set(rows[i], convert(units));
+      }
+    } else if (width == 64) {
+      for (size_t i = 0; i < n; ++i) {
+        uint64_t z = 0;
+        std::memcpy(&z, packed + i * sizeof(z), sizeof(z));
+        units += UnZigZag(base + z);
+        set(rows[i], convert(units));
+      }
+    } else {
+      // The padding after the columns makes every 8 byte load safe
+      const auto mask = (uint64_t{1} << width) - 1;
+      for (size_t i = 0, bit = 0; i < n; ++i, bit += width) {
+        uint64_t word = 0;
+        std::memcpy(&word, packed + bit / 8, sizeof(word));
+        units += UnZigZag(base + ((word >> (bit % 8)) & mask));
+        set(rows[i], convert(units));
+      }
+    }
+    c.units_ = units;
+    c.p_ += bytes;
+    return exceptions;
+  }
+
+  bool Varint(const uint8_t *&p, uint64_t &v) const {
+    v = 0;
+    for (int shift = 0; p < end_of_chunk_ && shift < 64; shift += 7) {
+      const auto byte = *p++;
+      v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  Row *rows_;
+  const Scale price_;
+  const uint8_t *end_of_chunk_{nullptr};
+  std::array<Column, kMaxColumns> columns_;
+  uint32_t count_{0};
+  uint32_t next_{0};
+  size_t begin_{0};
+  size_t end_{0};
+  bool ok_{false};
+};
+
+/// @brief The columns of a depth as getter and setter pairs, walked by both
+/// the Encoder and the Decoder so the two never disagree on the layout.
+template <typename Coder> void Columns(Coder &c, const base::Depth *) {
+  using base::Depth;
+  c.Int([](const Depth &d) { return Nanos(d.update_time_); },
+        [](Depth &d, int64_t v) { SetNanos(d.update_time_, v); });
+  c.Int([](const Depth &d) { return int64_t{d.volume_}; },
+        [](Depth &d, int64_t v) { d.volume_ = static_cast<base::Volume>(v); });
+  for (int i = 0; i < base::kBookLevels; ++i) {
+    c.Int([i](const Depth &d) { return int64_t{d.ask_volume_[i]}; },
+          [i](Depth &d, int64_t v) {
+            d.ask_volume_[i] = static_cast<base::Volume>(v);
+          });
+    c.Int([i](const Depth &d) { return int64_t{d.bid_volume_[i]}; },
+          [i](Depth &d, int64_t v) {
+            d.bid_volume_[i] = static_cast<base::Volume>(v);
+          });
+  }
+  c.Count([](const Depth &d) { return d.open_interest_; },
+          [](Depth &d, double v) { d.open_interest_ = v; });
+  c.Price([](const Depth &d) { return d.open_; },
+          [](Depth &d, double v) { d.open_ = v; });
+  c.Price([](const Depth &d) { return d.high_; },
+          [](Depth &d, double v) { d.high_ = v; });
+  c.Price([](const Depth &d) { return d.low_; },
+          [](Depth &d, double v) { d.low_ = v; });
+  c.Price([](const Depth &d) { return d.last_; },
+          [](Depth &d, double v) { d.last_ = v; });
+  for (int i = 0; i < base::kBookLevels; ++i) {
+    c.Price([i](const Depth &d) { return d.ask_price_[i]; },
+            [i](Depth &d, double v) { d.ask_price_[i] = v; });
+    c.Price([i](const Depth &d) { return d.bid_price_[i]; },
+            [i](Depth &d, double v) { d.bid_price_[i] = v; });
+  }
+  c.Money([](const Depth &d) { return d.turnover_; },
+          [](Depth &d, double v) { d.turnover_ = v; });
+}
+
+template <typename Coder> void Columns(Coder &c, const base::Bar *) {
+  using base::Bar;
+  c.Int([](const Bar &b) { return Nanos(b.update_time_); },
+        [](Bar &b, int64_t v) { SetNanos(b.update_time_, v); });
+  c.Int([](const Bar &b) { return int64_t{b.trading_day_.AsInt()}; },
+        [](Bar &b, int64_t v) { b.trading_day_ = base::Date(v); });
+  c.Int([](const Bar &b) { return int64_t{b.period_}; },
+        [](Bar &b, int64_t v) { b.period_ = static_cast<int32_t>(v); });
+  c.Int([](const Bar &b) { return int64_t{b.volume_}; },
+        [](Bar &b, int64_t v) { b.volume_ = static_cast<base::Volume>(v); });
+  c.Price([](const Bar &b) { return b.open_; },
+          [](Bar &b, double v) { b.open_ = v; });
+  c.Price([](const Bar &b) { return b.high_; },
+          [](Bar &b, double v) { b.high_ = v; });
+  c.Price([](const Bar &b) { return b.low_; },
+          [](Bar &b, double v) { b.low_ = v; });
+  c.Price([](const Bar &b) { return b.close_; },
+          [](Bar &b, double v) { b.close_ = v; });
+  c.Money([](const Bar &b) { return b.turnover_; },
+          [](Bar &b, double v) { b.turnover_ = v; });
+}
+
+bool ChunkKeyLess(const TickChunk &a, const TickChunk &b) {
+  return std::tie(a.type_, a.id_, a.period_) <
+         std::tie(b.type_, b.id_, b.period_);
+}
+
+template <typename T>
+size_t DecodeChunk(const uint8_t *base, uint64_t map_bytes,
+                   const TickChunk &chunk, T *rows) {
+  if (chunk.type_ != base::MsgType<T> || chunk.offset_ > map_bytes ||
+      chunk.bytes_ > map_bytes - chunk.offset_ || chunk.price_digits_ >= 7) {
+    return 0;
+  }
+  const auto *p = base + chunk.offset_;
+  Decoder<T> decoder(p, p + chunk.bytes_, rows,
+                     {chunk.price_step_, chunk.price_digits_});
+  for (size_t begin = 0; begin < chunk.rows_ && decoder.Ok();
+       begin += kBlockRows) {
+    const auto end = std::min<size_t>(begin + kBlockRows, chunk.rows_);
+    for (auto i = begin; i < end; ++i) {
+      rows[i].id_ = chunk.id_;
+    }
+    decoder.Block(begin, end);
+    Columns(decoder, rows);
+  }
+  return decoder.Ok() ? chunk.rows_ : 0;
+}
+
+} // namespace
+
+bool TickFileWriter::Open(const std::string &path) {
+  Close();
+  file_ = std::fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  failed_ = false;
+  rows_ = 0;
+  index_.clear();
+  // The header is written again by Close, with the index in place
+  const TickFileHeader header{};
+  failed_ = std::fwrite(&header, sizeof(header), 1, file_) != 1;
+  offset_ = sizeof(header);
+  return !failed_;
+}
+
+template <typename T> void TickFileWriter::WriteChunk(Pending<T> &pending) {
+  auto &rows = pending.rows_;
+  if (rows.empty()) {
+    return;
+  }
+  const auto scale = ScaleOf(pending.tick_size_);
+  Encoder<T> encoder(rows, scale);
+  Columns(encoder, rows.data());
+  buf_.clear();
+  encoder.Finish(buf_);
+  TickChunk chunk{};
+  chunk.begin_ns_ = Nanos(rows.front().update_time_);
+  chunk.end_ns_ = Nanos(rows.back().update_time_);
+  chunk.id_ = rows.front().id_;
+  chunk.offset_ = offset_;
+  chunk.bytes_ = static_cast<uint32_t>(buf_.size());
+  chunk.rows_ = static_cast<uint32_t>(rows.size());
+  chunk.price_step_ = scale.step_;
+  chunk.type_ = base::MsgType<T>;
+  chunk.price_digits_ = static_cast<uint8_t>(scale.digits_);
+  if constexpr (std::is_same_v<T, base::Bar>) {
+    chunk.period_ = rows.front().period_;
+  }
+  if (std::fwrite(buf_.data(), 1, buf_.size(), file_) != buf_.size()) {
+    failed_ = true;
+  }
+  offset_ += buf_.size();
+  rows_ += rows.size();
+  index_.push_back(chunk);
+  rows.clear();
+}
+
+template void TickFileWriter::WriteChunk(Pending<base::Depth> &);
+template void TickFileWriter::WriteChunk(Pending<base::Bar> &);
+
+bool TickFileWriter::Close() {
+  if (file_ == nullptr) {
+    return !failed_;
+  }
+  for (auto &[id, pending] : depths_) {
+    WriteChunk(pending);
+  }
+  for (auto &[key, pending] : bars_) {
+    WriteChunk(pending);
+  }
+  depths_.clear();
+  bars_.clear();
+  std::stable_sort(index_.begin(), index_.end(),
+                   [](const TickChunk &a, const TickChunk &b) {
+                     return ChunkKeyLess(a, b) ||
+                            (!ChunkKeyLess(b, a) && a.begin_ns_ < b.begin_ns_);
+                   });
+  // The reader maps the index in place, so it starts aligned
+  static constexpr char kZeros[alignof(TickChunk)] = {};
+  const auto pad = (alignof(TickChunk) - offset_ % alignof(TickChunk)) %
+                   alignof(TickChunk);
+  if (std::fwrite(kZeros, 1, pad, file_) != pad) {
+    failed_ = true;
+  }
+  offset_ += pad;
+  TickFileHeader header{};
+  header.magic_ = TickFileHeader::kMagic;
+  header.version_ = TickFileHeader::kVersion;
+  header.rows_ = rows_;
+  header.chunks_ = index_.size();
+  header.index_offset_ = offset_;
+  if (failed_ ||
+      std::fwrite(index_.data(), sizeof(TickChunk), index_.size(), file_) !=
+          index_.size() ||
+      std::fseek(file_, 0, SEEK_SET) != 0 ||
+      std::fwrite(&header, sizeof(header), 1, file_) != 1) {
+    failed_ = true;
+  }
+  if (std::fclose(file_) != 0) {
+    failed_ = true;
+  }
+  file_ = nullptr;
+  return !failed_;
+}
+
+TickFileReader::~TickFileReader() { Unmap(); }
+
+void TickFileReader::Unmap() {
+  if (map_ != nullptr) {
+    munmap(map_, map_bytes_);
+    map_ = nullptr;
+  }
+  header_ = nullptr;
+  index_ = {};
+}
+
+bool TickFileReader::Open(const std::string &path) {
+  Unmap();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(TickFileHeader)) {
+    close(fd);
+    return false;
+  }
+  map_bytes_ = st.st_size;
+  map_ = mmap(nullptr, map_bytes_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map_ == MAP_FAILED) {
+    map_ = nullptr;
+    return false;
+  }
+  const auto *base = static_cast<const uint8_t *>(map_);
+  header_ = reinterpret_cast<const TickFileHeader *>(base);
+  if (header_->magic_ != TickFileHeader::kMagic ||
+      header_->version_ != TickFileHeader::kVersion ||
+      header_->index_offset_ > map_bytes_ ||
+      header_->index_offset_ % alignof(TickChunk) != 0 ||
+      header_->chunks_ >
+          (map_bytes_ - header_->index_offset_) / sizeof(TickChunk)) {
+    Unmap();
+    return false;
+  }
+  index_ = {reinterpret_cast<const TickChunk *>(base + header_->index_offset_),
+            header_->chunks_};
+  return true;
+}
+
+std::span<const TickChunk> TickFileReader::Find(uint16_t type,
+                                                base::InstrumentID id,
+                                                int32_t period,
+                                                int64_t begin_ns,
+                                                int64_t end_ns) const {
+  TickChunk key{};
+  key.type_ = type;
+  key.id_ = id;
+  key.period_ = period;
+  const auto [first, last] =
+      std::equal_range(index_.begin(), index_.end(), key, ChunkKeyLess);
+  // Chunks of an instrument and period do not overlap in time
+  const auto from = std::partition_point(
+      first, last,
+      [begin_ns](const TickChunk &c) { return c.end_ns_ < begin_ns; });
+  const auto to = std::partition_point(
+      from, last,
+      [end_ns](const TickChunk &c) { return c.begin_ns_ < end_ns; });
+  return {from, to};
+}
+
+size_t TickFileReader::Decode(const TickChunk &chunk,
+                              base::Depth *rows) const {
+  return DecodeChunk(static_cast<const uint8_t *>(map_), map_bytes_, chunk,
+                     rows);
+}
+
+size_t TickFileReader::Decode(const TickChunk &chunk, base::Bar *rows) const {
+  return DecodeChunk(static_cast<const uint8_t *>(map_), map_bytes_, chunk,
+                     rows);
+}
+
+} // namespace ctptrader::util
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/msg.hpp>
+
+namespace ctptrader::util {
+
+/// @brief Entry of the chunk index of a tick file. A chunk holds up to
+/// TickFileWriter::chunk_rows consecutive rows of one instrument and one
+/// message type, stored column by column.
+struct TickChunk {
+  int64_t begin_ns_; // update time of the first row
+  int64_t end_ns_;   // update time of the last row
+  base::InstrumentID id_;
+  uint64_t offset_; // file offset of the columns
+  uint32_t bytes_;  // of the columns
+  uint32_t rows_;
+  int64_t price_step_;   // tick size times 10^price_digits_
+  uint16_t type_;        // base::MsgType of the rows
+  uint8_t price_digits_; // decimals of the tick size
+  uint8_t pad_;
+  int32_t period_; // of bars, 0 for depths
+};
+static_assert(sizeof(TickChunk) == 56);
+
+/// @brief First bytes of a tick file. The chunks follow, then the index,
+/// sorted by type, instrument, bar period and time, at an offset aligned for
+/// TickChunk.
+struct TickFileHeader {
+  static constexpr uint64_t kMagic = 0x314b434954505443; // "CTPTICK1"
+  static constexpr uint32_t kVersion = 1;
+
+  uint64_t magic_;
+  uint32_t version_;
+  uint32_t pad_;
+  uint64_t rows_;
+  uint64_t chunks_;
+  uint64_t index_offset_;
+};
+
+/// @brief Writes Depth and Bar history into a tick file.
+///
+/// A chunk starts with the offsets of its columns. Every column holds prices
+/// in ticks of the instrument, turnover in cents, times and volumes as they
+/// are, each as the zigzag difference to the row before, bit packed in
+/// blocks of 64 rows at the width of the largest one. A price that is no
+/// whole number of ticks, such as the DBL_MAX CTP sends for a missing level,
+/// is stored as it is next to its block.
+class TickFileWriter {
+public:
+  static constexpr uint32_t kDefaultChunkRows = 4096;
+
+  explicit TickFileWriter(uint32_t chunk_rows = kDefaultChunkRows)
+      : chunk_rows_(chunk_rows) {}
+  ~TickFileWriter() { Close(); }
+
+  TickFileWriter(const TickFileWriter &) = delete;
+  TickFileWriter &operator=(const TickFileWriter &) = delete;
+
+  bool Open(const std::string &path);
+
+  /// @brief Adds a row. Rows of an instrument come in time order, bars of
+  /// one period at a time.
+  ///
+  /// @param tick_size Tick size of the instrument, Underlying::tick_size_.
+  void Append(const base::Depth &depth, base::Price tick_size) {
+    Add(depths_[depth.id_], depth, tick_size);
+  }
+
+  void Append(const base::Bar &bar, base::Price tick_size) {
+    Add(bars_[{bar.id_, bar.period_}], bar, tick_size);
+  }
+
+  /// @brief Writes the rows still pending and the index.
+  ///
+  /// @return False if a write failed.
+  bool Close();
+
+private:
+  template <typename T> struct Pending {
+    std::vector<T> rows_;
+    base::Price tick_size_{0};
+  };
+
+  template <typename T>
+  void Add(Pending<T> &pending, const T &row, base::Price tick_size) {
+    if (!pending.rows_.empty() && pending.tick_size_ != tick_size) {
+      WriteChunk(pending);
+    }
+    pending.tick_size_ = tick_size;
+    pending.rows_.push_back(row);
+    if (pending.rows_.size() >= chunk_rows_) {
+      WriteChunk(pending);
+    }
+  }
+
+  template <typename T> void WriteChunk(Pending<T> &pending);
+
+  const uint32_t chunk_rows_;
+  std::FILE *file_{nullptr};
+  bool failed_{false};
+  uint64_t offset_{0};
+  uint64_t rows_{0};
+  std::vector<TickChunk> index_;
+  std::vector<uint8_t> buf_; // columns of the chunk being written
+  std::map<base::InstrumentID, Pending<base::Depth>> depths_;
+  std::map<std::pair<base::InstrumentID, int32_t>, Pending<base::Bar>> bars_;
+};
+
+/// @brief Maps a tick file read only and decodes its chunks.
+class TickFileReader {
+public:
+  TickFileReader() = default;
+  ~TickFileReader();
+
+  TickFileReader(const TickFileReader &) = delete;
+  TickFileReader &operator=(const TickFileReader &) = delete;
+
+  /// @return False if the file is missing or not a tick file.
+  bool Open(const std::string &path);
+
+  [[nodiscard]] const TickFileHeader &Header() const { return *header_; }
+
+  /// @brief Every chunk, sorted by type, instrument, bar period and time.
+  [[nodiscard]] std::span<const TickChunk> Chunks() const { return index_; }
+
+  /// @brief The depth chunks of an instrument with rows in [begin_ns,
+  /// end_ns), in time order.
+  [[nodiscard]] std::span<const TickChunk>
+  FindDepths(base::InstrumentID id, int64_t begin_ns = INT64_MIN,
+             int64_t end_ns = INT64_MAX) const {
+    return Find(base::MsgType<base::Depth>, id, 0, begin_ns, end_ns);
+  }
+
+  /// @brief The bar chunks of an instrument and period with bars ending in
+  /// [begin_ns, end_ns), in time order.
+  [[nodiscard]] std::span<const TickChunk>
+  FindBars(base::InstrumentID id, int32_t period,
+           int64_t begin_ns = INT64_MIN, int64_t end_ns = INT64_MAX) const {
+    return Find(base::MsgType<base::Bar>, id, period, begin_ns, end_ns);
+  }
+
+  /// @brief Decodes a chunk of depths.
+  ///
+  /// @param rows Room for chunk.rows_ rows.
+  /// @return The rows decoded, 0 if the chunk holds no depths or is corrupt.
+  size_t Decode(const TickChunk &chunk, base::Depth *rows) const;
+
+  size_t Decode(const TickChunk &chunk, base::Bar *rows) const;
+
+private:
+  [[nodiscard]] std::span<const TickChunk> Find(uint16_t type,
+                                                base::InstrumentID id,
+                                                int32_t period,
+                                                int64_t begin_ns,
+                                                int64_t end_ns) const;
+
+  void Unmap();
+
+  void *map_{nullptr};
+  uint64_t map_bytes_{0};
+  const TickFileHeader *header_{nullptr};
+  std::span<const TickChunk> index_;
+};
+
+} // namespace ctptrader::util
@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <util/tickfile.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::util;
+
+constexpr int kInstruments = 20;
+constexpr int kTicksPerInstrument = 50000;
+constexpr char kPath[] = "tickfile_b.tick";
+
+/// @brief Tick sizes in cents of a few products: cu, rb, au and IF.
+constexpr int64_t kTickCents[] = {1000, 100, 2, 20};
+
+/// @brief A price as CTP gives it, the double nearest to the decimal.
+base::Price Cents(int64_t cents) { return static_cast<double>(cents) / 100; }
+
+/// @brief Half a day of two ticks a second per instrument. The last price
+/// walks in ticks with the book following it, and between trades only a
+/// level or two of the book changes, as on the exchange.
+std::vector<base::Depth> Ticks(base::InstrumentID id, int64_t tick) {
+  std::mt19937 rng(static_cast<uint32_t>(id));
+  std::uniform_int_distribution<int> move(-1, 1);
+  std::uniform_int_distribution<int> size(1, 200);
+  std::uniform_int_distribution<int> level(0, 2 * base::kBookLevels - 1);
+  std::vector<base::Depth> ticks;
+  base::Depth d{};
+  d.id_ = id;
+  auto last = 4000 * tick;
+  auto high = last;
+  auto low = last;
+  int64_t turnover = 0;
+  d.open_ = Cents(last);
+  d.open_interest_ = 100000;
+  for (int l = 0; l < base::kBookLevels; ++l) {
+    d.ask_volume_[l] = size(rng);
+    d.bid_volume_[l] = size(rng);
+  }
+  for (int i = 0; i < kTicksPerInstrument; ++i) {
+    const auto ms = 1699016400000L + i * 500L;
+    d.update_time_.tv_sec = ms / 1000;
+    d.update_time_.tv_nsec = ms % 1000 * 1000000;
+    last += move(rng) * tick;
+    high = std::max(high, last);
+    low = std::min(low, last);
+    d.last_ = Cents(last);
+    d.high_ = Cents(high);
+    d.low_ = Cents(low);
+    const auto traded = size(rng) / 20;
+    d.volume_ += traded;
+    d.open_interest_ += traded / 2 * move(rng);
+    turnover += traded * last * 5;
+    d.turnover_ = Cents(turnover);
+    for (int l = 0; l < base::kBookLevels; ++l) {
+      d.ask_price_[l] = Cents(last + (l + 1) * tick);
+      d.bid_price_[l] = Cents(last - l * tick);
+    }
+    for (int n = size(rng) % 2; n < 2; ++n) {
+      const auto l = level(rng);
+      auto &volume = l < base::kBookLevels
+                         ? d.ask_volume_[l]
+                         : d.bid_volume_[l - base::kBookLevels];
+      volume = size(rng);
+    }
+    ticks.push_back(d);
+  }
+  return ticks;
+}
+
+/// @brief The same ticks as a CSV file of the fields of
+/// CThostFtdcDepthMarketDataField, as tick data is usually kept.
+size_t CsvBytes(const std::vector<base::Depth> &ticks) {
+  size_t bytes = 0;
+  char line[1024];
+  for (const auto &d : ticks) {
+    tm time{};
+    const time_t cst = d.update_time_.tv_sec + base::CSTOFFSET;
+    gmtime_r(&cst, &time);
+    auto n = snprintf(line, sizeof(line),
+                      "20231106,cu%04ld,SHFE,%02d:%02d:%02d,%ld,%g,%g,%g,%g,%d,"
+                      "%.2f,%g",
+                      2400 + d.id_, time.tm_hour, time.tm_min, time.tm_sec,
+                      d.update_time_.tv_nsec / 1000000, d.last_, d.open_,
+                      d.high_, d.low_, d.volume_, d.turnover_,
+                      d.open_interest_);
+    for (int l = 0; l < base::kBookLevels; ++l) {
+      n += snprintf(line + n, sizeof(line) - n, ",%g,%d,%g,%d",
+                    d.bid_price_[l], d.bid_volume_[l], d.ask_price_[l],
+                    d.ask_volume_[l]);
+    }
+    bytes += n + 1;
+  }
+  return bytes;
+}
+
+struct Fixture {
+  Fixture() {
+    TickFileWriter writer;
+    writer.Open(kPath);
+    for (int id = 0; id < kInstruments; ++id) {
+      const auto tick = kTickCents[id % std::size(kTickCents)];
+      const auto ticks = Ticks(id, tick);
+      csv_bytes_ += CsvBytes(ticks);
+      for (const auto &d : ticks) {
+        writer.Append(d, Cents(tick));
+      }
+    }
+    writer.Close();
+    file_bytes_ = std::filesystem::file_size(kPath);
+    reader_.Open(kPath);
+  }
+  ~Fixture() { std::filesystem::remove(kPath); }
+
+  TickFileReader reader_;
+  size_t csv_bytes_{0};
+  size_t file_bytes_{0};
+};
+
+void DecodeDepth(benchmark::State &state) {
+  static Fixture fixture;
+  const auto &reader = fixture.reader_;
+  std::vector<base::Depth> rows(TickFileWriter::kDefaultChunkRows);
+  size_t decoded = 0;
+  for (auto _ : state) {
+    for (const auto &chunk : reader.Chunks()) {
+      decoded += reader.Decode(chunk, rows.data());
+      benchmark::DoNotOptimize(rows.data());
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(decoded));
+  const auto total = static_cast<double>(reader.Header().rows_);
+  state.counters["file_bytes_per_row"] = fixture.file_bytes_ / total;
+  state.counters["csv_bytes_per_row"] = fixture.csv_bytes_ / total;
+}
+
+} // namespace
+
+BENCHMARK(DecodeDepth);
@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+#include <util/tickfile.hpp>
+
+namespace {
+
+using namespace ctptrader;
+using namespace ctptrader::util;
+
+constexpr int64_t kStart = 1699016400L * 1000000000L; // 2023-11-03 21:00 CST
+
+/// @brief Tick files are removed before and after every test.
+struct ScopedFile {
+  explicit ScopedFile(std::string path) : path_(std::move(path)) {
+    std::filesystem::remove(path_);
+  }
+  ~ScopedFile() { std::filesystem::remove(path_); }
+
+  const std::string path_;
+};
+
+base::Timestamp At(int64_t ns) {
+  base::Timestamp ts;
+  ts.tv_sec = ns / 1000000000L;
+  ts.tv_nsec = ns % 1000000000L;
+  return ts;
+}
+
+/// @brief A random walk in whole ticks with a full book.
+std::vector<base::Depth> Ticks(base::InstrumentID id, base::Price tick,
+                               int count) {
+  std::vector<base::Depth> ticks;
+  base::Depth d{};
+  d.id_ = id;
+  d.open_ = d.high_ = d.low_ = d.last_ = 3000 * tick;
+  for (int i = 0; i < count; ++i) {
+    d.update_time_ = At(kStart + i * 500000000L);
+    d.last_ += ((i * 7919) % 5 - 2) * tick;
+    d.high_ = std::max(d.high_, d.last_);
+    d.low_ = std::min(d.low_, d.last_);
+    d.volume_ += i % 3;
+    d.open_interest_ += i % 4 - 1;
+    d.turnover_ += (i % 3) * d.last_ * 5;
+    for (int l = 0; l < base::kBookLevels; ++l) {
+      d.ask_price_[l] = d.last_ + (l + 1) * tick;
+      d.bid_price_[l] = d.last_ - l * tick;
+      d.ask_volume_[l] = (i + l) % 17;
+      d.bid_volume_[l] = (i * l) % 13;
+    }
+    ticks.push_back(d);
+  }
+  return ticks;
+}
+
+uint64_t Bits(double v) { return std::bit_cast<uint64_t>(v); }
+
+void ExpectSame(const base::Depth &a, const base::Depth &b) {
+  EXPECT_EQ(a.update_time_.tv_sec, b.update_time_.tv_sec);
+  EXPECT_EQ(a.update_time_.tv_nsec, b.update_time_.tv_nsec);
+  EXPECT_EQ(a.id_, b.id_);
+  EXPECT_EQ(Bits(a.open_), Bits(b.open_));
+  EXPECT_EQ(Bits(a.high_), Bits(b.high_));
+  EXPECT_EQ(Bits(a.low_), Bits(b.low_));
+  EXPECT_EQ(Bits(a.last_), Bits(b.last_));
+  EXPECT_EQ(Bits(a.open_interest_), Bits(b.open_interest_));
+  EXPECT_EQ(a.volume_, b.volume_);
+  EXPECT_EQ(Bits(a.turnover_), Bits(b.turnover_));
+  for (int l = 0; l < base::kBookLevels; ++l) {
+    EXPECT_EQ(Bits(a.ask_price_[l]), Bits(b.ask_price_[l]));
+    EXPECT_EQ(Bits(a.bid_price_[l]), Bits(b.bid_price_[l]));
+    EXPECT_EQ(a.ask_volume_[l], b.ask_volume_[l]);
+    EXPECT_EQ(a.bid_volume_[l], b.bid_volume_[l]);
+  }
+}
+
+std::vector<base::Depth> DecodeAll(const TickFileReader &reader,
+                                   std::span<const TickChunk> chunks) {
+  std::vector<base::Depth> rows;
+  for (const auto &chunk : chunks) {
+    std::vector<base::Depth> chunk_rows(chunk.rows_);
+    EXPECT_EQ(reader.Decode(chunk, chunk_rows.data()), chunk.rows_);
+    rows.insert(rows.end(), chunk_rows.begin(), chunk_rows.end());
+  }
+  return rows;
+}
+
+TEST(TickFileTest, Depth) {
+  ScopedFile file("tickfile_t.tick");
+  auto fine = Ticks(0, 0.2, 250);
+  auto coarse = Ticks(3, 10, 120);
+  // What CTP sends for empty levels and a session without an open yet, and
+  // a price off the tick grid
+  fine[10].ask_price_[4] = DBL_MAX;
+  fine[11].open_ = std::nan("");
+  fine[12].last_ = 3000.1;
+  coarse[5].turnover_ = 1.0 / 3;
+  TickFileWriter writer(100);
+  ASSERT_TRUE(writer.Open(file.path_));
+  for (size_t i = 0; i < fine.size(); ++i) {
+    writer.Append(fine[i], 0.2);
+    if (i < coarse.size()) {
+      writer.Append(coarse[i], 10);
+    }
+  }
+  ASSERT_TRUE(writer.Close());
+
+  TickFileReader reader;
+  ASSERT_TRUE(reader.Open(file.path_));
+  EXPECT_EQ(reader.Header().rows_, fine.size() + coarse.size());
+  EXPECT_EQ(reader.Header().index_offset_ % alignof(TickChunk), 0U);
+  EXPECT_EQ(reader.Chunks().size(), 5U);
+  for (const auto &expected : {fine, coarse}) {
+    const auto chunks = reader.FindDepths(expected[0].id_);
+    const auto rows = DecodeAll(reader, chunks);
+    ASSERT_EQ(rows.size(), expected.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+      ExpectSame(rows[i], expected[i]);
+    }
+  }
+  EXPECT_TRUE(reader.FindDepths(1).empty());
+}
+
+TEST(TickFileTest, FindByTime) {
+  ScopedFile file("tickfile_t.tick");
+  const auto ticks = Ticks(0, 1, 1000);
+  TickFileWriter writer(100);
+  ASSERT_TRUE(writer.Open(file.path_));
+  for (const auto &tick : ticks) {
+    writer.Append(tick, 1);
+  }
+  ASSERT_TRUE(writer.Close());
+  TickFileReader reader;
+  ASSERT_TRUE(reader.Open(file.path_));
+  // Rows 150 to 349 lie in chunks 1 to 3
+  const auto chunks = reader.FindDepths(0, kStart + 150 * 500000000L,
+                                        kStart + 350 * 500000000L);
+  ASSERT_EQ(chunks.size(), 3U);
+  EXPECT_EQ(chunks[0].begin_ns_, kStart + 100 * 500000000L);
+  EXPECT_EQ(chunks[2].end_ns_, kStart + 399 * 500000000L);
+  EXPECT_TRUE(reader.FindDepths(0, kStart + 1000 * 500000000L).empty());
+  EXPECT_EQ(reader.FindDepths(0).size(), 10U);
+}
+
+TEST(TickFileTest, Bar) {
+  ScopedFile file("tickfile_t.tick");
+  TickFileWriter writer;
+  ASSERT_TRUE(writer.Open(file.path_));
+  std::vector<base::Bar> bars;
+  for (int i = 0; i < 30; ++i) {
+    base::Bar bar{};
+    bar.trading_day_ = base::Date(20231106);
+    bar.id_ = 2;
+    bar.period_ = i % 5 == 4 ? 300 : 60;
+    bar.update_time_ = At(kStart + (i + 1) * 60000000000L);
+    bar.open_ = 5000 + i * 0.5;
+    bar.high_ = bar.open_ + 2;
+    bar.low_ = bar.open_ - 1.5;
+    bar.close_ = bar.open_ + 0.5;
+    bar.volume_ = 10 + i;
+    bar.turnover_ = bar.volume_ * bar.close_ * 10;
+    writer.Append(bar, 0.5);
+    bars.push_back(bar);
+  }
+  ASSERT_TRUE(writer.Close());
+  TickFileReader reader;
+  ASSERT_TRUE(reader.Open(file.path_));
+  EXPECT_TRUE(reader.FindDepths(2).empty());
+  ASSERT_EQ(reader.FindBars(2, 300).size(), 1U);
+  const auto &chunk = reader.FindBars(2, 60)[0];
+  std::vector<base::Bar> rows(chunk.rows_);
+  ASSERT_EQ(reader.Decode(chunk, rows.data()), 24U);
+  // Depths cannot be decoded from a bar chunk
+  std::vector<base::Depth> depths(chunk.rows_);
+  EXPECT_EQ(reader.Decode(chunk, depths.data()), 0U);
+  size_t j = 0;
+  for (const auto &bar : bars) {
+    if (bar.period_ != 60) {
+      continue;
+    }
+    const auto &row = rows[j++];
+    EXPECT_EQ(row.trading_day_, bar.trading_day_);
+    EXPECT_EQ(row.update_time_.tv_sec, bar.update_time_.tv_sec);
+    EXPECT_EQ(row.id_, bar.id_);
+    EXPECT_EQ(row.period_, 60);
+    EXPECT_EQ(row.open_, bar.open_);
+    EXPECT_EQ(row.high_, bar.high_);
+    EXPECT_EQ(row.low_, bar.low_);
+    EXPECT_EQ(row.close_, bar.close_);
+    EXPECT_EQ(row.volume_, bar.volume_);
+    EXPECT_EQ(row.turnover_, bar.turnover_);
+  }
+}
+
+TEST(TickFileTest, NotATickFile) {
+  ScopedFile file("tickfile_t.tick");
+  TickFileReader reader;
+  EXPECT_FALSE(reader.Open(file.path_));
+  std::FILE *f = std::fopen(file.path_.c_str(), "wb");
+  std::fputs("instrument,time,last\n", f);
+  std::fclose(f);
+  EXPECT_FALSE(reader.Open(file.path_));
+  // An index the reader could not map in place
+  TickFileHeader header{};
+  header.magic_ = TickFileHeader::kMagic;
+  header.version_ = TickFileHeader::kVersion;
+  header.index_offset_ = sizeof(header) + 1;
+  f = std::fopen(file.path_.c_str(), "wb");
+  std::fwrite(&header, sizeof(header), 1, f);
+  std::fputs("padding", f);
+  std::fclose(f);
+  EXPECT_FALSE(reader.Open(file.path_));
+}
+
+} // namespace